@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include "Binary.h"
+#include "binary/elf/ElfBinaryAnalyzer.h"
+#include "binary/ihex/IHexBinaryAnalyzer.h"
+#include "arch/x86/X86FunctionAnalyzer.h"
+#include "arch/AvrFunctionAnalyzer.h"
+#include "Main.h"
+#include "FileFormat.h"
+#include "Architecture.h"
+#include "SSAAddressToBlockTransformer.h"
+#include "SSAPhiNodeGenerator.h"
+#include "SSAAssignmentSimplifier.h"
+#include "SSAPeepholeOptimizer.h"
+#include "SSAConstPropagation.h"
+#include "SSAGlobalValueNumbering.h"
+#include "SSADCETransformer.h"
+#include "SSAApplyRegRef.h"
+#include "SSAPassManager.h"
+#include "SSARegStateSolver.h"
+#include "SSATransformToC.h"
+#include "CallGraph.h"
+#include "JobController.h"
+#include "Profiler.h"
+#include "MemoryAccounting.h"
+
+using namespace holodec;
+
+//runs the whole pipeline on a set of binaries and times every stage separately
+//the samples of all runs are written as json so the results of two commits can be compared
+
+FileFormat elffileformat = { "elf", "elf",{
+	[](File* file, HString name) {
+		holoelf::ElfBinaryAnalyzer* analyzer = new holoelf::ElfBinaryAnalyzer();
+		if (analyzer->canAnalyze(file))
+			return (BinaryAnalyzer*)analyzer;
+		delete analyzer;
+		return (BinaryAnalyzer*) nullptr;
+	}
+}
+};
+FileFormat ihexfileformat = { "ihex", "ihex",{
+	[](File* file, HString name) {
+		holoihex::IHexBinaryAnalyzer* analyzer = new holoihex::IHexBinaryAnalyzer();
+		if (analyzer->canAnalyze(file))
+			return (BinaryAnalyzer*)analyzer;
+		delete analyzer;
+		return (BinaryAnalyzer*) nullptr;
+	}
+}
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double secondsSince (BenchClock::time_point start) {
+	return std::chrono::duration<double> (BenchClock::now() - start).count();
+}
+
+struct BenchStage {
+	HString name;
+	HList<double> samples;//seconds, one per run
+};
+
+struct BenchInput {
+	HString file;
+	HString error;//empty if the input could be processed
+	uint64_t functions = 0;
+	uint64_t instructions = 0;
+	uint64_t bytes = 0;//size of the C output
+	HList<BenchStage> stages;//in pipeline order
+	HList<MemoryStage> memory;//of the last run, only with --memory
+
+	void addSample (HString name, double seconds) {
+		for (BenchStage& stage : stages) {
+			if (stage.name == name) {
+				stage.samples.push_back (seconds);
+				return;
+			}
+		}
+		stages.push_back ({name, {seconds}});
+	}
+};
+
+struct BenchOptions {
+	uint32_t runs = 5;
+	uint32_t warmup = 1;
+	uint32_t threads = 1;
+	const char* json = "holodec-bench.json";
+	const char* label = "";
+	const char* workingdir = "workingdir";
+	const char* trace = nullptr;
+	bool memory = false;
+	bool corpus = true;
+	HList<HString> files;
+};
+
+//one run of the pipeline, the samples are only recorded if record is set
+static bool runPipeline (BenchInput* input, JobController* jobs, uint32_t threads, bool record, bool memory) {
+	auto start = BenchClock::now();
+	auto stageStart = start;
+	HList<std::pair<HString, double>> samples;
+	Binary* binary = nullptr;
+	//the memory is measured between the stages so it does not count towards their time
+	MemoryTracker tracker;
+	double memoryTime = 0.0;
+	auto recordMemory = [&tracker, &binary, &memoryTime, memory] (const char* name) {
+		if (memory) {
+			auto memoryStart = BenchClock::now();
+			tracker.record (name, binary);
+			memoryTime += secondsSince (memoryStart);
+		}
+	};
+	auto endStage = [&samples, &stageStart, &recordMemory] (const char* name) {
+		samples.push_back ({name, secondsSince (stageStart)});
+		recordMemory (name);
+		stageStart = BenchClock::now();
+	};
+
+	File* file = Main::loadDataFromFile (input->file);
+	if (!file) {
+		input->error = "cannot load file";
+		return false;
+	}
+	endStage ("load");
+
+	BinaryAnalyzer* analyzer = nullptr;
+	for (FileFormat* fileformat : Main::g_main->fileformats) {
+		analyzer = fileformat->createBinaryAnalyzer (file, "binary");
+		if (analyzer)
+			break;
+	}
+	if (!analyzer) {
+		input->error = "no file format";
+		delete file;
+		return false;
+	}
+	if (!analyzer->init (file)) {
+		input->error = "cannot parse file";
+		delete analyzer;
+		delete file;
+		return false;
+	}
+	binary = analyzer->binary;
+	FunctionAnalyzer* funcAnalyzer = nullptr;
+	for (Architecture* architecture : Main::g_main->architectures) {
+		if (!binary->arch)
+			break;
+		funcAnalyzer = architecture->createFunctionAnalyzer (binary);
+		if (funcAnalyzer)
+			break;
+	}
+	if (!funcAnalyzer) {
+		input->error = "no architecture";
+		delete analyzer;
+		delete file;
+		return false;
+	}
+	funcAnalyzer->init (binary);
+	for (Symbol* sym : binary->symbols) {
+		if (sym->symboltype == &SymbolType::symfunc) {
+			Function* newfunction = new Function();
+			newfunction->symbolref = sym->id;
+			newfunction->baseaddr = sym->vaddr;
+			newfunction->addrToAnalyze.insert (sym->vaddr);
+			binary->addFunction (newfunction);
+		}
+	}
+	endStage ("parse");
+
+	//decoding and lifting are interleaved, the function analyzer measures the lifting part
+	CallGraph callGraph;
+	for (Function* func : binary->functions)
+		callGraph.addFunction (func);
+	bool funcAnalyzed;
+	do {
+		funcAnalyzed = false;
+		for (Function* func : binary->functions) {
+			if (!func->addrToAnalyze.empty()) {
+				funcAnalyzer->analyzeFunction (func);
+				callGraph.addCalls (func);
+				funcAnalyzed = true;
+				for (uint64_t addr : func->funcsCalled) {
+					if (binary->findSymbol (addr, &SymbolType::symfunc) == nullptr) {
+						char buffer[100];
+						snprintf (buffer, 100, "func_0x%" PRIx64 "", addr);
+						Symbol* symbol = new Symbol ({0, buffer, &SymbolType::symfunc, 0, addr, 0});
+						binary->addSymbol (symbol);
+						Function* newfunction = new Function();
+						newfunction->symbolref = symbol->id;
+						newfunction->baseaddr = symbol->vaddr;
+						newfunction->addrToAnalyze.insert (symbol->vaddr);
+						binary->addFunction (newfunction);
+						callGraph.addFunction (newfunction);
+					}
+				}
+				break;
+			}
+		}
+	} while (funcAnalyzed);
+	double analyzeTime = secondsSince (stageStart);
+	samples.push_back ({"decode", analyzeTime - funcAnalyzer->stats.liftTime});
+	samples.push_back ({"lift", funcAnalyzer->stats.liftTime});
+	recordMemory ("decode");
+
+	HList<Function*> functions;
+	for (Function* func : binary->functions)
+		functions.push_back (func);
+
+	//the stages run one after the other so their times do not overlap
+	SSAPassManager setupPasses (binary);
+	setupPasses.addPass ("AddressToBlock", new SSAAddressToBlockTransformer());
+	setupPasses.addPass ("PhiNodeGenerator", new SSAPhiNodeGenerator());
+	for (SSAPass& pass : setupPasses.passes)
+		pass.transformer->arch = binary->arch;
+	for (Function* func : functions)
+		setupPasses.run (func);
+
+	HList<SSAPassManager*> optimizerPasses;
+	for (uint32_t i = 0; i < threads; i++) {
+		SSAPassManager* passManager = new SSAPassManager (binary);
+		passManager->addPass ("AssignmentSimplifier", new SSAAssignmentSimplifier());
+		passManager->addPass ("PeepholeOptimizer", new SSAPeepholeOptimizer());
+		passManager->addPass ("ConstPropagation", new SSAConstPropagation());
+		passManager->addPass ("GlobalValueNumbering", new SSAGlobalValueNumbering());
+		passManager->addPass ("DCE", new SSADCETransformer());
+		passManager->addPass ("ApplyRegRef", new SSAApplyRegRef(), true);
+		for (SSAPass& pass : passManager->passes)
+			pass.transformer->arch = binary->arch;
+		optimizerPasses.push_back (passManager);
+	}
+	callGraph.update();
+	callGraph.runBottomUp (jobs, functions, [&optimizerPasses, &callGraph, binary] (HList<Function*>& scc, JobContext context) {
+		if (callGraph.isRecursive (scc[0])) {
+			SSARegStateSolver solver (binary->arch, binary);
+			solver.solve (scc);
+		}
+		optimizerPasses[context.threadId]->runToFixpoint (scc);
+	});
+	for (uint32_t i = 1; i < threads; i++)
+		optimizerPasses[0]->mergeStats (optimizerPasses[i]);
+	//the pass times are summed over the job threads
+	for (SSAPass& pass : setupPasses.passes)
+		samples.push_back ({pass.name, pass.stats.time});
+	for (SSAPass& pass : optimizerPasses[0]->passes)
+		samples.push_back ({pass.name, pass.stats.time});
+	recordMemory ("optimize");
+
+	stageStart = BenchClock::now();
+	SSACEmitter emitter (binary, threads);
+	emitter.render (jobs, functions);
+	endStage ("emit");
+	samples.push_back ({"total", secondsSince (start) - memoryTime});
+
+	if (record) {
+		for (std::pair<HString, double>& sample : samples)
+			input->addSample (sample.first, sample.second);
+		input->functions = functions.size();
+		input->instructions = funcAnalyzer->stats.instructions;
+		input->bytes = 0;
+		for (auto& entry : emitter.texts)
+			input->bytes += entry.second.text.size();
+		input->memory = tracker.stages;
+	}
+
+	for (SSAPassManager* passManager : optimizerPasses) {
+		for (SSAPass& pass : passManager->passes)
+			delete pass.transformer;
+		delete passManager;
+	}
+	for (SSAPass& pass : setupPasses.passes)
+		delete pass.transformer;
+	//the binary does not own its functions
+	for (Function* func : functions)
+		delete func;
+	delete binary;
+	delete funcAnalyzer;
+	delete analyzer;
+	delete file;
+	return true;
+}
+
+static double median (HList<double> samples) {
+	if (samples.empty())
+		return 0.0;
+	std::sort (samples.begin(), samples.end());
+	size_t middle = samples.size() / 2;
+	return samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2.0;
+}
+
+static void writeJsonString (FILE* file, const char* str) {
+	fputc ('"', file);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf (file, "\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			fprintf (file, "\\u%04x", *str);
+		else
+			fputc (*str, file);
+	}
+	fputc ('"', file);
+}
+
+//times are in milliseconds
+static void writeJson (FILE* file, BenchOptions& options, HList<BenchInput>& inputs) {
+	fprintf (file, "{\n\t\"label\": ");
+	writeJsonString (file, options.label);
+	fprintf (file, ",\n\t\"runs\": %" PRIu32 ",\n\t\"warmup\": %" PRIu32 ",\n\t\"threads\": %" PRIu32 ",\n\t\"inputs\": [", options.runs, options.warmup, options.threads);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		BenchInput& input = inputs[i];
+		fprintf (file, "%s\n\t\t{\n\t\t\t\"file\": ", i ? "," : "");
+		writeJsonString (file, input.file.cstr());
+		if (input.error) {
+			fprintf (file, ",\n\t\t\t\"error\": ");
+			writeJsonString (file, input.error.cstr());
+			fprintf (file, "\n\t\t}");
+			continue;
+		}
+		fprintf (file, ",\n\t\t\t\"functions\": %" PRIu64 ",\n\t\t\t\"instructions\": %" PRIu64 ",\n\t\t\t\"bytes\": %" PRIu64 ",\n\t\t\t\"stages\": [", input.functions, input.instructions, input.bytes);
+		for (size_t j = 0; j < input.stages.size(); j++) {
+			BenchStage& stage = input.stages[j];
+			double sum = 0.0;
+			for (double sample : stage.samples)
+				sum += sample;
+			fprintf (file, "%s\n\t\t\t\t{\"name\": ", j ? "," : "");
+			writeJsonString (file, stage.name.cstr());
+			fprintf (file, ", \"min\": %.4f, \"median\": %.4f, \"mean\": %.4f, \"max\": %.4f, \"samples\": [",
+			         *std::min_element (stage.samples.begin(), stage.samples.end()) * 1000.0, median (stage.samples) * 1000.0,
+			         sum / stage.samples.size() * 1000.0, *std::max_element (stage.samples.begin(), stage.samples.end()) * 1000.0);
+			for (size_t k = 0; k < stage.samples.size(); k++)
+				fprintf (file, "%s%.4f", k ? ", " : "", stage.samples[k] * 1000.0);
+			fprintf (file, "]}");
+		}
+		fprintf (file, "\n\t\t\t]");
+		//in bytes, the peak is the one of the process up to that stage
+		if (!input.memory.empty()) {
+			fprintf (file, ",\n\t\t\t\"memory\": [");
+			for (size_t j = 0; j < input.memory.size(); j++) {
+				MemoryStage& stage = input.memory[j];
+				fprintf (file, "%s\n\t\t\t\t{\"name\": ", j ? "," : "");
+				writeJsonString (file, stage.name);
+				fprintf (file, ", \"rss\": %" PRIu64 ", \"peak\": %" PRIu64 ", \"instructions\": %" PRIu64 ", \"ssa\": %" PRIu64 ", \"strings\": %" PRIu64 ", \"objects\": %" PRIu64 ", \"data\": %" PRIu64 ", \"total\": %" PRIu64 "}",
+				         stage.rss, stage.peak, stage.usage.instructions, stage.usage.ssa, stage.usage.strings, stage.usage.objects, stage.usage.data, stage.usage.total());
+			}
+			fprintf (file, "\n\t\t\t]");
+		}
+		fprintf (file, "\n\t\t}");
+	}
+	fprintf (file, "\n\t]\n}\n");
+}
+
+static void printSummary (HList<BenchInput>& inputs) {
+	printf ("Benchmark Results\n");
+	for (BenchInput& input : inputs) {
+		printf ("%s\n", input.file.cstr());
+		if (input.error) {
+			printIndent (1);
+			printf ("Skipped: %s\n", input.error.cstr());
+			continue;
+		}
+		printIndent (1);
+		printf ("Functions: %" PRIu64 " Instructions: %" PRIu64 " Bytes: %" PRIu64 "\n", input.functions, input.instructions, input.bytes);
+		for (BenchStage& stage : input.stages) {
+			printIndent (1);
+			printf ("%-24s Median: %8.3f ms Min: %8.3f ms\n", stage.name.cstr(), median (stage.samples) * 1000.0, *std::min_element (stage.samples.begin(), stage.samples.end()) * 1000.0);
+		}
+		for (MemoryStage& stage : input.memory) {
+			printIndent (1);
+			printf ("%-24s RSS: %8.1f MiB Peak: %8.1f MiB Binary: %8.1f MiB\n", stage.name, stage.rss / 1048576.0, stage.peak / 1048576.0, stage.usage.total() / 1048576.0);
+		}
+	}
+}
+
+static void printUsage() {
+	printf ("Usage: holodec-bench [options] [binaries...]\n");
+	printf ("  --runs N          recorded runs per binary (5)\n");
+	printf ("  --warmup N        runs per binary that are not recorded (1)\n");
+	printf ("  --threads N       job threads for the optimization and emission (1)\n");
+	printf ("  --json FILE       where the results are written (holodec-bench.json)\n");
+	printf ("  --label TEXT      stored in the results, e.g. the commit\n");
+	printf ("  --trace FILE      also record the counters and timed scopes as Chrome trace events\n");
+	printf ("  --memory          also record the resident set size and the memory of the binary after each stage\n");
+	printf ("  --workingdir DIR  directory of the corpus (workingdir)\n");
+	printf ("  --no-corpus       only run the given binaries\n");
+}
+
+int main (int argc, char** argv) {
+	BenchOptions options;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp (arg, "--runs") && hasValue) {
+			options.runs = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--warmup") && hasValue) {
+			options.warmup = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--threads") && hasValue) {
+			options.threads = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--json") && hasValue) {
+			options.json = argv[++i];
+		} else if (!strcmp (arg, "--label") && hasValue) {
+			options.label = argv[++i];
+		} else if (!strcmp (arg, "--trace") && hasValue) {
+			options.trace = argv[++i];
+		} else if (!strcmp (arg, "--memory")) {
+			options.memory = true;
+		} else if (!strcmp (arg, "--workingdir") && hasValue) {
+			options.workingdir = argv[++i];
+		} else if (!strcmp (arg, "--no-corpus")) {
+			options.corpus = false;
+		} else if (arg[0] == '-') {
+			printUsage();
+			return 1;
+		} else {
+			options.files.push_back (arg);
+		}
+	}
+	if (!options.runs || !options.threads) {
+		printUsage();
+		return 1;
+	}
+
+	HList<BenchInput> inputs;
+	if (options.corpus) {
+		for (const char* name : {"leo", "media", "media_unit_fw.hex"}) {
+			char path[1024];
+			snprintf (path, sizeof (path), "%s/%s", options.workingdir, name);
+			BenchInput input;
+			input.file = path;
+			inputs.push_back (input);
+		}
+	}
+	for (HString& file : options.files) {
+		BenchInput input;
+		input.file = file;
+		inputs.push_back (input);
+	}
+	if (inputs.empty()) {
+		printUsage();
+		return 1;
+	}
+
+	Main::initMain();
+	Main::g_main->registerFileFormat (&elffileformat);
+	Main::g_main->registerFileFormat (&ihexfileformat);
+	Main::g_main->registerArchitecture (&holox86::x86architecture);
+	Main::g_main->registerArchitecture (&holoavr::avrarchitecture);
+	holox86::x86architecture.init();
+	holoavr::avrarchitecture.init();
+
+	if (options.trace)
+		Profiler::get().enable();
+	JobController jobs (options.threads);
+	for (BenchInput& input : inputs) {
+		for (uint32_t run = 0; run < options.warmup + options.runs; run++) {
+			if (!runPipeline (&input, &jobs, options.threads, run >= options.warmup, options.memory))
+				break;
+		}
+	}
+	jobs.wait_for_exit();
+
+	FILE* file = fopen (options.json, "w");
+	if (!file) {
+		printf ("Cannot open output file %s\n", options.json);
+		return 1;
+	}
+	writeJson (file, options, inputs);
+	fclose (file);
+	printSummary (inputs);
+	if (options.trace) {
+		Profiler::get().printStats();
+		Profiler::get().writeTrace (options.trace);
+	}
+	return 0;
+}
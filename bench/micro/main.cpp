@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "General.h"
+#include "HIdList.h"
+#include "HString.h"
+#include "SSA.h"
+
+using namespace holodec;
+
+//times the core containers and the SSA primitives on synthetic data of growing size
+//every benchmark prints the time per operation for each size, the slope between two sizes is
+//log(t2/t1)/log(n2/n1): 0 if an operation costs the same for every size, 1 if it grows linearly with N
+
+typedef std::chrono::steady_clock MicroClock;
+
+static double secondsSince (MicroClock::time_point start) {
+	return std::chrono::duration<double> (MicroClock::now() - start).count();
+}
+
+//keeps the compiler from removing the benchmarked code
+static volatile uint64_t g_sink = 0;
+
+struct MicroTimer {
+	MicroClock::time_point start;
+	double seconds = 0.0;
+
+	void begin() {
+		start = MicroClock::now();
+	}
+	void end() {
+		seconds += secondsSince (start);
+	}
+};
+
+struct MicroBench {
+	const char* name;
+	size_t maxSize;//the benchmarks which are quadratic in N are not run above this size
+	//sets up the data for size n untimed and returns the number of operations done inside of the timer
+	uint64_t (*run) (size_t n, MicroTimer* timer);
+};
+
+struct IdElement {
+	HId id;
+	uint64_t value;
+};
+
+static uint64_t benchIdListGet (size_t n, MicroTimer* timer) {
+	HIdList<IdElement> list;
+	for (size_t i = 0; i < n; i++) {
+		IdElement element = {0, i};
+		list.push_back (element);
+	}
+	HList<HId> ids;
+	for (IdElement& element : list)
+		ids.push_back (element.id);
+	std::shuffle (ids.begin(), ids.end(), std::mt19937 (1));
+	uint64_t sum = 0;
+	timer->begin();
+	for (HId id : ids)
+		sum += list.get (id)->value;
+	timer->end();
+	g_sink += sum;
+	return ids.size();
+}
+
+//every other element is erased so the ids no longer match the positions and get has to search
+static uint64_t benchIdListGetSparse (size_t n, MicroTimer* timer) {
+	HIdList<IdElement> list;
+	for (size_t i = 0; i < n * 2; i++) {
+		IdElement element = {0, i};
+		list.push_back (element);
+	}
+	list.list.erase (std::remove_if (list.list.begin(), list.list.end(), [] (IdElement& element) {
+		return element.id % 2 == 0;
+	}), list.list.end());
+	HList<HId> ids;
+	for (IdElement& element : list)
+		ids.push_back (element.id);
+	std::shuffle (ids.begin(), ids.end(), std::mt19937 (1));
+	uint64_t sum = 0;
+	timer->begin();
+	for (HId id : ids)
+		sum += list.get (id)->value;
+	timer->end();
+	g_sink += sum;
+	return ids.size();
+}
+
+//a quarter of the elements is removed before the list is shrunk
+static uint64_t benchSparseIdListShrink (size_t n, MicroTimer* timer) {
+	HSparseIdList<IdElement> list;
+	for (size_t i = 0; i < n; i++) {
+		IdElement element = {0, i};
+		list.push_back (element);
+	}
+	std::mt19937 random (1);
+	for (size_t i = 0; i < n / 4; i++)
+		list.list[random() % n].id = 0;
+	uint64_t moved = 0;
+	timer->begin();
+	list.shrink ([&moved] (HId, HId) {
+		moved++;
+	});
+	timer->end();
+	g_sink += moved + list.size();
+	return n;
+}
+
+static uint64_t benchUniqueListInsert (size_t n, MicroTimer* timer) {
+	HList<uint64_t> values;
+	for (size_t i = 0; i < n; i++)
+		values.push_back (i % (n / 2 + 1));//every value is inserted about twice
+	std::shuffle (values.begin(), values.end(), std::mt19937 (1));
+	HUniqueList<uint64_t> list;
+	timer->begin();
+	for (uint64_t& value : values)
+		list.insert (value);
+	timer->end();
+	g_sink += list.size();
+	return n;
+}
+
+static uint64_t benchStringCreate (size_t n, MicroTimer* timer) {
+	HList<char> buffer (n * 32);
+	for (size_t i = 0; i < n; i++)
+		snprintf (&buffer[i * 32], 32, i % 2 ? "func_0x%zx" : "a_long_symbol_name_%zx", i);
+	HList<HString> strings;
+	strings.reserve (n);
+	timer->begin();
+	for (size_t i = 0; i < n; i++)
+		strings.push_back (HString (&buffer[i * 32]));
+	timer->end();
+	g_sink += strings.back().hash();
+	return n;
+}
+
+//compares every string with its neighbour and an equal copy
+static uint64_t benchStringCompare (size_t n, MicroTimer* timer) {
+	HList<HString> strings;
+	HList<HString> copies;
+	for (size_t i = 0; i < n; i++) {
+		char buffer[32];
+		snprintf (buffer, sizeof (buffer), i % 2 ? "func_0x%zx" : "a_long_symbol_name_%zx", i / 4);
+		strings.push_back (buffer);
+		copies.push_back (buffer);
+	}
+	uint64_t equal = 0;
+	timer->begin();
+	for (size_t i = 0; i < n; i++) {
+		equal += strings[i] == copies[i];
+		equal += strings[i] == strings[(i + 1) % n];
+	}
+	timer->end();
+	g_sink += equal;
+	return n * 2;
+}
+
+#define MICRO_BLOCK_SIZE (16)
+
+//n expressions in blocks of MICRO_BLOCK_SIZE, each block starts with an input
+//the other expressions add the two expressions before them
+static void buildSSA (SSARepresentation* ssaRep, size_t n) {
+	SSABB block;
+	for (size_t i = 0; i < n; i += MICRO_BLOCK_SIZE)
+		ssaRep->bbs.push_back (block);
+	for (size_t i = 0; i < n; i++) {
+		SSAExpression expr;
+		expr.exprtype = SSAType::eUInt;
+		expr.size = 32;
+		if (i % MICRO_BLOCK_SIZE == 0) {
+			expr.type = SSAExprType::eInput;
+		} else {
+			HList<HId>& exprIds = ssaRep->bbs.list[i / MICRO_BLOCK_SIZE].exprIds;
+			expr.type = SSAExprType::eOp;
+			expr.opType = SSAOpType::eAdd;
+			expr.subExpressions.push_back (SSAArgument::createId (exprIds.back(), 32));
+			if (exprIds.size() > 1)
+				expr.subExpressions.push_back (SSAArgument::createId (exprIds[exprIds.size() - 2], 32));
+			else
+				expr.subExpressions.push_back (SSAArgument::createUVal (i, 32));
+		}
+		ssaRep->addAtEnd (&expr, &ssaRep->bbs.list[i / MICRO_BLOCK_SIZE]);
+	}
+}
+
+//one expression is added in front of every other expression of a block
+static uint64_t benchSSAAddBefore (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildSSA (&ssaRep, n);
+	HList<std::pair<HId, HId>> positions;
+	for (SSABB& bb : ssaRep.bbs) {
+		for (size_t i = 1; i < bb.exprIds.size(); i += 2)
+			positions.push_back ({bb.exprIds[i], bb.id});
+	}
+	SSAExpression expr;
+	expr.type = SSAExprType::eUndef;
+	expr.exprtype = SSAType::eUInt;
+	expr.size = 32;
+	timer->begin();
+	for (std::pair<HId, HId>& position : positions)
+		ssaRep.addBefore (&expr, position.first, position.second);
+	timer->end();
+	g_sink += ssaRep.expressions.size();
+	return positions.size();
+}
+
+//the users are removed before the expressions they use so the references stay consistent
+static uint64_t benchSSARemoveExpr (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildSSA (&ssaRep, n);
+	HList<std::pair<HId, HId>> positions;
+	for (SSABB& bb : ssaRep.bbs) {
+		for (size_t i = bb.exprIds.size(); i > bb.exprIds.size() / 2; i--)
+			positions.push_back ({bb.exprIds[i - 1], bb.id});
+	}
+	timer->begin();
+	for (std::pair<HId, HId>& position : positions)
+		ssaRep.removeExpr (position.first, position.second);
+	timer->end();
+	g_sink += ssaRep.freeIds.size();
+	return positions.size();
+}
+
+//every second add is replaced by its first argument like the assignment simplifier does
+static uint64_t benchSSAReplaceNodes (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildSSA (&ssaRep, n);
+	HIdVector<SSAArgument> replacements (ssaRep.expressions.size());
+	for (SSAExpression& expr : ssaRep.expressions) {
+		if (expr.type == SSAExprType::eOp && expr.id % 2 == 0)
+			replacements.insert (expr.id, expr.subExpressions[0]);
+	}
+	timer->begin();
+	ssaRep.replaceNodes (&replacements);
+	timer->end();
+	g_sink += ssaRep.freeIds.size();
+	return replacements.size();
+}
+
+//one input is used by n expressions which are added after two inputs
+//the buildSSA expressions have at most two uses so this is the case that shows the cost per use
+static void buildManyUses (SSARepresentation* ssaRep, size_t n) {
+	SSABB block;
+	ssaRep->bbs.push_back (block);
+	SSABB* bb = &ssaRep->bbs.list[0];
+	SSAExpression input;
+	input.type = SSAExprType::eInput;
+	input.exprtype = SSAType::eUInt;
+	input.size = 32;
+	HId origId = ssaRep->addAtEnd (&input, bb);
+	ssaRep->addAtEnd (&input, bb);
+	for (size_t i = 0; i < n; i++) {
+		SSAExpression expr;
+		expr.type = SSAExprType::eOp;
+		expr.opType = SSAOpType::eAdd;
+		expr.exprtype = SSAType::eUInt;
+		expr.size = 32;
+		expr.subExpressions.push_back (SSAArgument::createId (origId, 32));
+		expr.subExpressions.push_back (SSAArgument::createUVal (i, 32));
+		ssaRep->addAtEnd (&expr, bb);
+	}
+}
+
+//all uses of the first input are replaced by the second input
+static uint64_t benchSSAReplaceAllUses (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildManyUses (&ssaRep, n);
+	SSABB* bb = &ssaRep.bbs.list[0];
+	timer->begin();
+	uint64_t count = ssaRep.replaceAllArgs (ssaRep.expressions[bb->exprIds[0]], SSAArgument::createId (bb->exprIds[1], 32));
+	timer->end();
+	g_sink += count;
+	return n;
+}
+
+//the uses of the first input are removed one by one in the order they were added
+static uint64_t benchSSARemoveUses (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildManyUses (&ssaRep, n);
+	SSABB* bb = &ssaRep.bbs.list[0];
+	timer->begin();
+	for (size_t i = 2; i < bb->exprIds.size(); i++) {
+		SSAExpression& expr = ssaRep.expressions[bb->exprIds[i]];
+		expr.removeArgument (&ssaRep, expr.subExpressions.begin());
+	}
+	timer->end();
+	g_sink += ssaRep.expressions[bb->exprIds[0]].refs.size();
+	return n;
+}
+
+static uint64_t benchSSACompress (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildSSA (&ssaRep, n);
+	//removes the last quarter of every block, which is above the ratio of compressIfSparse
+	for (SSABB& bb : ssaRep.bbs) {
+		size_t keep = bb.exprIds.size() - bb.exprIds.size() / 4;
+		while (bb.exprIds.size() > keep)
+			ssaRep.removeExpr (bb.exprIds, bb.exprIds.end() - 1);
+	}
+	timer->begin();
+	ssaRep.compress();
+	timer->end();
+	g_sink += ssaRep.expressions.size();
+	return n;
+}
+
+static uint64_t benchSSARecalcRefCounts (size_t n, MicroTimer* timer) {
+	SSARepresentation ssaRep;
+	buildSSA (&ssaRep, n);
+	timer->begin();
+	ssaRep.recalcRefCounts();
+	timer->end();
+	g_sink += ssaRep.expressions.size();
+	return n;
+}
+
+static MicroBench benchmarks[] = {
+	{"HIdList::get", (size_t) -1, benchIdListGet},
+	{"HIdList::get sparse", (size_t) -1, benchIdListGetSparse},
+	{"HSparseIdList::shrink", (size_t) -1, benchSparseIdListShrink},
+	{"HUniqueList::insert", 1 << 16, benchUniqueListInsert},
+	{"HString create", (size_t) -1, benchStringCreate},
+	{"HString compare", (size_t) -1, benchStringCompare},
+	{"SSA addBefore", (size_t) -1, benchSSAAddBefore},
+	{"SSA removeExpr", (size_t) -1, benchSSARemoveExpr},
+	{"SSA replaceNodes", (size_t) -1, benchSSAReplaceNodes},
+	{"SSA replaceAllArgs", (size_t) -1, benchSSAReplaceAllUses},
+	{"SSA removeArgument", (size_t) -1, benchSSARemoveUses},
+	{"SSA compress", (size_t) -1, benchSSACompress},
+	{"SSA recalcRefCounts", (size_t) -1, benchSSARecalcRefCounts},
+};
+
+struct MicroOptions {
+	size_t minSize = 1 << 10;
+	size_t maxSize = 1 << 18;
+	uint32_t runs = 5;
+	const char* filter = nullptr;
+};
+
+static void printUsage() {
+	printf ("Usage: holodec-microbench [options]\n");
+	printf ("  --min N           smallest size (1024)\n");
+	printf ("  --max N           largest size, the size is multiplied by 4 (262144)\n");
+	printf ("  --runs N          runs per size, the fastest one is reported (5)\n");
+	printf ("  --filter TEXT     only run the benchmarks containing TEXT\n");
+	printf ("  --list            print the names of the benchmarks\n");
+}
+
+int main (int argc, char** argv) {
+	MicroOptions options;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp (arg, "--min") && hasValue) {
+			options.minSize = (size_t) atoll (argv[++i]);
+		} else if (!strcmp (arg, "--max") && hasValue) {
+			options.maxSize = (size_t) atoll (argv[++i]);
+		} else if (!strcmp (arg, "--runs") && hasValue) {
+			options.runs = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--filter") && hasValue) {
+			options.filter = argv[++i];
+		} else if (!strcmp (arg, "--list")) {
+			for (MicroBench& bench : benchmarks)
+				printf ("%s\n", bench.name);
+			return 0;
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	if (!options.runs || options.minSize < MICRO_BLOCK_SIZE || options.maxSize < options.minSize) {
+		printUsage();
+		return 1;
+	}
+
+	printf ("Microbenchmark Results (ns/op, fastest of %" PRIu32 " runs)\n", options.runs);
+	for (MicroBench& bench : benchmarks) {
+		if (options.filter && !strstr (bench.name, options.filter))
+			continue;
+		printf ("%s\n", bench.name);
+		printIndent (1);
+		printf ("%12s %12s %8s\n", "N", "ns/op", "slope");
+		double lastTime = 0.0;
+		size_t lastSize = 0;
+		for (size_t n = options.minSize; n <= options.maxSize && n <= bench.maxSize; n *= 4) {
+			double best = 0.0;
+			for (uint32_t run = 0; run < options.runs; run++) {
+				MicroTimer timer;
+				uint64_t ops = bench.run (n, &timer);
+				double time = ops ? timer.seconds * 1e9 / ops : 0.0;
+				if (!run || time < best)
+					best = time;
+			}
+			printIndent (1);
+			if (lastSize && lastTime > 0.0 && best > 0.0)
+				printf ("%12zu %12.2f %8.2f\n", n, best, log (best / lastTime) / log ((double) n / lastSize));
+			else
+				printf ("%12zu %12.2f %8s\n", n, best, "");
+			lastTime = best;
+			lastSize = n;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "Binary.h"
+#include "arch/x86/X86FunctionAnalyzer.h"
+#include "arch/AvrFunctionAnalyzer.h"
+#include "Main.h"
+#include "Architecture.h"
+#include "SSAAddressToBlockTransformer.h"
+#include "SSAPhiNodeGenerator.h"
+#include "SSAAssignmentSimplifier.h"
+#include "SSAPeepholeOptimizer.h"
+#include "SSAConstPropagation.h"
+#include "SSAGlobalValueNumbering.h"
+#include "SSADCETransformer.h"
+#include "SSAApplyRegRef.h"
+#include "SSAPassManager.h"
+#include "SSATransformToC.h"
+#include "JobController.h"
+#include "MemoryAccounting.h"
+#include "SyntheticFunction.h"
+
+using namespace holodec;
+
+//runs synthetic functions of growing size through the ssa pipeline and reports the time of every
+//stage and the memory of the function for each size, the slope between two sizes is
+//log(t2/t1)/log(n2/n1): 1 for a stage that grows linearly with the number of blocks, above 1 it is super-linear
+
+typedef std::chrono::steady_clock ScaleClock;
+
+static double secondsSince (ScaleClock::time_point start) {
+	return std::chrono::duration<double> (ScaleClock::now() - start).count();
+}
+
+struct ScaleStage {
+	HString name;
+	HList<double> times;//seconds, the fastest run per size
+};
+
+struct ScaleSize {
+	uint32_t blocks;
+	uint64_t expressions;//after the lifting
+	uint64_t liftedBytes;
+	uint64_t setupBytes;
+	uint64_t optimizedBytes;
+	uint64_t peak;//peak resident set size of the process after the size was run
+};
+
+struct ScaleOptions {
+	uint32_t minBlocks = 256;
+	uint32_t maxBlocks = 16384;
+	uint32_t runs = 1;
+	const char* arch = nullptr;
+	SyntheticFunctionConfig config;
+};
+
+struct ScaleResults {
+	HList<ScaleStage> stages;//in pipeline order
+	HList<ScaleSize> sizes;
+
+	void addTime (HString name, size_t sizeIndex, double seconds) {
+		ScaleStage* stage = nullptr;
+		for (ScaleStage& existing : stages) {
+			if (existing.name == name)
+				stage = &existing;
+		}
+		if (!stage) {
+			stages.push_back ({name, {}});
+			stage = &stages.back();
+		}
+		if (stage->times.size() <= sizeIndex)
+			stage->times.resize (sizeIndex + 1, 0.0);
+		if (!stage->times[sizeIndex] || seconds < stage->times[sizeIndex])
+			stage->times[sizeIndex] = seconds;
+	}
+};
+
+//one run of the pipeline on a function with the given number of blocks
+static bool runSize (Architecture* arch, ScaleOptions& options, uint32_t blocks, size_t sizeIndex, ScaleResults* results) {
+	Binary binary ("synthetic");
+	binary.arch = arch;
+	const uint64_t baseaddr = 0x1000;
+	Symbol* symbol = new Symbol ({0, "synthetic", &SymbolType::symfunc, 0, baseaddr, 0});
+	binary.addSymbol (symbol);
+	Function* function = new Function();
+	function->symbolref = symbol->id;
+	function->baseaddr = baseaddr;
+	binary.addFunction (function);
+
+	SyntheticFunctionConfig config = options.config;
+	config.blocks = blocks;
+	SyntheticFunctionGenerator generator (arch, config);
+	auto start = ScaleClock::now();
+	if (!generator.generate (function)) {
+		printf ("Architecture %s has no general purpose registers\n", arch->name.cstr());
+		delete function;
+		delete symbol;
+		return false;
+	}
+	results->addTime ("generate", sizeIndex, secondsSince (start));
+	ScaleSize size = {blocks, function->ssaRep.expressions.size(), functionMemory (function).total(), 0, 0, 0};
+
+	SSAPassManager setupPasses (&binary);
+	setupPasses.addPass ("AddressToBlock", new SSAAddressToBlockTransformer());
+	setupPasses.addPass ("PhiNodeGenerator", new SSAPhiNodeGenerator());
+	SSAPassManager optimizerPasses (&binary);
+	optimizerPasses.addPass ("AssignmentSimplifier", new SSAAssignmentSimplifier());
+	optimizerPasses.addPass ("PeepholeOptimizer", new SSAPeepholeOptimizer());
+	optimizerPasses.addPass ("ConstPropagation", new SSAConstPropagation());
+	optimizerPasses.addPass ("GlobalValueNumbering", new SSAGlobalValueNumbering());
+	optimizerPasses.addPass ("DCE", new SSADCETransformer());
+	optimizerPasses.addPass ("ApplyRegRef", new SSAApplyRegRef(), true);
+	for (SSAPassManager* passManager : {&setupPasses, &optimizerPasses}) {
+		for (SSAPass& pass : passManager->passes)
+			pass.transformer->arch = arch;
+	}
+
+	setupPasses.run (function);
+	size.setupBytes = functionMemory (function).total();
+	optimizerPasses.runToFixpoint (function);
+	size.optimizedBytes = functionMemory (function).total();
+	//the passes run to a fixpoint so their time includes every round
+	for (SSAPassManager* passManager : {&setupPasses, &optimizerPasses}) {
+		for (SSAPass& pass : passManager->passes)
+			results->addTime (pass.name, sizeIndex, pass.stats.time);
+	}
+
+	JobController jobs (1);
+	HList<Function*> functions = {function};
+	start = ScaleClock::now();
+	SSACEmitter emitter (&binary, 1);
+	emitter.render (&jobs, functions);
+	results->addTime ("emit", sizeIndex, secondsSince (start));
+	jobs.wait_for_exit();
+	size.peak = peakRSS();
+
+	if (results->sizes.size() <= sizeIndex)
+		results->sizes.push_back (size);
+	else
+		results->sizes[sizeIndex].peak = size.peak;
+
+	for (SSAPassManager* passManager : {&setupPasses, &optimizerPasses}) {
+		for (SSAPass& pass : passManager->passes)
+			delete pass.transformer;
+	}
+	delete function;
+	delete symbol;
+	return true;
+}
+
+static void printSlope (double time, double lastTime, uint32_t size, uint32_t lastSize) {
+	if (lastSize && lastTime > 0.0 && time > 0.0)
+		printf (" %8.2f", log (time / lastTime) / log ((double) size / lastSize));
+	else
+		printf (" %8s", "");
+}
+
+static void printResults (ScaleResults& results) {
+	printf ("Scaling Results\n");
+	for (ScaleStage& stage : results.stages) {
+		printf ("%s\n", stage.name.cstr());
+		printIndent (1);
+		printf ("%10s %12s %12s %8s\n", "Blocks", "ms", "us/block", "slope");
+		for (size_t i = 0; i < stage.times.size(); i++) {
+			uint32_t blocks = results.sizes[i].blocks;
+			printIndent (1);
+			printf ("%10" PRIu32 " %12.3f %12.3f", blocks, stage.times[i] * 1000.0, stage.times[i] * 1e6 / blocks);
+			printSlope (stage.times[i], i ? stage.times[i - 1] : 0.0, blocks, i ? results.sizes[i - 1].blocks : 0);
+			printf ("\n");
+		}
+	}
+	//in bytes, see MemoryUsage for what is counted, the slope is the one of the optimized function
+	printf ("Memory\n");
+	printIndent (1);
+	printf ("%10s %12s %12s %12s %12s %12s %8s\n", "Blocks", "Expressions", "Lifted", "Setup", "Optimized", "Peak RSS", "slope");
+	for (size_t i = 0; i < results.sizes.size(); i++) {
+		ScaleSize& size = results.sizes[i];
+		printIndent (1);
+		printf ("%10" PRIu32 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64, size.blocks, size.expressions, size.liftedBytes, size.setupBytes, size.optimizedBytes, size.peak);
+		printSlope ((double) size.optimizedBytes, i ? (double) results.sizes[i - 1].optimizedBytes : 0.0, size.blocks, i ? results.sizes[i - 1].blocks : 0);
+		printf ("\n");
+	}
+}
+
+static void printUsage() {
+	printf ("Usage: holodec-scalebench [options]\n");
+	printf ("  --min N           smallest number of blocks (256)\n");
+	printf ("  --max N           largest number of blocks, the number is multiplied by 4 (16384)\n");
+	printf ("  --runs N          runs per size, the fastest one is reported (1)\n");
+	printf ("  --instructions N  instructions per block (6)\n");
+	printf ("  --registers N     general purpose registers that are used (8)\n");
+	printf ("  --loop-depth N    maximum nesting of loops (2)\n");
+	printf ("  --switch-fanout N targets of every switch, 0 for no switches (0)\n");
+	printf ("  --seed N          seed of the generator (1)\n");
+	printf ("  --arch NAME       architecture whose registers are used (the first one)\n");
+}
+
+int main (int argc, char** argv) {
+	ScaleOptions options;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp (arg, "--min") && hasValue) {
+			options.minBlocks = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--max") && hasValue) {
+			options.maxBlocks = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--runs") && hasValue) {
+			options.runs = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--instructions") && hasValue) {
+			options.config.instructions = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--registers") && hasValue) {
+			options.config.registers = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--loop-depth") && hasValue) {
+			options.config.loopDepth = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--switch-fanout") && hasValue) {
+			options.config.switchFanout = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--seed") && hasValue) {
+			options.config.seed = (uint32_t) atoi (argv[++i]);
+		} else if (!strcmp (arg, "--arch") && hasValue) {
+			options.arch = argv[++i];
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	if (!options.runs || !options.minBlocks || options.maxBlocks < options.minBlocks) {
+		printUsage();
+		return 1;
+	}
+
+	Main::initMain();
+	Main::g_main->registerArchitecture (&holox86::x86architecture);
+	Main::g_main->registerArchitecture (&holoavr::avrarchitecture);
+	holox86::x86architecture.init();
+	holoavr::avrarchitecture.init();
+	Architecture* arch = options.arch ? Main::g_main->getArchitecture (options.arch) : Main::g_main->architectures[0];
+	if (!arch) {
+		printf ("Unknown architecture %s\n", options.arch);
+		return 1;
+	}
+
+	printf ("Blocks %" PRIu32 "-%" PRIu32 " Instructions %" PRIu32 " Registers %" PRIu32 " Loop Depth %" PRIu32 " Switch Fanout %" PRIu32 " Architecture %s\n",
+	        options.minBlocks, options.maxBlocks, options.config.instructions, options.config.registers, options.config.loopDepth, options.config.switchFanout, arch->name.cstr());
+	ScaleResults results;
+	size_t sizeIndex = 0;
+	for (uint64_t blocks = options.minBlocks; blocks <= options.maxBlocks; blocks *= 4, sizeIndex++) {
+		for (uint32_t run = 0; run < options.runs; run++) {
+			if (!runSize (arch, options, (uint32_t) blocks, sizeIndex, &results))
+				return 1;
+		}
+		printf ("Finished %" PRIu64 " blocks\n", blocks);
+		fflush (stdout);
+	}
+	printResults (results);
+	return 0;
+}
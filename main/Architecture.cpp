@@ -1,4 +1,6 @@
 #include "Architecture.h"
+#include <algorithm>
+#include <assert.h>
 
 
 namespace holodec {
@@ -8,6 +10,7 @@ namespace holodec {
 			reg.parentRef.refId = getRegister(reg.parentRef)->id;
 			reg.directParentRef.refId = getRegister(reg.directParentRef)->id;
 		}
+		initRegSlices();
 		for (Stack& stack : stacks) {
 			stack.trackingReg.refId = getRegister(stack.trackingReg)->id;
 			stack.backingMem.refId = getMemory(stack.backingMem)->id;
@@ -43,6 +46,54 @@ namespace holodec {
 			}
 		}
 	}
+	void Architecture::initRegSlices() {
+		regSlices.clear();
+		parentRegs.clear();
+		parentSliceRegs.clear();
+		HId maxId = 0;
+		for (Register& reg : registers) {
+			if (reg.id > maxId)
+				maxId = reg.id;
+		}
+		regSlices.resize (maxId + 1);
+
+		HMap<HId, HList<Register*>> slicesPerParent;
+		for (Register& reg : registers) {
+			if (reg.id && reg.parentRef.refId)
+				slicesPerParent[reg.parentRef.refId].push_back (&reg);
+		}
+		for (auto& entry : slicesPerParent) {
+			HList<Register*>& slices = entry.second;
+			assert (slices.size() <= 64);
+			std::stable_sort (slices.begin(), slices.end(), [] (Register* lhs, Register* rhs) {
+				return lhs->size < rhs->size || (lhs->size == rhs->size && lhs->offset < rhs->offset);
+			});
+			uint32_t parentIndex = (uint32_t)parentRegs.size();
+			parentRegs.push_back (entry.first);
+			parentSliceRegs.emplace_back();
+			for (uint32_t i = 0; i < slices.size(); i++) {
+				RegisterSlice& slice = regSlices[slices[i]->id];
+				slice.parentId = entry.first;
+				slice.parentIndex = parentIndex;
+				slice.sliceIndex = i;
+				slice.offset = slices[i]->offset;
+				slice.size = slices[i]->size;
+				parentSliceRegs.back().push_back (slices[i]->id);
+			}
+			for (Register* reg : slices) {
+				RegisterSlice& slice = regSlices[reg->id];
+				for (Register* other : slices) {
+					RegisterSlice& otherSlice = regSlices[other->id];
+					if (slice.offset <= otherSlice.offset && otherSlice.offset + otherSlice.size <= slice.offset + slice.size)
+						slice.containsMask |= otherSlice.bit();
+					if (otherSlice.offset <= slice.offset && slice.offset + slice.size <= otherSlice.offset + otherSlice.size)
+						slice.containedMask |= otherSlice.bit();
+					if (slice.offset < otherSlice.offset + otherSlice.size && otherSlice.offset < slice.offset + slice.size)
+						slice.overlapMask |= otherSlice.bit();
+				}
+			}
+		}
+	}
 	
 
 }
@@ -44,12 +44,17 @@ namespace holodec {
 
 		HSparseIdList<IRExpression> irExpressions;
 
+		HList<RegisterSlice> regSlices;//indexed by register id
+		HList<HId> parentRegs;//top-level registers indexed by parentIndex
+		HList<HList<HId>> parentSliceRegs;//registers indexed by parentIndex and sliceIndex
+
 		Architecture() = default;
 		Architecture (Architecture&) = default;
 		Architecture (Architecture&&) = default;
 		~Architecture() = default;
 
 		void init();
+		void initRegSlices();
 
 		FunctionAnalyzer* createFunctionAnalyzer (Binary* binary) {
 			for (std::function<FunctionAnalyzer* (Binary*) >& fac : functionanalyzerfactories) {
@@ -63,10 +68,8 @@ namespace holodec {
 
 		Register* getRegister (const StringRef stringRef) {
 			if (stringRef.refId) {
-				for (Register& reg : registers) {
-					if (stringRef.refId == reg.id)
-						return &reg;
-				}
+				if (Register* reg = registers.get (stringRef.refId))
+					return reg;
 			}else if (stringRef.name){
 				for (Register& reg : registers) {
 					if (stringRef.name == reg.name)
@@ -75,12 +78,23 @@ namespace holodec {
 			}
 			return &invalidReg;
 		}
+		RegisterSlice* getRegSlice (HId regId) {
+			return regId && regId < regSlices.size() ? &regSlices[regId] : nullptr;
+		}
+		bool regContains (HId outerId, HId innerId) {
+			RegisterSlice* outer = getRegSlice (outerId);
+			RegisterSlice* inner = getRegSlice (innerId);
+			return outer && inner && outer->parentId == inner->parentId && (outer->containsMask & inner->bit());
+		}
+		bool regOverlaps (HId regId1, HId regId2) {
+			RegisterSlice* slice1 = getRegSlice (regId1);
+			RegisterSlice* slice2 = getRegSlice (regId2);
+			return slice1 && slice2 && slice1->parentId == slice2->parentId && (slice1->overlapMask & slice2->bit());
+		}
 		Stack* getStack (const StringRef stringRef) {
 			if (stringRef.refId) {
-				for (Stack& stack : stacks) {
-					if (stringRef.refId == stack.id)
-						return &stack;
-				}
+				if (Stack* stack = stacks.get (stringRef.refId))
+					return stack;
 			}else if (stringRef.name){
 				for (Stack& stack : stacks) {
 					if (stringRef.name == stack.name)
@@ -91,10 +105,8 @@ namespace holodec {
 		}
 		Memory* getMemory(const StringRef stringRef) {
 			if (stringRef.refId) {
-				for (Memory& memory : memories) {
-					if (stringRef.refId == memory.id)
-						return &memory;
-				}
+				if (Memory* memory = memories.get (stringRef.refId))
+					return memory;
 			}
 			else if (stringRef.name) {
 				for (Memory& memory : memories) {
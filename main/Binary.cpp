@@ -55,6 +55,7 @@ namespace holodec {
 		return nullptr;
 	}
 	HId Binary::addFunction (Function* function) {
+		functionsByAddr[function->baseaddr] = function;
 		return functions.push_back (function);
 	}
 	Function* Binary::getFunction (HString name) {
@@ -69,6 +70,12 @@ namespace holodec {
 		return functions[id];
 	}
 	Function* Binary::getFunctionByAddr(uint64_t addr) {
+		auto it = functionsByAddr.find(addr);
+		if (it != functionsByAddr.end())
+			return it->second;
+		if (functionsByAddr.size() == functions.size())
+			return nullptr;
+		//some functions were not added with addFunction
 		for (Function* func : functions) {
 			if (func->baseaddr == addr)
 				return func;
@@ -76,6 +76,7 @@ namespace holodec {
 
 		HList<HId> entrypoints;
 		HIdPtrList<Function*> functions;
+		HMap<uint64_t, Function*> functionsByAddr;//functions added with addFunction indexed by their base address
 		HIdPtrList<DynamicLibrary*> dynamic_libraries;
 
 		HIdPtrList<Symbol*> symbols;
@@ -2,6 +2,7 @@
 
 #include "Architecture.h"
 #include "Main.h"
+#include "MemoryAccounting.h"
 
 extern "C" {
 #include "CHolodec.h"
@@ -18,6 +19,36 @@ extern "C" {
 	uint64_t holodec_get_archcount (void) {
 		return holodec::Main::g_main->architectures.size();
 	}
+	uint64_t holodec_get_current_rss (void) {
+		return holodec::currentRSS();
+	}
+	uint64_t holodec_get_peak_rss (void) {
+		return holodec::peakRSS();
+	}
+
+	static uint64_t memory_get_category (const holodec::MemoryUsage& usage, HMemoryCategory category) {
+		switch (category) {
+		case MEMORY_INSTRUCTIONS:
+			return usage.instructions;
+		case MEMORY_SSA:
+			return usage.ssa;
+		case MEMORY_STRINGS:
+			return usage.strings;
+		case MEMORY_OBJECTS:
+			return usage.objects;
+		case MEMORY_DATA:
+			return usage.data;
+		case MEMORY_TOTAL:
+			return usage.total();
+		}
+		return 0;
+	}
+	uint64_t binary_get_memory (HBinary* binary, HMemoryCategory category) {
+		return memory_get_category (holodec::binaryMemory (reinterpret_cast<holodec::Binary*> (binary)), category);
+	}
+	uint64_t function_get_memory (HFunction* function, HMemoryCategory category) {
+		return memory_get_category (holodec::functionMemory (reinterpret_cast<holodec::Function*> (function)), category);
+	}
 
 	const char* arch_get_name (HArchitecture* arch) {
 		return reinterpret_cast<holodec::Architecture*> (arch)->name.cstr();
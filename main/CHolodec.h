@@ -41,6 +41,10 @@ HArchitecture* holodec_get_arch (uint64_t index);
 HArchitecture* holodec_get_arch_by_name (const char* name);
 uint64_t holodec_get_archcount (void);
 
+//resident set size of the process in bytes
+uint64_t holodec_get_current_rss (void);
+uint64_t holodec_get_peak_rss (void);
+
 const char* arch_get_name (HArchitecture* arch);
 const char* arch_get_description (HArchitecture* arch);
 uint64_t arch_get_bitbase (HArchitecture* arch);
@@ -63,6 +67,9 @@ HInstrDefinition* arch_get_instrdef_by_id (HArchitecture* arch, HId index);
 uint64_t arch_get_instrdefcount (HArchitecture* arch);
 
 
+//heap bytes of the binary including its functions and of a single function
+uint64_t binary_get_memory (HBinary* binary, HMemoryCategory category);
+uint64_t function_get_memory (HFunction* function, HMemoryCategory category);
 
 HSSABB* ssa_get_block (HSSARepresentation* rep, uint64_t index);
 HSSABB* ssa_get_block_by_id (HSSARepresentation* rep, HId id);
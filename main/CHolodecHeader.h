@@ -205,6 +205,15 @@ enum HSSAType {
 	SSA_TYPE_MEMACCESS,
 };
 
+enum HMemoryCategory {
+	MEMORY_INSTRUCTIONS = 0,
+	MEMORY_SSA,
+	MEMORY_STRINGS,
+	MEMORY_OBJECTS,
+	MEMORY_DATA,
+	MEMORY_TOTAL
+};
+
 typedef struct {
 	HId refId;
 	HId index;
@@ -0,0 +1,224 @@
+#include "CallGraph.h"
+#include "Function.h"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace holodec {
+
+	uint32_t CallGraph::addFunction (Function* function) {
+		auto it = nodesByAddr.find (function->baseaddr);
+		if (it != nodesByAddr.end())
+			return it->second;
+		uint32_t node = nodes.size();
+		nodes.push_back (function);
+		nodesByAddr[function->baseaddr] = node;
+		dirty = true;
+		return node;
+	}
+	void CallGraph::addCalls (Function* function) {
+		for (uint64_t addr : function->funcsCalled)
+			addCall (function, addr);
+	}
+	void CallGraph::addCall (Function* caller, uint64_t calleeAddr) {
+		calls.push_back (std::make_pair (addFunction (caller), calleeAddr));
+		dirty = true;
+	}
+
+	Function* CallGraph::getFunction (uint64_t addr) {
+		auto it = nodesByAddr.find (addr);
+		return it != nodesByAddr.end() ? nodes[it->second] : nullptr;
+	}
+	int64_t CallGraph::getNode (Function* function) {
+		auto it = nodesByAddr.find (function->baseaddr);
+		return it != nodesByAddr.end() ? it->second : -1;
+	}
+
+	bool CallGraph::isRecursive (Function* function) {
+		update();
+		int64_t node = getNode (function);
+		if (node < 0)
+			return false;
+		uint32_t scc = sccOf[node];
+		if (sccOffsets[scc + 1] - sccOffsets[scc] > 1)
+			return true;
+		for (uint32_t i = calleeOffsets[node]; i < calleeOffsets[node + 1]; i++) {
+			if (callees[i] == node)
+				return true;
+		}
+		return false;
+	}
+
+	void CallGraph::update() {
+		if (!dirty && calleeOffsets.size() == nodes.size() + 1)
+			return;
+		dirty = false;
+		size_t n = nodes.size();
+
+		//resolve the addresses and remove duplicate calls
+		HList<std::pair<uint32_t, uint32_t>> edges;
+		edges.reserve (calls.size());
+		for (std::pair<uint32_t, uint64_t>& call : calls) {
+			auto it = nodesByAddr.find (call.second);
+			if (it != nodesByAddr.end())
+				edges.push_back (std::make_pair (call.first, it->second));
+		}
+		std::sort (edges.begin(), edges.end());
+		edges.erase (std::unique (edges.begin(), edges.end()), edges.end());
+
+		calleeOffsets.assign (n + 1, 0);
+		callerOffsets.assign (n + 1, 0);
+		for (std::pair<uint32_t, uint32_t>& edge : edges) {
+			calleeOffsets[edge.first + 1]++;
+			callerOffsets[edge.second + 1]++;
+		}
+		for (size_t i = 0; i < n; i++) {
+			calleeOffsets[i + 1] += calleeOffsets[i];
+			callerOffsets[i + 1] += callerOffsets[i];
+		}
+		callees.resize (edges.size());
+		callers.resize (edges.size());
+		HList<uint32_t> callerFill (callerOffsets.begin(), callerOffsets.end() - 1);
+		for (size_t i = 0; i < edges.size(); i++) {
+			callees[i] = edges[i].second;//edges are sorted by the caller
+			callers[callerFill[edges[i].second]++] = edges[i].first;
+		}
+		buildSCCs();
+	}
+
+	void CallGraph::buildSCCs() {
+		//iterative version of Tarjan's algorithm
+		//components are completed callees first which already is the bottom-up order
+		size_t n = nodes.size();
+		const uint32_t unvisited = (uint32_t) - 1;
+		HList<uint32_t> index (n, unvisited);
+		HList<uint32_t> lowlink (n, 0);
+		HList<bool> onStack (n, false);
+		HList<uint32_t> stack;
+		HList<std::pair<uint32_t, uint32_t>> callStack;//node and position in its callees
+		uint32_t counter = 0;
+
+		sccOf.assign (n, 0);
+		sccOffsets.assign (1, 0);
+		sccNodes.clear();
+		sccNodes.reserve (n);
+		for (uint32_t root = 0; root < n; root++) {
+			if (index[root] != unvisited)
+				continue;
+			callStack.push_back (std::make_pair (root, calleeOffsets[root]));
+			index[root] = lowlink[root] = counter++;
+			stack.push_back (root);
+			onStack[root] = true;
+			while (!callStack.empty()) {
+				uint32_t node = callStack.back().first;
+				uint32_t& pos = callStack.back().second;
+				if (pos < calleeOffsets[node + 1]) {
+					uint32_t callee = callees[pos++];
+					if (index[callee] == unvisited) {
+						index[callee] = lowlink[callee] = counter++;
+						stack.push_back (callee);
+						onStack[callee] = true;
+						callStack.push_back (std::make_pair (callee, calleeOffsets[callee]));
+					} else if (onStack[callee]) {
+						lowlink[node] = std::min (lowlink[node], index[callee]);
+					}
+					continue;
+				}
+				callStack.pop_back();
+				if (!callStack.empty()) {
+					uint32_t parent = callStack.back().first;
+					lowlink[parent] = std::min (lowlink[parent], lowlink[node]);
+				}
+				if (lowlink[node] != index[node])
+					continue;
+				uint32_t scc = sccOffsets.size() - 1;
+				uint32_t member;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					sccOf[member] = scc;
+					sccNodes.push_back (member);
+				} while (member != node);
+				sccOffsets.push_back (sccNodes.size());
+			}
+		}
+	}
+
+	void CallGraph::runBottomUp (JobController* jobController, HList<Function*>& functions, std::function<void (HList<Function*>&, JobContext) > func) {
+		JobGroup group;
+		queueBottomUp (jobController, functions, func, {}, &group);
+		jobController->wait (&group);
+	}
+	void CallGraph::queueBottomUp (JobController* jobController, HList<Function*>& functions, std::function<void (HList<Function*>&, JobContext) > func,
+		const std::vector<JobHandle>& dependencies, JobGroup* group, HMap<Function*, JobHandle>* tasks,
+		HMap<Function*, JobHandle>* memberDependencies) {
+		update();
+		size_t sccs = sccOffsets.size() - 1;
+
+		HList<bool> selected (nodes.size(), false);
+		for (Function* function : functions) {
+			int64_t node = getNode (function);
+			if (node >= 0)
+				selected[node] = true;
+		}
+		//shared by the tasks, which may outlive the call
+		std::shared_ptr<std::function<void (HList<Function*>&, JobContext)>> sharedFunc = std::make_shared<std::function<void (HList<Function*>&, JobContext)>> (std::move (func));
+		//the components are in bottom-up order so the tasks of the called components already exist
+		//a task can finish before its callers are wired up, add_dependency then skips it
+		HList<JobHandle> sccTasks (sccs);
+		HList<uint32_t> lastDependent (sccs, (uint32_t) - 1);
+		for (uint32_t scc = 0; scc < sccs; scc++) {
+			HList<Function*> members;
+			for (uint32_t i = sccOffsets[scc]; i < sccOffsets[scc + 1]; i++) {
+				if (selected[sccNodes[i]])
+					members.push_back (nodes[sccNodes[i]]);
+			}
+			JobHandle task = jobController->create_task ([sharedFunc, members] (JobContext context) mutable {
+				if (!members.empty())
+					(*sharedFunc) (members, context);
+			}, group);
+			for (const JobHandle& dependency : dependencies)
+				jobController->add_dependency (task, dependency);
+			if (memberDependencies) {
+				for (Function* member : members) {
+					auto it = memberDependencies->find (member);
+					if (it != memberDependencies->end())
+						jobController->add_dependency (task, it->second);
+				}
+			}
+			for (uint32_t i = sccOffsets[scc]; i < sccOffsets[scc + 1]; i++) {
+				uint32_t node = sccNodes[i];
+				for (uint32_t j = calleeOffsets[node]; j < calleeOffsets[node + 1]; j++) {
+					uint32_t calleeScc = sccOf[callees[j]];
+					if (calleeScc == scc || lastDependent[calleeScc] == scc)
+						continue;
+					lastDependent[calleeScc] = scc;
+					assert (calleeScc < scc);
+					jobController->add_dependency (task, sccTasks[calleeScc]);
+				}
+			}
+			jobController->submit (task);
+			sccTasks[scc] = task;
+			if (tasks) {
+				for (Function* member : members)
+					(*tasks)[member] = task;
+			}
+		}
+	}
+
+	void CallGraph::print (int indent) {
+		update();
+		printIndent (indent);
+		printf ("Call Graph %zu Functions %zu Calls %zu SCCs\n", nodes.size(), callees.size(), sccOffsets.size() - 1);
+		for (size_t scc = 0; scc + 1 < sccOffsets.size(); scc++) {
+			printIndent (indent + 1);
+			printf ("SCC %zu: ", scc);
+			for (uint32_t i = sccOffsets[scc]; i < sccOffsets[scc + 1]; i++) {
+				printf ("0x%" PRIx64 ", ", nodes[sccNodes[i]]->baseaddr);
+			}
+			printf ("\n");
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include "General.h"
+#include "JobController.h"
+
+#include <functional>
+
+namespace holodec {
+
+	struct Function;
+
+	//call graph over the functions of a binary
+	//calls are collected as they are discovered and the adjacency and the strongly connected components
+	//are rebuilt on the next query after a change
+	struct CallGraph {
+		HList<Function*> nodes;//indexed by node
+		HMap<uint64_t, uint32_t> nodesByAddr;
+		HList<std::pair<uint32_t, uint64_t>> calls;//caller node and callee address, the callee may not be added yet
+		bool dirty = false;
+
+		//compressed sparse rows, the edges of node i are at [offsets[i], offsets[i + 1])
+		HList<uint32_t> calleeOffsets;
+		HList<uint32_t> callees;
+		HList<uint32_t> callerOffsets;
+		HList<uint32_t> callers;
+
+		//strongly connected components in bottom-up order, every component comes after all components it calls
+		HList<uint32_t> sccOf;//indexed by node
+		HList<uint32_t> sccOffsets;
+		HList<uint32_t> sccNodes;
+
+		uint32_t addFunction (Function* function);
+		//adds the calls in funcsCalled of the function
+		void addCalls (Function* function);
+		void addCall (Function* caller, uint64_t calleeAddr);
+
+		Function* getFunction (uint64_t addr);
+		int64_t getNode (Function* function);
+
+		void update();
+
+		//the function is part of a cycle in the call graph
+		bool isRecursive (Function* function);
+
+		size_t sccCount() {
+			update();
+			return sccOffsets.size() - 1;
+		}
+
+		//calls func for every strongly connected component after all components called by it were handled
+		//components which do not depend on each other are handled in parallel by the job threads
+		//only functions in the given list are passed to func
+		void runBottomUp (JobController* jobController, HList<Function*>& functions, std::function<void (HList<Function*>&, JobContext) > func);
+		//queues a task per component that calls func after the tasks of the called components and the dependencies are finished
+		//the task of a component also waits for the entries of its members in memberDependencies
+		//the task of the component of every function in the list is added to tasks
+		void queueBottomUp (JobController* jobController, HList<Function*>& functions, std::function<void (HList<Function*>&, JobContext) > func,
+			const std::vector<JobHandle>& dependencies, JobGroup* group, HMap<Function*, JobHandle>* tasks = nullptr,
+			HMap<Function*, JobHandle>* memberDependencies = nullptr);
+
+		void print (int indent = 0);
+
+	private:
+		void buildSCCs();
+	};
+
+}
+
+#endif // CALLGRAPH_H
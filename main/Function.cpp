@@ -39,14 +39,16 @@ void holodec::Function::print(holodec::Architecture* arch, int indent) {
 void holodec::FuncRegState::print(holodec::Architecture* arch, int indent) {
 	printIndent(indent);
 	printf("RegisterState\n");
-	for (RegisterState& regState : states) {
+	if (!parsed)
+		return;
+	const char* names[] = {"Reads", "Writes", "Clobbers"};
+	HIdBitSet* sets[] = {&reads, &writes, &clobbers};
+	for (int i = 0; i < 3; i++) {
 		printIndent(indent + 1);
-		printf("%s ", arch->getRegister(regState.regId)->name.cstr());
-		if (regState.flags.contains(RegisterUsedFlag::eWrite)) {
-			printf("Write, ");
-		}
-		if (regState.flags.contains(RegisterUsedFlag::eRead)) {
-			printf("Read, ");
+		printf("%s: ", names[i]);
+		for (uint32_t parentIndex = 0; parentIndex < arch->parentRegs.size(); parentIndex++) {
+			if (sets[i]->contains(parentIndex))
+				printf("%s, ", arch->getRegister(arch->parentRegs[parentIndex])->name.cstr());
 		}
 		printf("\n");
 	}
@@ -2,6 +2,7 @@
 #define H_FUNCTION_H
 
 #include "General.h"
+#include "HIdList.h"
 #include "Section.h"
 #include "InstrDefinition.h"
 
@@ -64,38 +65,25 @@ namespace holodec {
 			}
 		}
 	};
-	// Unknown -> FunctionRead
-	enum class RegisterUsedFlag{
-		eNone	= 0x0,
-		eWrite	= 0x1,
-		eRead	= 0x2,
-		eArithmeticChange = 0x4,
-	};
-	struct RegisterState{
-		HId regId;
-		Flags<RegisterUsedFlag> flags;
-		int64_t arithChange = 0;
-	};
+	//usage of the top-level registers by a function including the functions it calls
+	//the bits of the sets are parentIndices
 	struct FuncRegState {
-		HList<RegisterState> states;
+		HIdBitSet reads;//the value at the entry of the function is used
+		HIdBitSet writes;//the value at a return may differ from the value at the entry
+		HIdBitSet clobbers;//the register is changed at some point even if it is restored before returning
 		bool parsed = false;
 
-		RegisterState* getRegisterState(HId regId) {
-
-			for (RegisterState& regState : states) {
-				if (regState.regId == regId)
-					return &regState;
-			}
-			return nullptr;
+		bool operator== (const FuncRegState& other) const {
+			return parsed == other.parsed && reads == other.reads && writes == other.writes && clobbers == other.clobbers;
 		}
-		RegisterState* getNewRegisterState(HId regId) {
-
-			for (RegisterState& regState : states) {
-				if (regState.regId == regId)
-					return &regState;
-			}
-			states.push_back({ regId, {}, 0 });
-			return &states.back();
+		bool operator!= (const FuncRegState& other) const {
+			return !(*this == other);
+		}
+		void clear() {
+			reads.clear();
+			writes.clear();
+			clobbers.clear();
+			parsed = false;
 		}
 		void print(Architecture* arch, int indent = 0);
 	};
@@ -112,6 +100,9 @@ namespace holodec {
 		HIdList<DisAsmBasicBlock> basicblocks;
 		HIdList<JumpTable> jumptables;
 		SSARepresentation ssaRep;
+		//the parent registers read before they are written, known once the blocks of the function are connected
+		HIdBitSet liveInRegs;
+		bool liveInKnown = false;
 
 		HSet<uint64_t> addrToAnalyze;
 		
@@ -149,6 +140,8 @@ namespace holodec {
 			symbolref = 0;
 			basicblocks.clear();
 			ssaRep.clear();
+			liveInRegs.clear();
+			liveInKnown = false;
 		}
 
 		void print(Architecture* arch, int indent = 0);
@@ -1,6 +1,9 @@
 #include "FunctionAnalyzer.h"
+#include "HoloIO.h"
+#include "Profiler.h"
 #include "Binary.h"
 #include <assert.h>
+#include <chrono>
 
 holodec::FunctionAnalyzer::FunctionAnalyzer (Architecture* arch) : arch (arch), binary (0), ssaGen (arch) {
 }
@@ -12,7 +15,15 @@ bool holodec::FunctionAnalyzer::postInstruction (Instruction* instruction) {
 	/*if (state.function->findBasicBlockDeep (instruction->addr + instruction->size))
 		return false;*/
 	state.instructions.push_back (*instruction);
-	if (analyzeWithIR && ssaGen.parseInstruction(instruction)) {
+	stats.instructions++;
+	HPROFILE_COUNT (eInstructionsDecoded, 1);
+	bool lifted = false;
+	if (analyzeWithIR) {
+		auto start = std::chrono::steady_clock::now();
+		lifted = ssaGen.parseInstruction(instruction);
+		stats.liftTime += std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+	}
+	if (lifted) {
 		if (ssaGen.endOfBlock) {
 			if (instruction->jumpdest)
 				addAddressToAnalyze (instruction->jumpdest);
@@ -86,24 +97,32 @@ bool holodec::FunctionAnalyzer::trySplitBasicBlock (uint64_t splitaddr) {
 }
 void holodec::FunctionAnalyzer::addAddressToAnalyze (uint64_t addr) {
 	if (std::find (state.function->addrToAnalyze.begin(), state.function->addrToAnalyze.end(), addr) == state.function->addrToAnalyze.end()) {
-		printf ("Add Address for Analyze 0x%" PRIx64 "\n", addr);
+		HLOG_TRACE (g_analyzer_logger, "Add Address for Analyze 0x%" PRIx64, addr);
 		state.function->addrToAnalyze.insert (addr);
 	}
 }
 
 void holodec::FunctionAnalyzer::preAnalysis() {
-	printf ("Pre Analysis\n");
+	HLOG_DEBUG (g_analyzer_logger, "Pre Analysis");
 }
 void holodec::FunctionAnalyzer::postAnalysis() {
-	printf ("Post Analysis\n");
+	HLOG_DEBUG (g_analyzer_logger, "Post Analysis");
 }
 
 bool holodec::FunctionAnalyzer::analyzeFunction (Function* function) {
+	HPROFILE_SCOPE ("analyzeFunction", "addr", function->baseaddr);
+	auto start = std::chrono::steady_clock::now();
+	bool analyzed = analyzeBlocks (function);
+	stats.functions++;
+	stats.time += std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+	return analyzed;
+}
+bool holodec::FunctionAnalyzer::analyzeBlocks (Function* function) {
 	state.reset();
 	state.function = function;
 	Symbol* functionsymbol = binary->getSymbol (function->symbolref);
-	printf ("Analyzing Function %s\n", functionsymbol->name.cstr());
-	printf ("At Address 0x%" PRIx64 "\n", functionsymbol->vaddr);
+	HLOG_DEBUG (g_analyzer_logger, "Analyzing Function %s", functionsymbol->name.cstr());
+	HLOG_DEBUG (g_analyzer_logger, "At Address 0x%" PRIx64, functionsymbol->vaddr);
 
 	preAnalysis();
 
@@ -13,12 +13,20 @@ namespace holodec {
 	struct Architecture;
 	struct Binary;
 
+	struct FunctionAnalyzerStats {
+		uint64_t functions = 0;
+		uint64_t instructions = 0;
+		double time = 0.0;//wall time in seconds spent in analyzeFunction
+		double liftTime = 0.0;//part of time spent lifting the instructions into SSA, the rest is decoding
+	};
+
 	struct FunctionAnalyzer {
 		Architecture* arch;
 		Binary* binary;
 		SSAGen ssaGen;
 		
 		bool analyzeWithIR = true;
+		FunctionAnalyzerStats stats;
 
 		struct {
 			size_t maxInstr;
@@ -55,6 +63,8 @@ namespace holodec {
 		virtual void preAnalysis();
 
 		virtual bool analyzeFunction (Function* function);
+		//analyzeFunction without the timing
+		bool analyzeBlocks (Function* function);
 		virtual bool analyzeInsts (uint64_t addr) = 0;
 
 		virtual void postAnalysis();
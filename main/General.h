@@ -6,6 +6,9 @@
 #include <vector>
 #include <set>
 #include <map>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "HString.h"
 #include "CHolodecHeader.h"
@@ -30,6 +33,23 @@ namespace holodec {
 	template <typename Key, typename Value>
 	using HMap = std::map<Key, Value>;
 
+	inline uint32_t lowestBitIndex (uint64_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64 (&index, mask);
+		return index;
+#else
+		return __builtin_ctzll (mask);
+#endif
+	}
+	inline uint32_t bitCount (uint64_t mask) {
+#ifdef _MSC_VER
+		return (uint32_t) __popcnt64 (mask);
+#else
+		return __builtin_popcountll (mask);
+#endif
+	}
+
 	enum class Endianess {
 		eLittle,
 		eBig
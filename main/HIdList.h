@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <functional>
+#include <algorithm>
 
 #include "General.h"
 
@@ -74,15 +75,15 @@ namespace holodec {
 					return &val;
 			}
 			
-			while(lowerbound <= upperbound) {// binary seach
-				HId middle = lowerbound + ((upperbound - lowerbound) / 2);
+			while(lowerbound < upperbound) {// binary seach
+				size_t middle = lowerbound + ((upperbound - lowerbound) / 2);
 				HId middleId = list[middle].id;
 				if(middleId == id)
 					return &(list[middle]);
 				if(middleId < id)
 					lowerbound = middle + 1;
 				else
-					upperbound = middle - 1;
+					upperbound = middle;
 			}
 			return nullptr;
 		}
@@ -144,15 +145,15 @@ namespace holodec {
 					return &val;
 			}
 			
-			while(lowerbound <= upperbound) {// binary seach
-				int middle = lowerbound + ((upperbound - lowerbound) / 2);
+			while(lowerbound < upperbound) {// binary seach
+				size_t middle = lowerbound + ((upperbound - lowerbound) / 2);
 				HId middleId = list[middle]->id;
 				if(middleId == id)
 					return &(list[middle]);
 				if(middleId < id)
 					lowerbound = middle + 1;
 				else
-					upperbound = middle - 1;
+					upperbound = middle;
 			}
 			return nullptr;
 		}
@@ -210,6 +211,117 @@ namespace holodec {
 
 	};
 	
+	/**
+	 * Dense set of ids backed by one bit per id
+	 * Grows on insert so the size passed in is only a hint
+	 */
+	struct HIdBitSet {
+		HList<uint64_t> words;
+
+		HIdBitSet() {}
+		HIdBitSet (size_t maxId) {
+			resize (maxId);
+		}
+
+		void resize (size_t maxId) {
+			words.resize ((maxId / 64) + 1, 0);
+		}
+		void insert (HId id) {
+			if (id / 64 >= words.size())
+				resize (id);
+			words[id / 64] |= (uint64_t) 1 << (id % 64);
+		}
+		void erase (HId id) {
+			if (id / 64 < words.size())
+				words[id / 64] &= ~((uint64_t) 1 << (id % 64));
+		}
+		bool contains (HId id) const {
+			return id / 64 < words.size() && ((words[id / 64] >> (id % 64)) & 1);
+		}
+		size_t count() const {
+			size_t count = 0;
+			for (uint64_t word : words)
+				count += bitCount (word);
+			return count;
+		}
+		bool empty() const {
+			for (uint64_t word : words)
+				if (word)
+					return false;
+			return true;
+		}
+		void clear() {
+			std::fill (words.begin(), words.end(), 0);
+		}
+		//returns true if a bit was added
+		bool unite (const HIdBitSet& other) {
+			if (other.words.size() > words.size())
+				words.resize (other.words.size(), 0);
+			uint64_t added = 0;
+			for (size_t i = 0; i < other.words.size(); i++) {
+				added |= other.words[i] & ~words[i];
+				words[i] |= other.words[i];
+			}
+			return added != 0;
+		}
+		void subtract (const HIdBitSet& other) {
+			for (size_t i = 0; i < words.size() && i < other.words.size(); i++)
+				words[i] &= ~other.words[i];
+		}
+		bool operator== (const HIdBitSet& other) const {
+			size_t size = std::max (words.size(), other.words.size());
+			for (size_t i = 0; i < size; i++) {
+				if ((i < words.size() ? words[i] : 0) != (i < other.words.size() ? other.words[i] : 0))
+					return false;
+			}
+			return true;
+		}
+		bool operator!= (const HIdBitSet& other) const {
+			return !(*this == other);
+		}
+	};
+
+	/**
+	 * Map from id to value backed by a vector indexed by the id
+	 * ids keeps the insertion order for iteration
+	 */
+	template<typename T>
+	struct HIdVector {
+		HList<T> values;
+		HIdBitSet keys;
+		HList<HId> ids;
+
+		HIdVector() {}
+		HIdVector (size_t maxId) : values (maxId + 1), keys (maxId) {}
+
+		void insert (HId id, const T& value) {
+			if (id >= values.size())
+				values.resize (id + 1);
+			if (!keys.contains (id)) {
+				keys.insert (id);
+				ids.push_back (id);
+			}
+			values[id] = value;
+		}
+		T* get (HId id) {
+			return keys.contains (id) ? &values[id] : nullptr;
+		}
+		bool contains (HId id) const {
+			return keys.contains (id);
+		}
+		size_t size() const {
+			return ids.size();
+		}
+		bool empty() const {
+			return ids.empty();
+		}
+		void clear() {
+			for (HId id : ids)
+				keys.erase (id);
+			ids.clear();
+		}
+	};
+
 	template<typename T>
 	class HSparseIdList {
 		typedef typename std::vector<T>::iterator iterator;
@@ -0,0 +1,53 @@
+#ifndef HSTRINGBUILDER_H
+#define HSTRINGBUILDER_H
+
+#include <string>
+#include <charconv>
+#include <stdio.h>
+
+namespace holodec {
+
+	//appends text and numbers to a growing buffer without going through the locale aware printf machinery
+	struct HStringBuilder {
+		std::string buffer;
+
+		void append (const char* str) {
+			buffer.append (str);
+		}
+		void append (const char* str, size_t length) {
+			buffer.append (str, length);
+		}
+		void append (char c) {
+			buffer.push_back (c);
+		}
+		template<typename T>
+		void appendNumber (T value, int base = 10) {
+			char tmp[72];
+			std::to_chars_result result = std::to_chars (tmp, tmp + sizeof (tmp), value, base);
+			buffer.append (tmp, result.ptr - tmp);
+		}
+		//the same digits as printf("%.*f")
+		void appendFloat (double value, int precision = 6) {
+			char tmp[512];
+			std::to_chars_result result = std::to_chars (tmp, tmp + sizeof (tmp), value, std::chars_format::fixed, precision);
+			buffer.append (tmp, result.ptr - tmp);
+		}
+		//the same whitespace as printIndent
+		void appendIndent (int indent) {
+			buffer.append (indent > 0 ? indent * 6 : 1, ' ');
+		}
+
+		void clear() {
+			buffer.clear();
+		}
+		size_t size() {
+			return buffer.size();
+		}
+		void write (FILE* file) {
+			fwrite (buffer.data(), 1, buffer.size(), file);
+		}
+	};
+
+}
+
+#endif // HSTRINGBUILDER_H
@@ -1,10 +1,152 @@
 #include "HoloIO.h"
 
+#include <string>
+#include <chrono>
+
 namespace holodec {
 
 	FILE * g_log_output = stdout;
-	
+
 	Logger g_logger = Logger ("Main");
+	Logger g_analyzer_logger = Logger ("Analyzer");
+	Logger g_pass_logger = Logger ("Pass");
 
 	Console g_console;
+
+	//gives the ring back to the sink when its thread exits
+	struct LogRingHolder {
+		LogRing* ring = nullptr;
+		~LogRingHolder() {
+			if (ring)
+				LogSink::get().release_ring (ring);
+		}
+	};
+	static thread_local LogRingHolder t_logRing;
+
+	LogSink::LogSink() : running (true) {
+		thread = std::thread (&LogSink::run, this);
+	}
+	LogSink::~LogSink() {
+		running.store (false);
+		{
+			std::lock_guard<std::mutex> lock (sleepMutex);
+		}
+		cond.notify_all();
+		if (thread.joinable())
+			thread.join();
+		drain();
+		fflush (g_log_output);
+		for (LogRing* ring : rings)
+			delete ring;
+	}
+	LogSink& LogSink::get() {
+		static LogSink sink;
+		return sink;
+	}
+
+	LogRing* LogSink::acquire_ring() {
+		std::lock_guard<std::mutex> lock (mutex);
+		for (LogRing* ring : rings) {
+			if (!ring->owned.load() && ring->empty()) {
+				ring->owned.store (true);
+				return ring;
+			}
+		}
+		LogRing* ring = new LogRing();
+		rings.push_back (ring);
+		return ring;
+	}
+	void LogSink::release_ring (LogRing* ring) {
+		//the messages that are still in the ring are written before it is reused
+		ring->owned.store (false);
+		notify();
+	}
+	void LogSink::notify() {
+		cond.notify_one();
+	}
+
+	bool LogSink::drain() {
+		std::lock_guard<std::mutex> lock (mutex);
+		bool written = false;
+		for (LogRing* ring : rings) {
+			uint64_t tail = ring->tail.load (std::memory_order_relaxed);
+			uint64_t head = ring->head.load (std::memory_order_acquire);
+			for (; tail < head; tail++) {
+				LogMessage& message = ring->messages[tail % LogRing::capacity];
+				fprintf (g_log_output, "%s - %.*s\n", message.logger->module_name.cstr(), (int) message.length, message.text);
+				written = true;
+			}
+			ring->tail.store (tail, std::memory_order_release);
+		}
+		return written;
+	}
+	void LogSink::run() {
+		while (running.load()) {
+			if (drain())
+				continue;
+			//the producers only wake the sink when a ring fills up, otherwise it polls
+			std::unique_lock<std::mutex> lock (sleepMutex);
+			cond.wait_for (lock, std::chrono::milliseconds (5));
+		}
+	}
+	void LogSink::flush() {
+		drain();
+		fflush (g_log_output);
+	}
+
+	void flushLogs() {
+		LogSink::get().flush();
+	}
+
+	void Logger::log_async (LogLevel LL, const char* fstring, ...) {
+		(void) LL;
+		if (!t_logRing.ring)
+			t_logRing.ring = LogSink::get().acquire_ring();
+		LogRing* ring = t_logRing.ring;
+
+		uint64_t head = ring->head.load (std::memory_order_relaxed);
+		while (head - ring->tail.load (std::memory_order_acquire) >= LogRing::capacity) {
+			LogSink::get().notify();
+			std::this_thread::yield();
+		}
+		LogMessage& message = ring->messages[head % LogRing::capacity];
+		message.logger = this;
+		va_list args;
+		va_start (args, fstring);
+		int length = vsnprintf (message.text, sizeof (message.text), fstring, args);
+		va_end (args);
+		if (length < 0)
+			length = 0;
+		else if (length >= (int) sizeof (message.text))
+			length = sizeof (message.text) - 1;
+		message.length = (uint32_t) length;
+		ring->head.store (head + 1, std::memory_order_release);
+		if (head + 1 - ring->tail.load (std::memory_order_relaxed) >= LogRing::capacity / 2)
+			LogSink::get().notify();
+	}
+
+	void Logger::write (bool prefix, const char* fstring, va_list args) {
+		//one write per message so messages of different threads do not interleave
+		char buffer[512];
+		va_list copy;
+		va_copy (copy, args);
+		int length = vsnprintf (buffer, sizeof (buffer), fstring, copy);
+		va_end (copy);
+		if (length < 0)
+			return;
+		if (length < (int) sizeof (buffer)) {
+			if (prefix)
+				fprintf (g_log_output, "%s - %s\n", module_name.cstr(), buffer);
+			else
+				fprintf (g_log_output, "%s\n", buffer);
+			return;
+		}
+		std::string text (length + 1, '\0');
+		vsnprintf (&text[0], text.size(), fstring, args);
+		text.resize (length);
+		if (prefix)
+			fprintf (g_log_output, "%s - %s\n", module_name.cstr(), text.c_str());
+		else
+			fprintf (g_log_output, "%s\n", text.c_str());
+	}
 }
@@ -5,6 +5,24 @@
 #include "HString.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+//levels below this are removed at compile time by the HLOG macros, 0 keeps all of them
+#ifndef HOLODEC_LOG_MIN_LEVEL
+#define HOLODEC_LOG_MIN_LEVEL 0
+#endif
+
+//the arguments are only evaluated if the level is compiled in and enabled for the logger
+#define HLOG(logger, LL, ...) do { if ((int) (LL) >= HOLODEC_LOG_MIN_LEVEL && (logger).enabled (LL)) (logger).log_async (LL, __VA_ARGS__); } while (0)
+#define HLOG_TRACE(logger, ...) HLOG (logger, holodec::LogLevel::eTrace, __VA_ARGS__)
+#define HLOG_DEBUG(logger, ...) HLOG (logger, holodec::LogLevel::eDebug, __VA_ARGS__)
+#define HLOG_INFO(logger, ...) HLOG (logger, holodec::LogLevel::eInfo, __VA_ARGS__)
+#define HLOG_WARN(logger, ...) HLOG (logger, holodec::LogLevel::eWarn, __VA_ARGS__)
+#define HLOG_ERROR(logger, ...) HLOG (logger, holodec::LogLevel::eError, __VA_ARGS__)
 
 namespace holodec {
 
@@ -17,6 +35,52 @@ namespace holodec {
 	};
 	extern FILE * g_log_output;
 
+	struct Logger;
+
+	struct LogMessage {
+		const Logger* logger;
+		uint32_t length;
+		char text[248];//longer messages are cut off
+	};
+	//messages of one thread, written only by that thread and read only by the sink
+	struct LogRing {
+		static constexpr uint64_t capacity = 256;
+		LogMessage messages[capacity];
+		std::atomic<uint64_t> head;//next message the thread writes
+		std::atomic<uint64_t> tail;//next message the sink writes out
+		std::atomic<bool> owned;//a thread writes to the ring, otherwise it is reused once it is empty
+
+		LogRing() : head (0), tail (0), owned (true) {}
+		bool empty() {
+			return tail.load (std::memory_order_acquire) == head.load (std::memory_order_acquire);
+		}
+	};
+
+	//writes the messages of all threads to g_log_output on a background thread
+	//the messages of one thread stay in order, there is no order between threads
+	class LogSink {
+		std::mutex mutex;//guards rings
+		std::vector<LogRing*> rings;
+		std::mutex sleepMutex;
+		std::condition_variable cond;
+		std::atomic<bool> running;
+		std::thread thread;
+
+		LogSink();
+		void run();
+		bool drain();
+
+	public:
+		~LogSink();
+		static LogSink& get();
+
+		LogRing* acquire_ring();
+		void release_ring (LogRing* ring);
+		void notify();
+		//returns after every message logged before the call is written
+		void flush();
+	};
+
 	struct Logger {
 		HString module_name;
 		LogLevel level = LogLevel::eInfo;
@@ -26,15 +90,18 @@ namespace holodec {
 		}
 		~Logger() = default;
 
+		bool enabled (LogLevel LL) const {
+			return LL >= level;
+		}
+
+		//formats and writes the message right away, for messages that have to stay in order with other output
 		template<LogLevel LL>
 		void log (const char* fstring, ...) {
 			if (LL >= level) {
-				printf ("%s - ", module_name.cstr());
 				va_list args;
 				va_start (args, fstring);
-				vfprintf (g_log_output, fstring, args);
+				write (true, fstring, args);
 				va_end (args);
-				puts ("");
 			}
 		}
 		template<LogLevel LL>
@@ -42,14 +109,23 @@ namespace holodec {
 			if (LL >= level) {
 				va_list args;
 				va_start (args, fstring);
-				vfprintf (g_log_output, fstring, args);
+				write (false, fstring, args);
 				va_end (args);
-				puts ("");
 			}
 		}
+		//formats the message into the ring of the calling thread, used by the HLOG macros
+		void log_async (LogLevel LL, const char* fstring, ...);
+
+	private:
+		void write (bool prefix, const char* fstring, va_list args);
 	};
 
+	//waits until the messages logged so far are written
+	void flushLogs();
+
 	extern Logger g_logger;
+	extern Logger g_analyzer_logger;
+	extern Logger g_pass_logger;
 
 	struct Console {
 		Console() = default;
@@ -1,76 +1,352 @@
 #include "JobController.h"
+#include "General.h"
+#include "Profiler.h"
+
+#include <stdlib.h>
+#include <algorithm>
 
 namespace holodec{
 
+	thread_local JobController::Worker* JobController::currentWorker = nullptr;
+
+	JobDeque::JobDeque() : top (0), bottom (0), ring (new JobRing (64)) {}
+	JobDeque::~JobDeque() {
+		delete ring.load();
+		for (JobRing* old : oldRings)
+			delete old;
+	}
+	void JobDeque::push (Job* job) {
+		int64_t b = bottom.load (std::memory_order_relaxed);
+		int64_t t = top.load (std::memory_order_acquire);
+		JobRing* r = ring.load (std::memory_order_relaxed);
+		if (b - t > r->capacity - 1) {
+			//thieves may still read from the old ring so it is kept until the deque is destroyed
+			JobRing* grown = new JobRing (r->capacity * 2);
+			for (int64_t i = t; i < b; i++)
+				grown->put (i, r->get (i));
+			oldRings.push_back (r);
+			ring.store (grown, std::memory_order_release);
+			r = grown;
+		}
+		r->put (b, job);
+		std::atomic_thread_fence (std::memory_order_release);
+		bottom.store (b + 1, std::memory_order_relaxed);
+	}
+	Job* JobDeque::pop() {
+		int64_t b = bottom.load (std::memory_order_relaxed) - 1;
+		JobRing* r = ring.load (std::memory_order_relaxed);
+		bottom.store (b, std::memory_order_relaxed);
+		std::atomic_thread_fence (std::memory_order_seq_cst);
+		int64_t t = top.load (std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store (b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = r->get (b);
+		if (t == b) {
+			//last job, race against the thieves for it
+			if (!top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			bottom.store (b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+	Job* JobDeque::steal() {
+		int64_t t = top.load (std::memory_order_acquire);
+		std::atomic_thread_fence (std::memory_order_seq_cst);
+		int64_t b = bottom.load (std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		JobRing* r = ring.load (std::memory_order_acquire);
+		Job* job = r->get (t);
+		if (!top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+	bool JobDeque::empty() {
+		return top.load (std::memory_order_relaxed) >= bottom.load (std::memory_order_relaxed);
+	}
+
+	uint32_t JobController::defaultThreadCount() {
+		const char* env = getenv ("HOLODEC_THREADS");
+		if (env && atoi (env) > 0)
+			return (uint32_t) atoi (env);
+		return std::max (1u, std::thread::hardware_concurrency());
+	}
+
+	JobController::JobController (uint32_t threadCount) : counter (0), injectedSize (0), queued (0), sleeping (0), jobs_to_do (0), running (true), heapClosures (0) {
+		if (!threadCount)
+			threadCount = defaultThreadCount();
+		for (uint32_t i = 0; i < threadCount; i++) {
+			Worker* worker = new Worker();
+			worker->controller = this;
+			worker->id = i;
+			worker->random = 0x9E3779B97F4A7C15ull * (i + 1);
+			workers.push_back (worker);
+		}
+		//the workers steal from each other so all of them have to exist before the first one starts
+		for (Worker* worker : workers)
+			worker->thread = std::thread (&JobController::job_loop, this, worker);
+	}
+	JobController::~JobController() {
+		if (running.load())
+			wait_for_exit();
+		for (Worker* worker : workers) {
+			while (Job* job = worker->deque.pop())
+				delete job;
+			for (Job* job : worker->freeJobs)
+				delete job;
+			delete worker;
+		}
+		for (Job* job : injected)
+			delete job;
+	}
+
+	JobController::Worker* JobController::current_worker() {
+		return currentWorker && currentWorker->controller == this ? currentWorker : nullptr;
+	}
+
 	uint64_t JobController::queue_job (Job&& job) {
-		std::unique_lock<std::mutex> mlock (mutex);
-		job.id = ++counter;
-		jobs.push (std::move (job));
+		Worker* worker = current_worker();
+
+		Job* newJob;
+		if (worker && !worker->freeJobs.empty()) {
+			newJob = worker->freeJobs.back();
+			worker->freeJobs.pop_back();
+		} else {
+			newJob = new Job();
+		}
+		uint64_t id = ++counter;
+		newJob->id = id;
+		newJob->func = std::move (job.func);
+		newJob->group = job.group;
+		if (newJob->func.onHeap())
+			++heapClosures;
+		if (newJob->group)
+			++newJob->group->pending;
 		++jobs_to_do;
-		mlock.unlock();
-		cond.notify_one();
-		return job.id;
-	}
-	Job JobController::get_next_job() {
-		std::unique_lock<std::mutex> mlock (mutex);
-		cond.wait (mlock, [this](){return !jobs.empty() || (!jobs.empty() && end_on_empty.load()) || !running.load();});
-		
-		if(!running.load() || (jobs.empty() && end_on_empty.load()))
-			return Job();
-			
-		auto job = jobs.front();
-		jobs.pop();
+
+		if (worker) {
+			worker->deque.push (newJob);
+		} else {
+			std::lock_guard<std::mutex> lock (injectMutex);
+			injected.push_back (newJob);
+			++injectedSize;
+		}
+		//the job is visible before it is counted so a worker that wakes up finds it
+		++queued;
+		if (sleeping.load()) {
+			//a worker can not be between its check of queued and the wait while the mutex is held
+			{
+				std::lock_guard<std::mutex> lock (sleepMutex);
+			}
+			sleepCond.notify_one();
+		}
+		return id;
+	}
+
+	Job* JobController::find_job (Worker* worker) {
+		Job* job = worker->deque.pop();
+		if (!job && injectedSize.load()) {
+			std::lock_guard<std::mutex> lock (injectMutex);
+			if (!injected.empty()) {
+				job = injected.front();
+				injected.pop_front();
+				--injectedSize;
+			}
+		}
+		if (!job && workers.size() > 1) {
+			//start at a random victim so the thieves do not all contend for the same deque
+			worker->random ^= worker->random << 13;
+			worker->random ^= worker->random >> 7;
+			worker->random ^= worker->random << 17;
+			size_t start = worker->random % workers.size();
+			for (size_t i = 0; i < workers.size() && !job; i++) {
+				Worker* victim = workers[(start + i) % workers.size()];
+				if (victim == worker)
+					continue;
+				job = victim->deque.steal();
+				if (job)
+					worker->stats.stolen++;
+			}
+		}
+		if (job)
+			--queued;
 		return job;
 	}
 
-	void JobController::get_next_job (Job& job) {
-		std::unique_lock<std::mutex> mlock (mutex);
-		cond.wait (mlock, [this](){return !jobs.empty() || (jobs.empty() && end_on_empty.load()) || !running.load();});
-		
-		if(!running.load() || (jobs.empty() && end_on_empty.load())){
-			job = Job();
+	void JobController::run_job (Worker* worker, Job* job) {
+		{
+			HPROFILE_SCOPE ("Job", "id", job->id);
+			job->func ({worker->id});
+		}
+		job->func.reset();
+		JobGroup* group = job->group;
+		worker->freeJobs.push_back (job);
+		worker->stats.executed++;
+		if (group)
+			finish_group (group);
+		if (--jobs_to_do == 0) {
+			//lock so the notification can not get lost between the check and the wait in wait_for_finish
+			std::lock_guard<std::mutex> lock (end_mutex);
+			end_cond.notify_all();
+		}
+	}
+
+	void JobController::finish_group (JobGroup* group) {
+		std::lock_guard<std::mutex> lock (group->mutex);
+		if (--group->pending == 0)
+			group->cond.notify_all();
+	}
+
+	JobHandle JobController::create_task (JobFunction&& func, JobGroup* group) {
+		JobHandle task = std::make_shared<JobTask>();
+		task->func = std::move (func);
+		task->group = group;
+		//the group waits for the task from now on, not only once it is queued
+		if (group)
+			++group->pending;
+		return task;
+	}
+	void JobController::add_dependency (const JobHandle& task, const JobHandle& dependency) {
+		if (!dependency)
 			return;
+		std::lock_guard<std::mutex> lock (dependency->mutex);
+		if (dependency->done.load())
+			return;
+		dependency->dependents.push_back (task);
+		++task->unfinished;
+	}
+	void JobController::submit (const JobHandle& task) {
+		if (--task->unfinished == 0)
+			schedule_task (task);
+	}
+	JobHandle JobController::queue_task (JobFunction&& func, const std::vector<JobHandle>& dependencies, JobGroup* group) {
+		JobHandle task = create_task (std::move (func), group);
+		for (const JobHandle& dependency : dependencies)
+			add_dependency (task, dependency);
+		submit (task);
+		return task;
+	}
+	void JobController::schedule_task (const JobHandle& task) {
+		queue_job ({0, [this, task] (JobContext context) {
+			task->func (context);
+			task->func.reset();
+			finish_task (task.get());
+		}, task->group});
+	}
+	void JobController::finish_task (JobTask* task) {
+		std::vector<JobHandle> dependents;
+		{
+			std::lock_guard<std::mutex> lock (task->mutex);
+			task->done.store (true);
+			dependents.swap (task->dependents);
+			task->cond.notify_all();
 		}
-		job = jobs.front();
-		jobs.pop();
-	}
-	void JobController::start_job_loop(JobContext context){
-		Job nextJob;
-		++executors_running;
-		
-		while(running.load()){
-			
-			nextJob = get_next_job();
-			
-			if(nextJob.func){
-				nextJob.func(context);
-				int todo = --jobs_to_do;
-				if(!todo)
-					end_cond.notify_all();
-				printf("Jobs ToDo %d\n", todo);
-				printf("Jobs in Queue %zu\n", jobs.size());
+		for (JobHandle& dependent : dependents) {
+			if (--dependent->unfinished == 0)
+				schedule_task (dependent);
+		}
+		if (task->group)
+			finish_group (task->group);
+	}
+
+	bool JobController::help_one() {
+		Worker* worker = current_worker();
+		if (!worker)
+			return false;
+		Job* job = find_job (worker);
+		if (!job)
+			return false;
+		run_job (worker, job);
+		return true;
+	}
+	void JobController::wait (JobGroup* group) {
+		if (current_worker()) {
+			//blocking a job thread could leave the jobs of the group without a thread to run them
+			while (group->pending.load()) {
+				if (!help_one())
+					std::this_thread::yield();
 			}
+			//the last job may still be notifying
+			std::lock_guard<std::mutex> lock (group->mutex);
+			return;
 		}
-		if(!--executors_running)
-			end_cond.notify_all();
+		std::unique_lock<std::mutex> lock (group->mutex);
+		group->cond.wait (lock, [group]() {
+			return group->pending.load() == 0;
+		});
 	}
+	void JobController::wait (const JobHandle& task) {
+		if (current_worker()) {
+			while (!task->done.load()) {
+				if (!help_one())
+					std::this_thread::yield();
+			}
+			return;
+		}
+		std::unique_lock<std::mutex> lock (task->mutex);
+		task->cond.wait (lock, [&task]() {
+			return task->done.load();
+		});
+	}
+
+	void JobController::job_loop (Worker* worker) {
+		currentWorker = worker;
+		while (running.load()) {
+			Job* job = find_job (worker);
+			if (job) {
+				run_job (worker, job);
+				continue;
+			}
+			//a job that was just queued may not be visible yet, try a few more times before sleeping
+			for (int i = 0; i < 64 && !job && running.load(); i++) {
+				std::this_thread::yield();
+				job = find_job (worker);
+			}
+			if (job) {
+				run_job (worker, job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock (sleepMutex);
+			++sleeping;
+			worker->stats.sleeps++;
+			sleepCond.wait (lock, [this]() {
+				return queued.load() > 0 || !running.load();
+			});
+			--sleeping;
+		}
+		currentWorker = nullptr;
+	}
+
 	void JobController::stop_jobs(){
-		running.store(false);
-		cond.notify_all();
+		running.store (false);
+		{
+			std::lock_guard<std::mutex> lock (sleepMutex);
+		}
+		sleepCond.notify_all();
 	}
 
 	void JobController::wait_for_finish(){
-		end_on_empty.store(true);
 		std::unique_lock<std::mutex> mlock (end_mutex);
-		end_cond.wait (mlock, [this](){return jobs_to_do == 0;});
-		printf("All Finished\n");
-		fflush(stdout);
+		end_cond.wait (mlock, [this](){return jobs_to_do.load() == 0;});
 	}
 	void JobController::wait_for_exit(){
-		running.store(false);
-		cond.notify_all();
-		std::unique_lock<std::mutex> mlock (end_mutex);
-		end_cond.wait (mlock, [this](){return executors_running == 0;});
-		printf("All Finished\n");
+		wait_for_finish();
+		stop_jobs();
+		for (Worker* worker : workers) {
+			if (worker->thread.joinable())
+				worker->thread.join();
+		}
+	}
+
+	void JobController::printStats() {
+		printf ("Job Statistics\n");
+		for (Worker* worker : workers) {
+			printIndent (1);
+			printf ("Worker %-4" PRIu32 " Executed: %6" PRIu64 " Stolen: %6" PRIu64 " Sleeps: %6" PRIu64 "\n", worker->id, worker->stats.executed, worker->stats.stolen, worker->stats.sleeps);
+		}
+		printIndent (1);
+		printf ("Jobs: %" PRIu64 " Heap Closures: %" PRIu64 "\n", counter.load(), heapClosures.load());
 	}
-}
\ No newline at end of file
+}
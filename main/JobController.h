@@ -2,55 +2,321 @@
 #define JOBCONTROLLER_H
 
 #include <atomic>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
+#include <utility>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
 
 namespace holodec {
 
+	class JobController;
+
 	struct JobContext {
 		uint32_t threadId;
 	};
+
+	//callable for jobs that stores small closures inline instead of on the heap like std::function
+	class JobFunction {
+	public:
+		static constexpr size_t inlineSize = 64;
+
+	private:
+		struct Ops {
+			void (*invoke) (void* storage, JobContext context);
+			void (*move) (void* dst, void* src);//moves the closure and destroys the source
+			void (*destroy) (void* storage);
+			bool heap;
+		};
+		alignas (std::max_align_t) unsigned char storage[inlineSize];
+		const Ops* ops = nullptr;
+
+		template<typename F>
+		struct InlineOps {
+			static void invoke (void* storage, JobContext context) {
+				(*reinterpret_cast<F*> (storage)) (context);
+			}
+			static void move (void* dst, void* src) {
+				new (dst) F (std::move (*reinterpret_cast<F*> (src)));
+				reinterpret_cast<F*> (src)->~F();
+			}
+			static void destroy (void* storage) {
+				reinterpret_cast<F*> (storage)->~F();
+			}
+			static constexpr Ops ops = {invoke, move, destroy, false};
+		};
+		template<typename F>
+		struct HeapOps {
+			static void invoke (void* storage, JobContext context) {
+				(**reinterpret_cast<F**> (storage)) (context);
+			}
+			static void move (void* dst, void* src) {
+				*reinterpret_cast<F**> (dst) = *reinterpret_cast<F**> (src);
+			}
+			static void destroy (void* storage) {
+				delete *reinterpret_cast<F**> (storage);
+			}
+			static constexpr Ops ops = {invoke, move, destroy, true};
+		};
+
+	public:
+		JobFunction() = default;
+		template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, JobFunction>::value>::type>
+		JobFunction (F&& func) {
+			typedef typename std::decay<F>::type Closure;
+			if constexpr (sizeof (Closure) <= inlineSize && alignof (Closure) <= alignof (std::max_align_t) && std::is_nothrow_move_constructible<Closure>::value) {
+				new (storage) Closure (std::forward<F> (func));
+				ops = &InlineOps<Closure>::ops;
+			} else {
+				*reinterpret_cast<Closure**> (storage) = new Closure (std::forward<F> (func));
+				ops = &HeapOps<Closure>::ops;
+			}
+		}
+		JobFunction (JobFunction&& other) : ops (other.ops) {
+			if (ops)
+				ops->move (storage, other.storage);
+			other.ops = nullptr;
+		}
+		JobFunction& operator= (JobFunction&& other) {
+			if (this != &other) {
+				reset();
+				ops = other.ops;
+				if (ops)
+					ops->move (storage, other.storage);
+				other.ops = nullptr;
+			}
+			return *this;
+		}
+		JobFunction (const JobFunction&) = delete;
+		JobFunction& operator= (const JobFunction&) = delete;
+		~JobFunction() {
+			reset();
+		}
+
+		void reset() {
+			if (ops)
+				ops->destroy (storage);
+			ops = nullptr;
+		}
+		explicit operator bool() const {
+			return ops != nullptr;
+		}
+		void operator() (JobContext context) {
+			ops->invoke (storage, context);
+		}
+		//the closure did not fit into the inline storage
+		bool onHeap() const {
+			return ops && ops->heap;
+		}
+	};
+
+	//counts the jobs and tasks that belong together so they can be waited for without waiting for everything else
+	struct JobGroup {
+		std::atomic<int64_t> pending;//jobs and tasks of the group that are not finished
+		std::mutex mutex;//the count only drops to 0 with the mutex held, so a waiter can not destroy the group while it is notified
+		std::condition_variable cond;
+
+		JobGroup() : pending (0) {}
+	};
+
 	struct Job {
 		uint64_t id;
-		std::function<void (JobContext) > func;
+		JobFunction func;
+		JobGroup* group = nullptr;
 	};
 
-	struct JobController {
-		uint64_t counter = 0;
-		
-		std::queue<Job> jobs;
-		
+	//a job that is queued once the tasks it depends on are finished
+	struct JobTask {
+		JobFunction func;
+		JobGroup* group = nullptr;
+		std::atomic<uint32_t> unfinished;//dependencies that are not finished, +1 until the task is submitted
+		std::atomic<bool> done;
 		std::mutex mutex;
 		std::condition_variable cond;
-		
+		std::vector<std::shared_ptr<JobTask>> dependents;//queued when this task is finished
+
+		JobTask() : unfinished (1), done (false) {}
+	};
+	typedef std::shared_ptr<JobTask> JobHandle;
+
+	//the result of a task, get waits for the task
+	template<typename T>
+	class JobFuture {
+		JobController* controller = nullptr;
+		JobHandle task;
+		std::shared_ptr<T> value;
+	public:
+		JobFuture() = default;
+		JobFuture (JobController* controller, JobHandle task, std::shared_ptr<T> value) : controller (controller), task (std::move (task)), value (std::move (value)) {}
+
+		bool valid() const {
+			return task != nullptr;
+		}
+		bool ready() const {
+			return task && task->done.load();
+		}
+		//a job thread runs other jobs while it waits
+		T& get();
+		//the task that produces the value, to be used as a dependency
+		const JobHandle& handle() const {
+			return task;
+		}
+		//queues func with the value once it is available
+		template<typename F>
+		auto then (F&& func, JobGroup* group = nullptr) -> JobFuture<decltype (func (std::declval<T&>(), JobContext()))>;
+	};
+
+	//growable ring of jobs for the deque of a worker
+	struct JobRing {
+		int64_t capacity;
+		std::atomic<Job*>* slots;
+
+		JobRing (int64_t capacity) : capacity (capacity), slots (new std::atomic<Job*>[capacity]) {}
+		~JobRing() {
+			delete[] slots;
+		}
+		Job* get (int64_t index) {
+			return slots[index & (capacity - 1)].load (std::memory_order_relaxed);
+		}
+		void put (int64_t index, Job* job) {
+			slots[index & (capacity - 1)].store (job, std::memory_order_relaxed);
+		}
+	};
+
+	//lock free work stealing deque (Chase-Lev)
+	//only the owning worker pushes and pops at the bottom, the other workers steal from the top
+	struct JobDeque {
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<JobRing*> ring;
+		std::vector<JobRing*> oldRings;//rings that were replaced while a thief may still read them
+
+		JobDeque();
+		~JobDeque();
+
+		void push (Job* job);
+		Job* pop();
+		Job* steal();
+		bool empty();
+	};
+
+	struct JobWorkerStats {
+		uint64_t executed = 0;
+		uint64_t stolen = 0;
+		uint64_t sleeps = 0;
+	};
+
+	//runs jobs on a pool of worker threads
+	//every worker has its own deque and steals from the deques of the others when its own is empty
+	//jobs queued by a job go to the deque of its worker, jobs queued from other threads through a locked injection queue
+	class JobController {
+		struct Worker {
+			JobController* controller;
+			uint32_t id;
+			JobDeque deque;
+			std::vector<Job*> freeJobs;//finished jobs that are reused by the jobs this worker queues
+			uint64_t random;
+			JobWorkerStats stats;
+			std::thread thread;
+		};
+		//the worker the current thread runs, jobs queued from it go to its own deque
+		static thread_local Worker* currentWorker;
+		std::vector<Worker*> workers;
+		std::atomic<uint64_t> counter;
+
+		std::mutex injectMutex;
+		std::deque<Job*> injected;
+		std::atomic<uint64_t> injectedSize;
+
+		//queued jobs that are not taken by a worker yet
+		std::atomic<int64_t> queued;
+		std::atomic<uint32_t> sleeping;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCond;
+
+		//queued jobs that are not finished yet
+		std::atomic<int64_t> jobs_to_do;
 		std::mutex end_mutex;
 		std::condition_variable end_cond;
-		
-		std::atomic_int executors_running = 0;
-		std::atomic_int jobs_to_do = 0;
-		
-		std::atomic_bool end_on_empty = false;
-		std::atomic_bool running = true;
+
+		std::atomic_bool running;
+		std::atomic<uint64_t> heapClosures;//jobs whose closure did not fit into a JobFunction
+
+		void job_loop (Worker* worker);
+		Job* find_job (Worker* worker);
+		void run_job (Worker* worker, Job* job);
+		void schedule_task (const JobHandle& task);
+		void finish_task (JobTask* task);
+		void finish_group (JobGroup* group);
+		Worker* current_worker();
 
 	public:
-		JobController() = default;
-		
-		uint64_t queue_job (const Job& job);
+		//0 threads uses defaultThreadCount
+		JobController (uint32_t threadCount = 0);
+		~JobController();
+
+		//HOLODEC_THREADS if set, otherwise the number of hardware threads
+		static uint32_t defaultThreadCount();
+
+		uint32_t threadCount() {
+			return (uint32_t) workers.size();
+		}
+
 		uint64_t queue_job (Job&& job);
-		
-		Job get_next_job();
-		void get_next_job (Job& job);
-		
-		void start_job_loop (JobContext context);
 
+		//a task runs once all of its dependencies are finished
+		//dependencies can only be added before the task is submitted, empty handles are ignored
+		JobHandle create_task (JobFunction&& func, JobGroup* group = nullptr);
+		void add_dependency (const JobHandle& task, const JobHandle& dependency);
+		void submit (const JobHandle& task);
+		JobHandle queue_task (JobFunction&& func, const std::vector<JobHandle>& dependencies = {}, JobGroup* group = nullptr);
+		//queues func as a task and returns its result through a future
+		template<typename F>
+		auto async (F&& func, const std::vector<JobHandle>& dependencies = {}, JobGroup* group = nullptr) -> JobFuture<decltype (func (JobContext()))> {
+			typedef decltype (func (JobContext())) Result;
+			std::shared_ptr<Result> value = std::make_shared<Result>();
+			JobHandle task = queue_task ([value, func = std::forward<F> (func)] (JobContext context) mutable {
+				*value = func (context);
+			}, dependencies, group);
+			return JobFuture<Result> (this, task, value);
+		}
+
+		//runs one queued job if the caller is a job thread of this controller
+		bool help_one();
+		//a job thread runs other jobs while it waits, other threads block
+		void wait (JobGroup* group);
+		void wait (const JobHandle& task);
+
+		//waits until every queued job and the jobs they queued are finished
+		//jobs can be queued again afterwards
 		void wait_for_finish();
+		//finishes the jobs and stops the workers
 		void wait_for_exit();
 
 		void stop_jobs();
 
+		void printStats();
 	};
 
+	template<typename T>
+	T& JobFuture<T>::get() {
+		controller->wait (task);
+		return *value;
+	}
+	template<typename T>
+	template<typename F>
+	auto JobFuture<T>::then (F&& func, JobGroup* group) -> JobFuture<decltype (func (std::declval<T&>(), JobContext()))> {
+		std::shared_ptr<T> input = value;
+		return controller->async ([input, func = std::forward<F> (func)] (JobContext context) mutable {
+			return func (*input, context);
+		}, {task}, group);
+	}
+
 }
 #endif // JOBCONTROLLER_H
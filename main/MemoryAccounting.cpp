@@ -0,0 +1,215 @@
+#include "MemoryAccounting.h"
+#include "Binary.h"
+#include "Function.h"
+
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+namespace holodec {
+
+	template<typename T>
+	static uint64_t listBytes (const HList<T>& list) {
+		return list.capacity() * sizeof (T);
+	}
+	//the nodes of the tree containers are allocated one by one, the header of a node is about 4 pointers
+	template<typename T>
+	static uint64_t setBytes (const HSet<T>& set) {
+		return set.size() * (sizeof (T) + 4 * sizeof (void*));
+	}
+	template<typename Key, typename Value>
+	static uint64_t mapBytes (const HMap<Key, Value>& map) {
+		return map.size() * (sizeof (Key) + sizeof (Value) + 4 * sizeof (void*));
+	}
+	static uint64_t bitSetBytes (const HIdBitSet& set) {
+		return listBytes (set.words);
+	}
+	static uint64_t stringBytes (const HString& string) {
+		const std::string& str = string.str();
+		const char* data = str.data();
+		//small strings live in the buffer of the object
+		if (data >= reinterpret_cast<const char*> (&str) && data < reinterpret_cast<const char*> (&str + 1))
+			return 0;
+		return str.capacity() + 1;
+	}
+
+	static void ssaMemory (SSARepresentation* ssaRep, MemoryUsage* usage) {
+		usage->ssa += listBytes (ssaRep->bbs.list);
+		for (SSABB& bb : ssaRep->bbs) {
+			usage->ssa += listBytes (bb.exprIds);
+			usage->ssa += listBytes (bb.inBlocks.list);
+			usage->ssa += listBytes (bb.outBlocks.list);
+		}
+		usage->ssa += listBytes (ssaRep->expressions.list);
+		for (SSAExpression& expr : ssaRep->expressions.list) {
+			usage->ssa += listBytes (expr.refs);
+			usage->ssa += listBytes (expr.subExpressions);
+		}
+		usage->ssa += listBytes (ssaRep->freeIds);
+		usage->ssa += listBytes (ssaRep->changedExprs) + bitSetBytes (ssaRep->changedSet);
+
+		for (SSADominatorTree* tree : {&ssaRep->domTree, &ssaRep->postDomTree}) {
+			usage->ssa += listBytes (tree->idoms) + listBytes (tree->children) + listBytes (tree->frontiers);
+			for (HList<HId>& list : tree->children)
+				usage->ssa += listBytes (list);
+			for (HList<HId>& list : tree->frontiers)
+				usage->ssa += listBytes (list);
+			usage->ssa += listBytes (tree->rpo) + listBytes (tree->preorder) + listBytes (tree->postorder);
+		}
+		usage->ssa += listBytes (ssaRep->liveness.liveIn) + listBytes (ssaRep->liveness.liveOut);
+		for (HIdBitSet& set : ssaRep->liveness.liveIn)
+			usage->ssa += bitSetBytes (set);
+		for (HIdBitSet& set : ssaRep->liveness.liveOut)
+			usage->ssa += bitSetBytes (set);
+
+		SSAConstLattice& lattice = ssaRep->constLattice;
+		usage->ssa += listBytes (lattice.values) + bitSetBytes (lattice.executableBlocks) + listBytes (lattice.executableIn);
+		for (HList<HId>& list : lattice.executableIn)
+			usage->ssa += listBytes (list);
+	}
+
+	MemoryUsage functionMemory (Function* function) {
+		MemoryUsage usage;
+		usage.objects += sizeof (Function);
+		usage.objects += bitSetBytes (function->regStates.reads) + bitSetBytes (function->regStates.writes) + bitSetBytes (function->regStates.clobbers);
+		usage.objects += bitSetBytes (function->liveInRegs);
+		usage.objects += listBytes (function->funcsCalled.list) + listBytes (function->funcsCall);
+		usage.objects += setBytes (function->addrToAnalyze);
+		usage.objects += listBytes (function->jumptables.list);
+		for (JumpTable& jumptable : function->jumptables)
+			usage.objects += listBytes (jumptable.entries);
+
+		usage.instructions += listBytes (function->basicblocks.list);
+		for (DisAsmBasicBlock& bb : function->basicblocks) {
+			usage.instructions += listBytes (bb.instructions);
+			for (Instruction& instr : bb.instructions)
+				usage.instructions += listBytes (instr.operands.moreExpressions);
+		}
+		ssaMemory (&function->ssaRep, &usage);
+		return usage;
+	}
+
+	static void sectionMemory (Section* section, MemoryUsage* usage) {
+		usage->objects += sizeof (Section) + listBytes (section->subsections);
+		usage->strings += stringBytes (section->name);
+		for (Section* subsection : section->subsections)
+			sectionMemory (subsection, usage);
+	}
+
+	MemoryUsage binaryMemory (Binary* binary) {
+		MemoryUsage usage;
+		usage.strings += stringBytes (binary->name);
+		usage.objects += listBytes (binary->entrypoints) + listBytes (binary->functions.list) + mapBytes (binary->functionsByAddr);
+		usage.objects += listBytes (binary->symbols.list) + listBytes (binary->sections.list) + mapBytes (binary->memoryAreas);
+		for (Function* function : binary->functions)
+			usage += functionMemory (function);
+		for (Symbol* symbol : binary->symbols) {
+			usage.objects += sizeof (Symbol);
+			usage.strings += stringBytes (symbol->name);
+		}
+		for (Section* section : binary->sections)
+			sectionMemory (section, &usage);
+		for (std::pair<const HId, MemoryArea*>& entry : binary->memoryAreas) {
+			MemoryArea* area = entry.second;
+			usage.objects += sizeof (MemoryArea) + listBytes (area->dataSegments);
+			usage.strings += stringBytes (area->name.name);
+			for (DataSegment* dataSegment : area->dataSegments) {
+				usage.objects += sizeof (DataSegment);
+				usage.strings += stringBytes (dataSegment->name);
+				usage.data += listBytes (dataSegment->data);
+			}
+		}
+		return usage;
+	}
+
+	void MemoryUsage::print (int indent) const {
+		printIndent (indent);
+		printf ("Instructions %12" PRIu64 "\n", instructions);
+		printIndent (indent);
+		printf ("SSA          %12" PRIu64 "\n", ssa);
+		printIndent (indent);
+		printf ("Strings      %12" PRIu64 "\n", strings);
+		printIndent (indent);
+		printf ("Objects      %12" PRIu64 "\n", objects);
+		printIndent (indent);
+		printf ("Data         %12" PRIu64 "\n", data);
+		printIndent (indent);
+		printf ("Total        %12" PRIu64 "\n", total());
+	}
+
+	uint64_t currentRSS() {
+#if defined(_WIN32) || defined(_WIN64)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof (counters)))
+			return counters.WorkingSetSize;
+		return 0;
+#else
+		FILE* file = fopen ("/proc/self/statm", "r");
+		if (!file)
+			return 0;
+		unsigned long size = 0, resident = 0;
+		int count = fscanf (file, "%lu %lu", &size, &resident);
+		fclose (file);
+		if (count != 2)
+			return 0;
+		return (uint64_t) resident * sysconf (_SC_PAGESIZE);
+#endif
+	}
+	uint64_t peakRSS() {
+#if defined(_WIN32) || defined(_WIN64)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof (counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage (RUSAGE_SELF, &usage))
+			return 0;
+#if defined(__APPLE__)
+		uint64_t peak = usage.ru_maxrss;
+#else
+		uint64_t peak = (uint64_t) usage.ru_maxrss * 1024;//in kilobytes
+#endif
+		//the maximum is only updated from time to time by the kernel
+		return std::max (peak, currentRSS());
+#endif
+	}
+
+	void MemoryTracker::record (const char* name, Binary* binary) {
+		MemoryStage stage = {name, currentRSS(), peakRSS(), MemoryUsage()};
+		if (binary)
+			stage.usage = binaryMemory (binary);
+		stages.push_back (stage);
+	}
+
+	void MemoryTracker::print (Binary* binary, bool functions) {
+		printf ("Memory Statistics\n");
+		printIndent (1);
+		printf ("%-16s %12s %12s %12s\n", "Stage", "RSS", "Peak RSS", "Binary");
+		for (MemoryStage& stage : stages) {
+			printIndent (1);
+			printf ("%-16s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n", stage.name, stage.rss, stage.peak, stage.usage.total());
+		}
+		if (!binary)
+			return;
+		printIndent (1);
+		printf ("Binary\n");
+		binaryMemory (binary).print (2);
+		if (!functions)
+			return;
+		printIndent (1);
+		printf ("%-24s %12s %12s %12s %12s\n", "Function", "Instructions", "SSA", "Objects", "Total");
+		for (Function* function : binary->functions) {
+			MemoryUsage usage = functionMemory (function);
+			Symbol* symbol = binary->getSymbol (function->symbolref);
+			printIndent (1);
+			printf ("%-24s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n", symbol ? symbol->name.cstr() : "", usage.instructions, usage.ssa, usage.objects, usage.total());
+		}
+	}
+}
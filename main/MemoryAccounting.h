@@ -0,0 +1,58 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace holodec {
+
+	struct Function;
+	struct Binary;
+
+	//heap bytes owned by the analysis structures, the capacity of the containers is counted not their size
+	struct MemoryUsage {
+		uint64_t instructions = 0;//the instruction lists of the basic blocks and their operands
+		uint64_t ssa = 0;//the blocks and expressions of the ssa representation and the analyses cached with it
+		uint64_t strings = 0;//the heap part of HStrings, short strings are stored inside of the object
+		uint64_t objects = 0;//Function, Symbol, Section and DataSegment objects and their other lists
+		uint64_t data = 0;//the contents of the data segments
+
+		uint64_t total() const {
+			return instructions + ssa + strings + objects + data;
+		}
+		MemoryUsage& operator+= (const MemoryUsage& other) {
+			instructions += other.instructions;
+			ssa += other.ssa;
+			strings += other.strings;
+			objects += other.objects;
+			data += other.data;
+			return *this;
+		}
+		void print (int indent = 0) const;
+	};
+
+	MemoryUsage functionMemory (Function* function);
+	//includes the memory of all functions of the binary
+	MemoryUsage binaryMemory (Binary* binary);
+
+	//resident set size of the process in bytes, 0 if the platform does not provide it
+	uint64_t currentRSS();
+	uint64_t peakRSS();
+
+	struct MemoryStage {
+		const char* name;
+		uint64_t rss;
+		uint64_t peak;
+		MemoryUsage usage;//empty if no binary was given
+	};
+
+	//records the resident set size after each stage of the pipeline
+	struct MemoryTracker {
+		std::vector<MemoryStage> stages;
+
+		void record (const char* name, Binary* binary = nullptr);
+		void print (Binary* binary = nullptr, bool functions = true);
+	};
+}
+
+#endif // MEMORYACCOUNTING_H
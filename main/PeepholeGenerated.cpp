@@ -0,0 +1,159 @@
+//generated by phc from the peephole rule files, do not edit
+#include "PeepholeOptimizer.h"
+#include "SSA.h"
+
+namespace holodec {
+
+	static const char* const ruleNames[] = {
+		"Zero-Op",
+		"Set Flag-offset to 0",
+		"Const LoadAddr",
+		"Replace Undefs",
+	};
+
+	static bool isArgument (SSAExpression*) {
+		return false;
+	}
+
+	static bool match (Architecture*, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context, uint64_t* hits, uint64_t* misses) {
+		HId found[2] = {0, expr->id};
+		SSAExpression* e1 = expr;
+		switch (e1->type) {
+		case SSAExprType::eOp: {
+			switch (e1->opType) {
+			case SSAOpType::eSub: {
+				if (e1->subExpressions.size() == 2) {
+					if (e1->subExpressions[0] == e1->subExpressions[1]) {
+						if (!(usedOnlyIn (ssaRep, *e1, SSAExprType::eFlag))) {
+							HLOG_DEBUG (g_peephole_logger, "Zero-Op");
+							{
+								SSAExpression& expr = ssaRep->expressions[found[1]];
+								ssaRep->replaceArg (expr, SSAArgument::createUVal (0, expr.size));
+							}
+							context->expressionsMatched.assign (found + 1, found + 2);
+							hits[0]++;
+							return true;
+						}
+					}
+				}
+				misses[0]++;
+				break;
+			}
+			case SSAOpType::eBXor: {
+				if (e1->subExpressions.size() == 2) {
+					if (e1->subExpressions[0] == e1->subExpressions[1]) {
+						if (!(usedOnlyIn (ssaRep, *e1, SSAExprType::eFlag))) {
+							HLOG_DEBUG (g_peephole_logger, "Zero-Op");
+							{
+								SSAExpression& expr = ssaRep->expressions[found[1]];
+								ssaRep->replaceArg (expr, SSAArgument::createUVal (0, expr.size));
+							}
+							context->expressionsMatched.assign (found + 1, found + 2);
+							hits[0]++;
+							return true;
+						}
+					}
+				}
+				misses[0]++;
+				break;
+			}
+			default:
+				break;
+			}
+			break;
+		}
+		case SSAExprType::eFlag: {
+			if (e1->subExpressions.size() >= 1) {
+				if (!(e1->subExpressions[0].offset == 0)) {
+					HLOG_DEBUG (g_peephole_logger, "Set Flag-offset to 0");
+					{
+						SSAExpression& expr = ssaRep->expressions[found[1]];
+						SSAArgument& arg = expr.subExpressions[0];
+						arg.size += arg.offset - 0;
+						arg.offset = 0;
+						ssaRep->markChanged (expr.id);
+					}
+					context->expressionsMatched.assign (found + 1, found + 2);
+					hits[1]++;
+					return true;
+				}
+			}
+			misses[1]++;
+			break;
+		}
+		case SSAExprType::eLoadAddr: {
+			if (e1->subExpressions.size() == 5) {
+				if (e1->subExpressions[0].isValue (0)) {
+					if (e1->subExpressions[1].isValue (0)) {
+						if (e1->subExpressions[2].isValue (0)) {
+							HLOG_DEBUG (g_peephole_logger, "Const LoadAddr");
+							{
+								SSAExpression& expr = ssaRep->expressions[found[1]];
+								SSAArgument arg = ssaRep->expressions[found[1]].subExpressions[4];
+								ssaRep->replaceAllArgs (expr, arg);
+							}
+							context->expressionsMatched.assign (found + 1, found + 2);
+							hits[2]++;
+							return true;
+						}
+						if (e1->subExpressions[3].isValue (0)) {
+							HLOG_DEBUG (g_peephole_logger, "Const LoadAddr");
+							{
+								SSAExpression& expr = ssaRep->expressions[found[1]];
+								SSAArgument arg = ssaRep->expressions[found[1]].subExpressions[4];
+								ssaRep->replaceAllArgs (expr, arg);
+							}
+							context->expressionsMatched.assign (found + 1, found + 2);
+							hits[2]++;
+							return true;
+						}
+					}
+					if (!(e1->subExpressions[1].isValue (0))) {
+						if (e1->subExpressions[4].isValue (0)) {
+							if (e1->subExpressions[2].isValue (0)) {
+								HLOG_DEBUG (g_peephole_logger, "Const LoadAddr");
+								{
+									SSAExpression& expr = ssaRep->expressions[found[1]];
+									SSAArgument arg = ssaRep->expressions[found[1]].subExpressions[1];
+									ssaRep->replaceAllArgs (expr, arg);
+								}
+								context->expressionsMatched.assign (found + 1, found + 2);
+								hits[2]++;
+								return true;
+							}
+							if (e1->subExpressions[3].isValue (0)) {
+								HLOG_DEBUG (g_peephole_logger, "Const LoadAddr");
+								{
+									SSAExpression& expr = ssaRep->expressions[found[1]];
+									SSAArgument arg = ssaRep->expressions[found[1]].subExpressions[1];
+									ssaRep->replaceAllArgs (expr, arg);
+								}
+								context->expressionsMatched.assign (found + 1, found + 2);
+								hits[2]++;
+								return true;
+							}
+						}
+					}
+				}
+			}
+			misses[2]++;
+			break;
+		}
+		case SSAExprType::eUndef: {
+			HLOG_DEBUG (g_peephole_logger, "Replace Undefs");
+			{
+				SSAExpression& expr = ssaRep->expressions[found[1]];
+				ssaRep->replaceAllArgs (expr, SSAArgument::createUndef (expr.location, expr.locref, expr.size));
+			}
+			context->expressionsMatched.assign (found + 1, found + 2);
+			hits[3]++;
+			return true;
+		}
+		default:
+			break;
+		}
+		return false;
+	}
+
+	const PhGeneratedRules g_ph_generated_rules = {ruleNames, 4, 0, match, isArgument};
+}
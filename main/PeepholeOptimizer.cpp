@@ -3,7 +3,9 @@
 
 #include <fstream>
 #include <cctype>
+#include <algorithm>
 #include "SSAPeepholeOptimizer.h"
+#include "Profiler.h"
 
 namespace holodec {
 
@@ -54,13 +56,137 @@ namespace holodec {
 			context->expressionsMatched.push_back (expr->id);
 		return matched;
 	}
+	bool PhRule::matchType (SSAExpression* expr) {
+		if (type != SSAExprType::eInvalid && type != expr->type)
+			return false;
+		if (opType != SSAOpType::eInvalid && (expr->type != SSAExprType::eOp || opType != expr->opType))
+			return false;
+		if (flagType != SSAFlagType::eUnknown && (expr->type != SSAExprType::eFlag || flagType != expr->flagType))
+			return false;
+		return true;
+	}
 	bool PhRuleInstance::match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr) {
 		MatchContext context;
+		return match(arch, ssaRep, expr, &context);
+	}
+	bool PhRuleInstance::match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context) {
+		context->expressionsMatched.clear();
 		for (PhRule& rule : rules) {
-			if (!rule.matchRule(arch, ssaRep, expr, &context))
+			if (!rule.matchRule(arch, ssaRep, expr, context)) {
+				misses++;
 				return false;
+			}
+		}
+		if (executor(arch, ssaRep, context)) {
+			hits++;
+			return true;
+		}
+		misses++;
+		return false;
+	}
+	uint32_t PhRuleInstance::depth() {
+		HList<uint32_t> depths;//depth of every matched expression in the order they are matched
+		uint32_t maxDepth = 0;
+		for (PhRule& rule : rules) {
+			uint32_t depth = rule.matchedIndex && rule.matchedIndex <= depths.size() ? depths[rule.matchedIndex - 1] : 0;
+			if (rule.argIndex)
+				depth++;
+			if (rule.matchedIndex || rule.argIndex || rule.type != SSAExprType::eInvalid || rule.opType != SSAOpType::eInvalid || rule.flagType != SSAFlagType::eUnknown)
+				depths.push_back (depth);
+			maxDepth = std::max (maxDepth, depth);
+		}
+		return maxDepth;
+	}
+
+	bool PhRuleSet::match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr) {
+		for (uint32_t i : getCandidates(expr)) {
+			if (ruleInstances[i].match(arch, ssaRep, expr, &context)) {
+				HPROFILE_COUNT (ePeepholeHits, 1);
+				return true;
+			}
+		}
+		if (generated && generated->match(arch, ssaRep, expr, &context, generatedHits.data(), generatedMisses.data())) {
+			HPROFILE_COUNT (ePeepholeHits, 1);
+			return true;
+		}
+		return false;
+	}
+	static uint64_t typeKey(SSAExpression* expr) {
+		uint64_t key = static_cast<uint64_t>(expr->type) << 32;
+		if (expr->type == SSAExprType::eOp)
+			key |= static_cast<uint32_t>(expr->opType);
+		else if (expr->type == SSAExprType::eFlag)
+			key |= static_cast<uint32_t>(expr->flagType);
+		return key;
+	}
+	HList<uint32_t>& PhRuleSet::getCandidates(SSAExpression* expr) {
+		uint64_t key = typeKey (expr);
+		auto it = index.find (key);
+		if (it != index.end())
+			return it->second;
+
+		HList<uint32_t>& candidates = index[key];
+		for (uint32_t i = 0; i < ruleInstances.size(); i++) {
+			PhRuleInstance& inst = ruleInstances[i];
+			//the first rule checks the root itself if it selects no other expression
+			if (!inst.rules.empty() && !inst.rules[0].matchedIndex && !inst.rules[0].argIndex && !inst.rules[0].matchType (expr))
+				continue;
+			candidates.push_back (i);
+		}
+		return candidates;
+	}
+	bool PhRuleSet::isArgument(SSAExpression* expr) {
+		uint64_t key = typeKey (expr);
+		auto it = argumentIndex.find (key);
+		if (it != argumentIndex.end())
+			return it->second;
+
+		bool argument = false;
+		for (PhRuleInstance& inst : ruleInstances) {
+			for (PhRule& rule : inst.rules) {
+				if ((rule.matchedIndex || rule.argIndex) && rule.matchType (expr))
+					argument = true;
+			}
+		}
+		if (generated && generated->isArgument (expr))
+			argument = true;
+		argumentIndex[key] = argument;
+		return argument;
+	}
+	void PhRuleSet::addGenerated(const PhGeneratedRules* rules) {
+		generated = rules;
+		generatedHits.assign (rules->count, 0);
+		generatedMisses.assign (rules->count, 0);
+		maxDepth = std::max (maxDepth, rules->maxDepth);
+		argumentIndex.clear();
+	}
+	void PhRuleSet::reorderByHits() {
+		for (auto& entry : index) {
+			std::stable_sort (entry.second.begin(), entry.second.end(), [this] (uint32_t lhs, uint32_t rhs) {
+				return ruleInstances[lhs].hits > ruleInstances[rhs].hits;
+			});
+		}
+	}
+	void PhRuleSet::mergeStats(PhRuleSet* other) {
+		for (size_t i = 0; i < ruleInstances.size() && i < other->ruleInstances.size(); i++) {
+			ruleInstances[i].hits += other->ruleInstances[i].hits;
+			ruleInstances[i].misses += other->ruleInstances[i].misses;
+		}
+		for (size_t i = 0; i < generatedHits.size() && i < other->generatedHits.size(); i++) {
+			generatedHits[i] += other->generatedHits[i];
+			generatedMisses[i] += other->generatedMisses[i];
+		}
+	}
+	void PhRuleSet::printStats() {
+		printf ("Peephole Rule Statistics\n");
+		for (PhRuleInstance& inst : ruleInstances) {
+			printIndent (1);
+			printf ("%-28s Hits: %8" PRIu64 " Misses: %8" PRIu64 "\n", inst.name, inst.hits, inst.misses);
+		}
+		for (size_t i = 0; i < generatedHits.size(); i++) {
+			printIndent (1);
+			printf ("%-28s Hits: %8" PRIu64 " Misses: %8" PRIu64 "\n", generated->names[i], generatedHits[i], generatedMisses[i]);
 		}
-		return executor(arch, ssaRep, &context);
 	}
 
 	struct RuleBuilder {
@@ -80,16 +206,20 @@ namespace holodec {
 			return *this;
 		}
 
-		RuleBuilder& execute (PhExecutor executor) {
+		RuleBuilder& execute (const char* name, PhExecutor executor) {
+			ruleInstance.name = name;
 			ruleInstance.executor = executor;
+			ruleSet->maxDepth = std::max (ruleSet->maxDepth, ruleInstance.depth());
+			ruleSet->index.clear();
+			ruleSet->argumentIndex.clear();
 			ruleSet->ruleInstances.push_back(std::move(ruleInstance));
 			ruleInstance = std::move(PhRuleInstance());
 			return *this;
 		}
 	};
-	bool usedOnlyInFlags(SSARepresentation* ssaRep, SSAExpression& expr) {
-		for (HId id : expr.directRefs) {//iterate refs
-			if (ssaRep->expressions[id].type != SSAExprType::eFlag)
+	bool usedOnlyIn(SSARepresentation* ssaRep, SSAExpression& expr, SSAExprType type) {
+		for (HId id : expr.refs) {//iterate refs
+			if (ssaRep->expressions[id].type != type)
 				return false;
 		}
 		return true;
@@ -101,10 +231,11 @@ namespace holodec {
 
 		RuleBuilder builder (peephole_optimizer->ruleSet);
 		
+		peephole_optimizer->ruleSet.addGenerated(&g_ph_generated_rules);
 		builder = peephole_optimizer->ruleSet;
 		builder
 		.ssaType(0, 0, SSAExprType::eAppend)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Simplify Append", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression&  expr = ssaRep->expressions[context->expressionsMatched[0]];
 			if (expr.type != SSAExprType::eAppend)
 				return false;
@@ -112,11 +243,11 @@ namespace holodec {
 			if (expr.subExpressions.size() == 2 && expr.subExpressions[1].type == SSAArgType::eUInt && expr.subExpressions[1].uval == 0) {
 				expr.type = SSAExprType::eExtend;
 				expr.exprtype = SSAType::eUInt;
+				ssaRep->markChanged(expr.id);
 				expr.removeArgument(ssaRep, expr.subExpressions.end() - 1);
-				g_peephole_logger.log<LogLevel::eDebug>("Replace Appends with Extend");
+				HLOG_DEBUG (g_peephole_logger, "Replace Appends with Extend");
 				return true;
 			}
-			expr.print(arch);
 			bool replaced = false;
 			if (expr.subExpressions.size() > 1) {
 				for (auto it = expr.subExpressions.begin() + 1; it != expr.subExpressions.end(); ) {
@@ -141,21 +272,20 @@ namespace holodec {
 				}
 				if (expr.subExpressions.size() == 1) {
 					expr.type = SSAExprType::eAssign;
-					expr.print(arch);
+					ssaRep->markChanged(expr.id);
 					return true;
 				}
 			}
 
-			expr.print(arch);
 			assert(expr.subExpressions.size());
 			auto baseit = expr.subExpressions.begin();
 			uint64_t offset = baseit->offset;
 			for (auto it = baseit; it != expr.subExpressions.end(); it++) {
-				if (it->type != SSAArgType::eId || (it->type == SSAArgType::eId && it->ssaId != baseit->ssaId)) {
+				if (it->type != SSAArgType::eId || baseit->type != SSAArgType::eId || it->ssaId != baseit->ssaId) {
 					if (std::distance(baseit, it) > 1 && it->offset == offset) {
 						SSAArgument arg = *baseit;
 						arg.size = offset - arg.offset;
-						it = expr.subExpressions.insert(expr.subExpressions.erase(baseit, it), arg);
+						it = expr.insertArgument(ssaRep, expr.removeArguments(ssaRep, baseit, it), arg);
 						replaced = true;
 					}
 					baseit = it;
@@ -172,30 +302,29 @@ namespace holodec {
 			if (std::distance(baseit, expr.subExpressions.end()) > 1) {
 				SSAArgument arg = *baseit;
 				arg.size = offset - arg.offset;
-				expr.subExpressions.insert(expr.subExpressions.erase(baseit, expr.subExpressions.end()), arg);
+				expr.insertArgument(ssaRep, expr.removeArguments(ssaRep, baseit, expr.subExpressions.end()), arg);
 				if (expr.subExpressions.size() == 1) {
 					expr.type = SSAExprType::eAssign;
+					ssaRep->markChanged(expr.id);
 				}
-				g_peephole_logger.log<LogLevel::eDebug>("Replace Appends of same Expr at end");
-				expr.print(arch);
+				HLOG_DEBUG (g_peephole_logger, "Replace Appends of same Expr at end");
 				return true;
 			}
 			if (replaced) {
-				g_peephole_logger.log<LogLevel::eDebug>("Replace Some Appends of same Expr");
+				HLOG_DEBUG (g_peephole_logger, "Replace Some Appends of same Expr");
 			}
-			expr.print(arch);
 			return replaced;
 		})
 		.ssaType(0, 0, SSAOpType::eAdd)
 		.ssaType(1, 3, SSAFlagType::eC)
 		.ssaType(2, 1, SSAOpType::eAdd)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Add - Carry Add", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& firstAdd = ssaRep->expressions[context->expressionsMatched[2]];
 			SSAExpression& carryExpr = ssaRep->expressions[context->expressionsMatched[1]];
 			SSAExpression& secondAdd = ssaRep->expressions[context->expressionsMatched[0]];
 			if (firstAdd.subExpressions.size() != 2 || secondAdd.subExpressions.size() != 3 || carryExpr.subExpressions[0].offset + carryExpr.subExpressions[0].size != firstAdd.size)
 				return false;
-			g_peephole_logger.log<LogLevel::eDebug>("Replace Add - Carry Add");
+			HLOG_DEBUG (g_peephole_logger, "Replace Add - Carry Add");
 
 			SSAExpression combine1;
 			combine1.type = SSAExprType::eAppend;
@@ -239,7 +368,7 @@ namespace holodec {
 			SSAArgument combine2Arg = SSAArgument::createId(ssaRep->addAfter(&combine2, combine1Arg.ssaId), combine2.size);
 
 			//set arguments of second arg
-			ssaRep->expressions[context->expressionsMatched[0]].subExpressions = { combine1Arg, combine2Arg };
+			ssaRep->expressions[context->expressionsMatched[0]].setAllArguments(ssaRep, { combine1Arg, combine2Arg });
 
 			ssaRep->replaceAllArgs(ssaRep->expressions[context->expressionsMatched[2]], splitArg1);
 			ssaRep->replaceAllArgs(ssaRep->expressions[context->expressionsMatched[0]], splitArg2);
@@ -248,13 +377,13 @@ namespace holodec {
 		.ssaType(0, 0, SSAOpType::eSub)
 		.ssaType(1, 3, SSAFlagType::eC)
 		.ssaType(2, 1, SSAOpType::eSub)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Sub - Carry Sub", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& firstSub = ssaRep->expressions[context->expressionsMatched[2]];
 			SSAExpression& carryExpr = ssaRep->expressions[context->expressionsMatched[1]];
 			SSAExpression& secondSub = ssaRep->expressions[context->expressionsMatched[0]];
 			if (firstSub.subExpressions.size() != 2 || secondSub.subExpressions.size() != 3 || carryExpr.subExpressions[0].offset + carryExpr.subExpressions[0].size != firstSub.size)
 				return false;
-			g_peephole_logger.log<LogLevel::eDebug>("Replace Sub - Carry Sub");
+			HLOG_DEBUG (g_peephole_logger, "Replace Sub - Carry Sub");
 
 			SSAExpression combine1;
 			combine1.type = SSAExprType::eAppend;
@@ -306,7 +435,7 @@ namespace holodec {
 		})
 		.ssaType(0, 0, SSAExprType::eUpdatePart)
 		.ssaType(1, 1, SSAExprType::eUpdatePart)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("UpdatePart - UpdatePart", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& firstUpdateExpr = ssaRep->expressions[context->expressionsMatched[1]];
 			SSAExpression& secondUpdateExpr = ssaRep->expressions[context->expressionsMatched[0]];
 
@@ -321,12 +450,15 @@ namespace holodec {
 				expr.exprtype = SSAType::eUInt;
 				if (expr.size == secondUpdateExpr.size) {
 					secondUpdateExpr.type = SSAExprType::eAppend;
+					ssaRep->markChanged(secondUpdateExpr.id);
+					//Expression references invalidated
+					SSAArgument firstArg = firstUpdateExpr.subExpressions[1], secondArg = secondUpdateExpr.subExpressions[1];
 					HId newId = ssaRep->addBefore(&expr, secondUpdateExpr.id);
 					if (firstToSec) {
-						ssaRep->expressions[newId].setAllArguments(ssaRep, { firstUpdateExpr.subExpressions[1], secondUpdateExpr.subExpressions[1] });
+						ssaRep->expressions[newId].setAllArguments(ssaRep, { firstArg, secondArg });
 					}
 					else {
-						ssaRep->expressions[newId].setAllArguments(ssaRep, { secondUpdateExpr.subExpressions[1], firstUpdateExpr.subExpressions[1] });
+						ssaRep->expressions[newId].setAllArguments(ssaRep, { secondArg, firstArg });
 					}
 					ssaRep->expressions[context->expressionsMatched[0]].setAllArguments(ssaRep, { SSAArgument::createId(newId, expr.size, 0) });
 					return true;
@@ -338,49 +470,33 @@ namespace holodec {
 			}
 			return false;
 		})
-		.ssaType(0, 0, SSAExprType::eOp)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
-			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
-			if ((expr.opType == SSAOpType::eSub || expr.opType == SSAOpType::eBXor) && expr.subExpressions.size() == 2 && expr.subExpressions[0] == expr.subExpressions[1] && !usedOnlyInFlags(ssaRep, expr)) {
-				g_peephole_logger.log<LogLevel::eDebug>("Zero-Op");
-				ssaRep->replaceArg(expr, SSAArgument::createUVal(0, expr.size));
-				return true;
-			}
-			return false;
-		})
 		.ssaType(0, 0, SSAExprType::eAppend)
 		.ssaType(1, 1, SSAExprType::eAppend)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Append - Append", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& expr1 = ssaRep->expressions[context->expressionsMatched[1]];
 			SSAExpression& expr2 = ssaRep->expressions[context->expressionsMatched[0]];
 			if (expr2.subExpressions[0].offset == 0 && expr2.subExpressions[0].size == expr1.size) {
-				expr1.print(arch);
-				expr2.print(arch);
-				g_peephole_logger.log<LogLevel::eDebug>("Append %d - Append %d ", context->expressionsMatched[0], context->expressionsMatched[1]);
-				HList<SSAArgument> args(expr2.subExpressions.begin() + 1, expr2.subExpressions.end());
-				expr2.subExpressions = expr1.subExpressions;
-				for (SSAArgument& arg : args) {
-					expr2.addArgument(ssaRep, arg);
-				}
-				expr1.print(arch);
-				expr2.print(arch);
+				HLOG_DEBUG (g_peephole_logger, "Append %d - Append %d ", context->expressionsMatched[0], context->expressionsMatched[1]);
+				HList<SSAArgument> args(expr1.subExpressions);
+				args.insert(args.end(), expr2.subExpressions.begin() + 1, expr2.subExpressions.end());
+				expr2.setAllArguments(ssaRep, args);
 				return true;
 			}
 			return false;
 		})
 		.ssaType(0, 0, SSAExprType::eAssign)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Replace Assigns", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
 			SSAArgument& arg = expr.subExpressions[0];
-			if (expr.directRefs.size()) {
+			if (expr.refs.size()) {
 				if (arg.isConst()) {
 					if (arg.type == SSAArgType::eUInt) {
-						g_peephole_logger.log<LogLevel::eDebug>("Replace Const Assigns");
+						HLOG_DEBUG (g_peephole_logger, "Replace Const Assigns");
 						ssaRep->replaceAllArgs(expr, SSAArgument::createUVal(arg.uval >> arg.offset, arg.size));
 						return true;
 					}
 					else if (arg.type == SSAArgType::eSInt) {
-						g_peephole_logger.log<LogLevel::eDebug>("Replace Const Assigns");
+						HLOG_DEBUG (g_peephole_logger, "Replace Const Assigns");
 						ssaRep->replaceAllArgs(expr, SSAArgument::createUVal(arg.sval >> arg.offset, arg.size));
 						return true;
 					}
@@ -390,21 +506,9 @@ namespace holodec {
 				return true;
 			}
 			return false;
-		})
-		.ssaType(0, 0, SSAExprType::eFlag)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
-			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
-			SSAArgument& arg = expr.subExpressions[0];
-			if (arg.offset) {
-				g_peephole_logger.log<LogLevel::eDebug>("Set Flag-offset to 0");
-				arg.size += arg.offset;
-				arg.offset = 0;
-				return true;
-			}
-			return false;
 		})
 			.ssaType(0, 0, SSAExprType::eReturn)
-			.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+			.execute("Remove Input Return-args", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
 			bool replaced = false;
 			for (auto it = expr.subExpressions.begin(); it != expr.subExpressions.end();) {
@@ -412,7 +516,7 @@ namespace holodec {
 				if (arg.type == SSAArgType::eId) {
 					SSAExprType type = ssaRep->expressions[arg.ssaId].type;
 					if (arg.type == SSAArgType::eId && type == SSAExprType::eInput) {
-						it = expr.subExpressions.erase(it);
+						it = expr.removeArgument(ssaRep, it);
 						replaced = true;
 						continue;
 					}
@@ -420,45 +524,14 @@ namespace holodec {
 				++it;
 			}
 			if(replaced)
-				g_peephole_logger.log<LogLevel::eDebug>("Removed non used Return-args");
+				HLOG_DEBUG (g_peephole_logger, "Removed non used Return-args");
 			return replaced;
-		})
-			.ssaType(0, 0, SSAExprType::eLoadAddr)
-			.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
-			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
-			if (expr.subExpressions.size() == 5) {
-				SSAArgument &arg0 = expr.subExpressions[0], &arg1 = expr.subExpressions[1], &arg2 = expr.subExpressions[2], &arg3 = expr.subExpressions[3], &arg4 = expr.subExpressions[4];
-				if (arg0.isValue(0)) {
-					if (arg1.isValue(0)) {
-						if (arg2.isValue(0) || arg3.isValue(0)) {
-							ssaRep->replaceAllArgs(expr, arg4);
-							g_peephole_logger.log<LogLevel::eDebug>("Const LoadAddr");
-							return true;
-						}
-					}
-					else if (arg4.isValue(0)) {
-						if (arg2.isValue(0) || arg3.isValue(0)) {
-							ssaRep->replaceAllArgs(expr, arg1);
-							g_peephole_logger.log<LogLevel::eDebug>("Const LoadAddr");
-							return true;
-						}
-					}
-				}
-			}
-			return false;
-		})
-		.ssaType(0, 0, SSAExprType::eUndef)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
-			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
-			ssaRep->replaceAllArgs(expr, SSAArgument::createUndef(expr.location, expr.locref, expr.size));
-			g_peephole_logger.log<LogLevel::eDebug>("Replace Undefs");
-			return true;
 		})
 		.ssaType(0, 0, SSAOpType::eAdd)
 		.ssaType(0, 0, SSAOpType::eAdd)
 		.ssaType(0, 0, SSAExprType::eAssign)
 		.ssaType(0, 0, SSAExprType::eAssign)
-		.execute([](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
+		.execute("Const Add Assign", [](Architecture * arch, SSARepresentation * ssaRep, MatchContext * context) {
 			SSAExpression& expr = ssaRep->expressions[context->expressionsMatched[0]];
 			SSAArgument& arg = expr.subExpressions[0];
 			if (arg.isConst()) {
@@ -27,27 +27,64 @@ namespace holodec {
 		PhRule (HId matchedIndex, HId argIndex, SSAExprType type, SSAOpType opType, SSAFlagType flagType) : matchedIndex (matchedIndex), argIndex (argIndex), type (type), opType (opType), flagType (flagType) {}
 
 		bool matchRule (Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context);
+		//checks only the type of the selected expression
+		bool matchType (SSAExpression* expr);
 	};
 	struct PhRuleInstance {
+		const char* name = "";
 		std::vector<PhRule> rules;
 		PhExecutor executor;
+		uint64_t hits = 0;//the executor changed the expression
+		uint64_t misses = 0;//tried without a change
 
 		bool match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr);
+		bool match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context);
+		//how many arguments deep below the root the rules look
+		uint32_t depth();
 	};
 	
+	//rules compiled by phc from the rule files into PeepholeGenerated.cpp
+	struct PhGeneratedRules {
+		const char* const* names;
+		uint32_t count;
+		uint32_t maxDepth;
+		bool (*match) (Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context, uint64_t* hits, uint64_t* misses);
+		bool (*isArgument) (SSAExpression* expr);
+	};
+	extern const PhGeneratedRules g_ph_generated_rules;
+
+	bool usedOnlyIn (SSARepresentation* ssaRep, SSAExpression& expr, SSAExprType type);
+
+	//the rule instances are indexed by the type of the root expression
+	//so only instances that can match the root are tried, in the order they were added
 	struct PhRuleSet {
 		std::vector<PhRuleInstance> ruleInstances;
-		bool match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr) {
-			for (PhRuleInstance& inst : ruleInstances)
-				if (inst.match(arch, ssaRep, expr))
-					return true;
-			return false;
-		}
+		HMap<uint64_t, HList<uint32_t>> index;//key of the root to the candidate instances
+		HMap<uint64_t, bool> argumentIndex;//key to whether a rule may select the expression below a root
+		uint32_t maxDepth = 0;//deepest expression below the root any rule looks at
+		MatchContext context;//context of the last match, holds the matched expressions if match returned true
+		//tried after the rule instances
+		const PhGeneratedRules* generated = nullptr;
+		HList<uint64_t> generatedHits;
+		HList<uint64_t> generatedMisses;
+
+		bool match(Architecture* arch, SSARepresentation* ssaRep, SSAExpression* expr);
+
+		HList<uint32_t>& getCandidates(SSAExpression* expr);
+		bool isArgument(SSAExpression* expr);
+		void addGenerated(const PhGeneratedRules* rules);
+		//tries the instances with the most hits first
+		//changes which rule fires if several match the same expression
+		void reorderByHits();
+
+		void mergeStats(PhRuleSet* other);
+		void printStats();
 	};
 	
 	struct PeepholeOptimizer {
 		
 		PhRuleSet ruleSet;
+		bool reorderByHits = false;
 		
 		PeepholeOptimizer(){
 			
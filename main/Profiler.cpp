@@ -0,0 +1,118 @@
+#include "Profiler.h"
+#include "General.h"
+
+#include <chrono>
+#include <algorithm>
+
+namespace holodec {
+
+	std::atomic<bool> g_profile_enabled (false);
+
+	static thread_local ProfileThread* t_profileThread = nullptr;
+
+	static const char* counterNames[] = {
+		"InstructionsDecoded",
+		"IRMatches",
+		"IRMisses",
+		"ExpressionsCreated",
+		"ExpressionsRemoved",
+		"PeepholeHits",
+		"CompressCalls",
+		"CompressedExpressions",
+		"ReplacedNodes",
+	};
+	static_assert (sizeof (counterNames) / sizeof (counterNames[0]) == (size_t) ProfileCounter::eCount, "every counter needs a name");
+
+	const char* profileCounterName (ProfileCounter counter) {
+		return counterNames[(size_t) counter];
+	}
+
+	Profiler::~Profiler() {
+		for (ProfileThread* thread : threads)
+			delete thread;
+	}
+	Profiler& Profiler::get() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	void Profiler::enable() {
+		if (!origin)
+			origin = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+		g_profile_enabled.store (true);
+	}
+	void Profiler::disable() {
+		g_profile_enabled.store (false);
+	}
+
+	uint64_t Profiler::now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count() - origin;
+	}
+
+	ProfileThread* Profiler::thread() {
+		if (!t_profileThread) {
+			std::lock_guard<std::mutex> lock (mutex);
+			t_profileThread = new ProfileThread ((uint32_t) threads.size());
+			threads.push_back (t_profileThread);
+		}
+		return t_profileThread;
+	}
+
+	void Profiler::addEvent (const char* name, uint64_t start, const char* argName, uint64_t arg) {
+		uint64_t end = now();
+		thread()->events.push_back ({name, argName, start, end - start, arg});
+	}
+
+	uint64_t Profiler::total (ProfileCounter counter) {
+		std::lock_guard<std::mutex> lock (mutex);
+		uint64_t sum = 0;
+		for (ProfileThread* thread : threads)
+			sum += thread->counters[(size_t) counter].load (std::memory_order_relaxed);
+		return sum;
+	}
+
+	//has to be called once the recording threads are finished
+	bool Profiler::writeTrace (const char* filename) {
+		FILE* file = fopen (filename, "w");
+		if (!file) {
+			printf ("Cannot open trace file %s\n", filename);
+			return false;
+		}
+		std::lock_guard<std::mutex> lock (mutex);
+		uint64_t end = 0;
+		fprintf (file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+		bool first = true;
+		for (ProfileThread* thread : threads) {
+			fprintf (file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %" PRIu32 ", \"args\": {\"name\": \"Thread %" PRIu32 "\"}}", first ? "" : ",\n", thread->id, thread->id);
+			first = false;
+			for (ProfileEvent& event : thread->events) {
+				//the names are literals of the code, so they do not need to be escaped
+				fprintf (file, ",\n{\"name\": \"%s\", \"cat\": \"holodec\", \"ph\": \"X\", \"pid\": 1, \"tid\": %" PRIu32 ", \"ts\": %.3f, \"dur\": %.3f",
+				         event.name, thread->id, event.start / 1000.0, event.duration / 1000.0);
+				if (event.argName)
+					fprintf (file, ", \"args\": {\"%s\": \"0x%" PRIx64 "\"}", event.argName, event.arg);
+				fprintf (file, "}");
+				end = std::max (end, event.start + event.duration);
+			}
+		}
+		//one counter track per counter with a series per thread
+		for (size_t i = 0; i < (size_t) ProfileCounter::eCount; i++) {
+			fprintf (file, "%s{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {", first ? "" : ",\n", counterNames[i], end / 1000.0);
+			first = false;
+			for (size_t j = 0; j < threads.size(); j++)
+				fprintf (file, "%s\"Thread %" PRIu32 "\": %" PRIu64, j ? ", " : "", threads[j]->id, threads[j]->counters[i].load (std::memory_order_relaxed));
+			fprintf (file, "}}");
+		}
+		fprintf (file, "\n]}\n");
+		fclose (file);
+		return true;
+	}
+
+	void Profiler::printStats() {
+		printf ("Profile Counters\n");
+		for (size_t i = 0; i < (size_t) ProfileCounter::eCount; i++) {
+			printIndent (1);
+			printf ("%-24s %12" PRIu64 "\n", counterNames[i], total ((ProfileCounter) i));
+		}
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+//0 removes the counters and timers at compile time
+#ifndef HOLODEC_PROFILE
+#define HOLODEC_PROFILE 1
+#endif
+
+namespace holodec {
+
+	enum class ProfileCounter {
+		eInstructionsDecoded = 0,
+		eIRMatches,
+		eIRMisses,
+		eExpressionsCreated,
+		eExpressionsRemoved,
+		ePeepholeHits,
+		eCompressCalls,
+		eCompressedExpressions,//entries of the id remapping of compress
+		eReplacedNodes,//entries of the replacement maps passed to replaceNodes
+		eCount,
+	};
+
+	struct ProfileEvent {
+		const char* name;//literals only, they are written out when the trace is exported
+		const char* argName;//nullptr if the event has no argument
+		uint64_t start;//nanoseconds since the profiler was enabled
+		uint64_t duration;
+		uint64_t arg;
+	};
+
+	//the counters and events of one thread, only written by that thread
+	struct ProfileThread {
+		uint32_t id;
+		std::atomic<uint64_t> counters[(size_t) ProfileCounter::eCount];
+		std::vector<ProfileEvent> events;
+
+		ProfileThread (uint32_t id) : id (id) {
+			for (std::atomic<uint64_t>& counter : counters)
+				counter.store (0);
+		}
+	};
+
+	//checked before anything is recorded, so a disabled profiler costs one load per counter or scope
+	extern std::atomic<bool> g_profile_enabled;
+
+	//collects per thread counters and timed scopes and exports them as Chrome trace events
+	//the trace can be opened in chrome://tracing or ui.perfetto.dev
+	class Profiler {
+		std::mutex mutex;//guards threads
+		std::vector<ProfileThread*> threads;//kept after their thread exits
+		uint64_t origin = 0;
+
+		Profiler() = default;
+	public:
+		~Profiler();
+		static Profiler& get();
+
+		static bool enabled() {
+			return g_profile_enabled.load (std::memory_order_relaxed);
+		}
+		void enable();
+		void disable();
+
+		uint64_t now();
+		//the data of the calling thread
+		ProfileThread* thread();
+
+		void count (ProfileCounter counter, uint64_t value) {
+			std::atomic<uint64_t>& total = thread()->counters[(size_t) counter];
+			total.store (total.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+		void addEvent (const char* name, uint64_t start, const char* argName, uint64_t arg);
+
+		//the sums over all threads, only exact if the threads are not recording at the same time
+		uint64_t total (ProfileCounter counter);
+		bool writeTrace (const char* filename);
+		void printStats();
+	};
+
+	//records the time from construction to destruction as one event
+	struct ProfileScope {
+		const char* name;
+		const char* argName;
+		uint64_t arg;
+		uint64_t start = 0;
+		bool active;
+
+		ProfileScope (const char* name, const char* argName = nullptr, uint64_t arg = 0) : name (name), argName (argName), arg (arg), active (Profiler::enabled()) {
+			if (active)
+				start = Profiler::get().now();
+		}
+		~ProfileScope() {
+			if (active)
+				Profiler::get().addEvent (name, start, argName, arg);
+		}
+	};
+
+	const char* profileCounterName (ProfileCounter counter);
+}
+
+#if HOLODEC_PROFILE
+#define HPROFILE_CONCAT2(a, b) a##b
+#define HPROFILE_CONCAT(a, b) HPROFILE_CONCAT2 (a, b)
+#define HPROFILE_COUNT(counter, value) do { if (holodec::Profiler::enabled()) holodec::Profiler::get().count (holodec::ProfileCounter::counter, value); } while (0)
+//name, optionally followed by the name and the value of an argument
+#define HPROFILE_SCOPE(...) holodec::ProfileScope HPROFILE_CONCAT (profileScope, __LINE__) (__VA_ARGS__)
+#else
+#define HPROFILE_COUNT(counter, value) do { } while (0)
+#define HPROFILE_SCOPE(...) do { } while (0)
+#endif
+
+#endif // PROFILER_H
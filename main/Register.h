@@ -41,6 +41,22 @@ namespace holodec {
 	};
 	extern Register invalidReg;
 
+	//a register as a bit range of its top-level parent
+	//slices of a parent are ordered by size so the lowest bit of a mask is the smallest register
+	struct RegisterSlice {
+		HId parentId = 0;
+		uint32_t parentIndex = 0;//dense index of the parent among the top-level registers
+		uint32_t sliceIndex = 0;//index among the slices of the parent
+		uint32_t offset = 0, size = 0;
+		uint64_t containsMask = 0;//slices completely inside of this register including itself
+		uint64_t containedMask = 0;//slices this register is completely inside of including itself
+		uint64_t overlapMask = 0;//slices sharing at least one bit with this register
+
+		uint64_t bit() {
+			return (uint64_t)1 << sliceIndex;
+		}
+	};
+
 }
 
 #endif // HREGISTER_H
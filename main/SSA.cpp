@@ -1,81 +1,66 @@
 
 #include "SSA.h"
 #include "Architecture.h"
+#include "Profiler.h"
+#include "HoloIO.h"
 
 #include <cassert>
+#include <algorithm>
 
 namespace holodec {
 
 	void SSAExpression::addArgument(SSARepresentation* rep, SSAArgument arg) {
-		if (arg.type == SSAArgType::eId) {//add ref
-			SSAExpression& expr = rep->expressions[arg.ssaId];
-			expr.directRefs.push_back(id);
-		}
+		if (arg.type == SSAArgType::eId)//add ref
+			rep->addRef(arg, id);
+		rep->markChanged(id);
 		subExpressions.push_back(arg);
 	}
 	void SSAExpression::setArgument(SSARepresentation* rep, int index, SSAArgument arg) {
-		if (subExpressions[index].type == SSAArgType::eId) {//remove ref
-			SSAExpression& expr = rep->expressions[subExpressions[index].ssaId];
-			for (auto it = expr.directRefs.begin(); it != expr.directRefs.end(); ++it) {
-				if (*it == id) {
-					expr.directRefs.erase(it);//erase only one
-					break;
-				}
-			}
-		}
-		if (arg.type == SSAArgType::eId) {//add ref
-			SSAExpression& expr = rep->expressions[arg.ssaId];
-			expr.directRefs.push_back(id);
-		}
+		if (subExpressions[index].type == SSAArgType::eId)//remove ref
+			rep->removeRef(subExpressions[index], id);
+		if (arg.type == SSAArgType::eId)//add ref
+			rep->addRef(arg, id);
+		rep->markChanged(id);
 		subExpressions[index].set(arg);
 	}
+	HList<SSAArgument>::iterator SSAExpression::insertArgument(SSARepresentation* rep, HList<SSAArgument>::iterator it, SSAArgument arg) {
+		if (arg.type == SSAArgType::eId)//add ref
+			rep->addRef(arg, id);
+		rep->markChanged(id);
+		return subExpressions.insert(it, arg);
+	}
 	HList<SSAArgument>::iterator SSAExpression::removeArgument(SSARepresentation* rep, HList<SSAArgument>::iterator it) {
-		if (it->type == SSAArgType::eId) {//remove ref
-			SSAExpression& expr = rep->expressions[it->ssaId];
-			for (auto it = expr.directRefs.begin(); it != expr.directRefs.end(); ++it) {
-				if (*it == id) {
-					expr.directRefs.erase(it);//erase only one
-					break;
-				}
-			}
-		}
+		if (it->type == SSAArgType::eId)//remove ref
+			rep->removeRef(*it, id);
+		rep->markChanged(id);
 		return subExpressions.erase(it);
 	}
-	void SSAExpression::replaceArgument(SSARepresentation* rep, int index, SSAArgument arg) {
-		if (subExpressions[index].type == SSAArgType::eId) {//remove ref
-			SSAExpression& expr = rep->expressions[subExpressions[index].ssaId];
-			for (auto it = expr.directRefs.begin(); it != expr.directRefs.end(); ++it) {
-				if (*it == id) {
-					expr.directRefs.erase(it);//erase only one
-					break;
-				}
-			}
-		}
-		if (arg.type == SSAArgType::eId) {//add ref
-			SSAExpression& expr = rep->expressions[arg.ssaId];
-			expr.directRefs.push_back(id);
+	HList<SSAArgument>::iterator SSAExpression::removeArguments(SSARepresentation* rep, HList<SSAArgument>::iterator first, HList<SSAArgument>::iterator last) {
+		for (auto it = first; it != last; ++it) {
+			if (it->type == SSAArgType::eId)//remove ref
+				rep->removeRef(*it, id);
 		}
+		rep->markChanged(id);
+		return subExpressions.erase(first, last);
+	}
+	void SSAExpression::replaceArgument(SSARepresentation* rep, int index, SSAArgument arg) {
+		if (subExpressions[index].type == SSAArgType::eId)//remove ref
+			rep->removeRef(subExpressions[index], id);
+		if (arg.type == SSAArgType::eId)//add ref
+			rep->addRef(arg, id);
+		rep->markChanged(id);
 		subExpressions[index].replace(arg);
 	}
 	void SSAExpression::setAllArguments(SSARepresentation* rep, HList<SSAArgument> args) {
 		for (SSAArgument& arg : subExpressions) {//remove refs
-			if (arg.type == SSAArgType::eId) {
-				SSAExpression& expr = rep->expressions[arg.ssaId];
-				for (auto it = expr.directRefs.begin(); it != expr.directRefs.end();) {
-					if (*it == id) {
-						it = expr.directRefs.erase(it);//erase all
-						continue;
-					}
-					++it;
-				}
-			}
+			if (arg.type == SSAArgType::eId)
+				rep->removeRef(arg, id);
 		}
 		for (SSAArgument& arg : args) {//add refs
-			if (arg.type == SSAArgType::eId) {
-				SSAExpression& expr = rep->expressions[arg.ssaId];
-				expr.directRefs.push_back(id);
-			}
+			if (arg.type == SSAArgType::eId)
+				rep->addRef(arg, id);
 		}
+		rep->markChanged(id);
 		subExpressions = args;
 	}
 	void SSAExpression::print (Architecture* arch, int indent) {
@@ -360,238 +345,297 @@ namespace holodec {
 	}
 
 
-	void SSARepresentation::replaceNodes (HMap<HId, SSAArgument>* replacements) {
+	void SSARepresentation::replaceNodes (HIdVector<SSAArgument>* replacements) {
+		HPROFILE_COUNT (eReplacedNodes, replacements->ids.size());
 
 		bool replaced = false;
 		do {
 			replaced = false;
-			for (auto it = replacements->begin(); it != replacements->end(); ++it) {
-				if (it->second.type != SSAArgType::eId || it->first == it->second.ssaId)
+			for (HId id : replacements->ids) {
+				SSAArgument& replaceArg = replacements->values[id];
+				if (replaceArg.type != SSAArgType::eId || id == replaceArg.ssaId)
 					continue;
-				auto innerIt = replacements->find(it->second.ssaId);
-				while (innerIt != replacements->end()) {//TODO infinite loop alarm!!!!!!
-					if (it->first == innerIt->second.ssaId)
+				SSAArgument* innerArg = replacements->get (replaceArg.ssaId);
+				while (innerArg) {//TODO infinite loop alarm!!!!!!
+					if (id == innerArg->ssaId)
 						break;
-					it->second.replace(innerIt->second);
-					innerIt = replacements->find(it->second.ssaId);
+					replaceArg.replace (*innerArg);
+					innerArg = replaceArg.type == SSAArgType::eId ? replacements->get (replaceArg.ssaId) : nullptr;
 					replaced = true;
 				}
 			}
 		} while (replaced);
 
-		printf ("Remove\n");
-		for (SSABB& bb : bbs) {
-			for (auto it = bb.exprIds.begin(); it != bb.exprIds.end();) {
-				if (replacements->find (*it) != replacements->end()) {
-					it = removeExpr (bb.exprIds, it);
-					continue;
-				}
-				it++;
-			}
-		}
-		printf ("Change Args\n");
-		for (SSAExpression& expr : expressions) {
-			for (SSAArgument& arg : expr.subExpressions) {
-				if (arg.type == SSAArgType::eId) {
-					auto it = replacements->find(arg.ssaId);
-					if (it != replacements->end()) {
-						arg.replace(it->second);
-					}
-				}
-			}
-			for (auto it = expr.refs.begin(); it != expr.refs.end(); ) {
-				HId refId = *it;
-				auto repIt = replacements->find(refId);
-				if (repIt != replacements->end()) {
-					if (repIt->second.type == SSAArgType::eId){
-						refId = repIt->second.ssaId;
-					}
-					else {
-						expr.refs.erase(it);
-						continue;
-					}
-				}
-				++it;
+		HLOG_TRACE (g_pass_logger, "Change Args");
+		for (HId id : replacements->ids) {
+			//all uses are replaced so the refs are taken at once instead of being removed one by one
+			HList<HId> users;
+			users.swap (expressions[id].refs);
+			std::sort(users.begin(), users.end());
+			users.erase(std::unique(users.begin(), users.end()), users.end());
+			for (HId userId : users) {
+				replaceUseArgs(userId, id, replacements->values[id]);
 			}
 		}
-		recalcRefCounts();
+		HLOG_TRACE (g_pass_logger, "Remove");
+		removeNodes (&replacements->keys);
 	}
 	uint64_t SSARepresentation::replaceAllArgs(SSAExpression& origExpr, SSAArgument replaceArg) {
+		HId origId = origExpr.id;
+		HList<HId> users;
+		users.swap (origExpr.refs);
+		std::sort(users.begin(), users.end());
+		users.erase(std::unique(users.begin(), users.end()), users.end());
 
 		uint64_t count = 0;
-		if (replaceArg.ssaId == origExpr.id) {//don't replace refs and args if replace is the same
-			for (HId id : origExpr.directRefs) {//iterate refs
-				SSAExpression& expr = expressions[id];
-				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.type == SSAArgType::eId && arg.ssaId == origExpr.id) {
-						arg.replace(replaceArg);
-						count++;
-					}
-				}
-			}
-		}
-		else {
-			for (HId id : origExpr.directRefs) {//iterate refs
-				SSAExpression& expr = expressions[id];
-				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.type == SSAArgType::eId && arg.ssaId == origExpr.id) {
-						arg.replace(replaceArg);
-						count++;
-						if (replaceArg.type == SSAArgType::eId)
-							expressions[replaceArg.ssaId].directRefs.push_back(id);
-					}
-				}
-			}
-		}
-		if (!(replaceArg.type == SSAArgType::eId && replaceArg.ssaId == origExpr.id)) {
-			origExpr.directRefs.clear();
-			origExpr.refs.clear();
+		for (HId userId : users) {//iterate refs
+			count += replaceUseArgs(userId, origId, replaceArg);
 		}
 		return count;
 	}
 	uint64_t SSARepresentation::replaceArg(SSAExpression& origExpr, SSAArgument replaceArg) {
+		HId origId = origExpr.id;
+		HList<HId> users;
+		users.swap (origExpr.refs);
+		std::sort(users.begin(), users.end());
+
 		uint64_t count = 0;
-		for (auto it = origExpr.directRefs.begin(); it != origExpr.directRefs.end();++it) {//iterate refs
-			SSAExpression& expr = expressions[*it];
-			if (expr.type == SSAExprType::eFlag) {//ignore flags because they are operation specific
+		HId lastId = 0;
+		for (HId userId : users) {//iterate refs
+			if (userId == lastId)
 				continue;
-			}
-			if (replaceArg.type == SSAArgType::eId && replaceArg.ssaId == origExpr.id) {//don't replace refs and args if replace is the same
-				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.type == SSAArgType::eId && arg.ssaId == origExpr.id) {
-						arg.replace(replaceArg);
-						count++;
-					}
+			lastId = userId;
+			if (expressions[userId].type == SSAExprType::eFlag) {//ignore flags because they are operation specific
+				for (SSAArgument& arg : expressions[userId].subExpressions) {
+					if (arg.type == SSAArgType::eId && arg.ssaId == origId)
+						addRef(arg, userId);
 				}
+				continue;
 			}
-			else {
-				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.type == SSAArgType::eId && arg.ssaId == origExpr.id) {
-						arg.replace(replaceArg);
-						count++;
-						if (replaceArg.type == SSAArgType::eId)
-							expressions[replaceArg.ssaId].refs.push_back(*it);
-					}
-				}
+			count += replaceUseArgs(userId, origId, replaceArg);
+		}
+		return count;
+	}
+	uint64_t SSARepresentation::replaceUses(HId userId, HId origId, SSAArgument replaceArg) {
+		uint64_t count = 0;
+		for (SSAArgument& arg : expressions[userId].subExpressions) {
+			if (arg.type == SSAArgType::eId && arg.ssaId == origId) {
+				removeRef(arg, userId);
+				arg.replace(replaceArg);
+				if (arg.type == SSAArgType::eId)
+					addRef(arg, userId);
+				count++;
 			}
 		}
-		if (!(replaceArg.type == SSAArgType::eId && replaceArg.ssaId == origExpr.id)) {
-			origExpr.directRefs.clear();
-			for (auto it = origExpr.refs.begin(); it != origExpr.refs.end();) {
-				if (expressions[*it].type == SSAExprType::eFlag) {
-					it++;
-					continue;
-				}
-				it = origExpr.refs.erase(it);
+		return count;
+	}
+	uint64_t SSARepresentation::replaceUseArgs(HId userId, HId origId, SSAArgument replaceArg) {
+		markChanged(origId);
+		markChanged(userId);
+		uint64_t count = 0;
+		for (SSAArgument& arg : expressions[userId].subExpressions) {
+			if (arg.type == SSAArgType::eId && arg.ssaId == origId) {
+				arg.replace(replaceArg);
+				if (arg.type == SSAArgType::eId)
+					addRef(arg, userId);
+				count++;
 			}
 		}
 		return count;
 	}
-	void SSARepresentation::removeNodes (HSet<HId>* ids) {
+	uint64_t SSARepresentation::removeNodes (HIdBitSet* ids) {
+		uint64_t count = 0;
 		for (SSABB& bb : bbs) {
-			for (auto it = bb.exprIds.begin(); it != bb.exprIds.end();) {
-				if (ids->find (*it) != ids->end())
-					it = removeExpr (bb.exprIds, it);
-				else
-					++it;
+			auto writeIt = bb.exprIds.begin();
+			for (HId id : bb.exprIds) {
+				if (ids->contains (id)) {
+					SSAExpression& expr = expressions[id];
+					removeRefs (&expr);
+					freeIds.push_back (expr.id);
+					expr.id = 0;
+					count++;
+				} else {
+					*writeIt++ = id;
+				}
 			}
+			bb.exprIds.erase (writeIt, bb.exprIds.end());
 		}
+		if (count)
+			invalidateExpressions();
+		HPROFILE_COUNT (eExpressionsRemoved, count);
+		return count;
 	}
 
 	void SSARepresentation::compress() {
-
-		std::map<HId, HId> replacements;
-
-		expressions.shrink ([&replacements] (HId oldId, HId newId) {
-			replacements[oldId] = newId;
-		});
-
-		if (!replacements.empty()) {
-			for (SSAExpression& expr : expressions) {
-				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.type == SSAArgType::eId) {
-						auto it = replacements.find (arg.ssaId);
-						if (it != replacements.end()) {
-							arg.ssaId = it->second;
-						}
-					}
-				}
+		HPROFILE_COUNT (eCompressCalls, 1);
+		//renumber the expressions in block order so that neighbouring expressions are close in memory
+		HList<HId> newIds (expressions.size() + 1, 0);
+		HList<SSAExpression> newExpressions;
+		newExpressions.reserve (expressions.size() - freeIds.size());
+		for (SSABB& bb : bbs) {
+			for (HId id : bb.exprIds) {
+				if (!expressions[id].id || newIds[id])
+					continue;
+				newExpressions.push_back (expressions[id]);
+				newIds[id] = newExpressions.size();
 			}
-			for (SSABB& bb : bbs) {
-				for (HId& id : bb.exprIds) {
-					auto it = replacements.find (id);
-					if (it != replacements.end()) {
-						id = it->second;
-					}
-				}
+		}
+		for (SSAExpression& expr : expressions) {//expressions that are not part of any block
+			if (!expr.id || newIds[expr.id])
+				continue;
+			newExpressions.push_back (expr);
+			newIds[expr.id] = newExpressions.size();
+		}
+		HPROFILE_COUNT (eCompressedExpressions, newExpressions.size());
+		for (HId id = 1; id < newIds.size(); id++) {
+			if (newIds[id] && newIds[id] != id) {
+				idVersion++;
+				break;
+			}
+		}
+		for (SSAExpression& expr : newExpressions) {
+			expr.id = newIds[expr.id];
+			for (SSAArgument& arg : expr.subExpressions) {
+				if (arg.type == SSAArgType::eId && arg.ssaId)
+					arg.ssaId = arg.ssaId < newIds.size() ? newIds[arg.ssaId] : 0;
+			}
+			for (HId& refId : expr.refs) {
+				refId = newIds[refId];
 			}
 		}
+		for (SSABB& bb : bbs) {
+			for (HId& id : bb.exprIds) {
+				id = newIds[id];
+			}
+		}
+		expressions.list.swap (newExpressions);
+		freeIds.clear();
+		constLattice.clear();//indexed by the old ids
+		auto changedIt = changedExprs.begin();
+		changedSet.clear();
+		for (HId id : changedExprs) {
+			if (id < newIds.size() && newIds[id]) {
+				*changedIt++ = newIds[id];
+				changedSet.insert (newIds[id]);
+			}
+		}
+		changedExprs.erase (changedIt, changedExprs.end());
+	}
+	bool SSARepresentation::compressIfSparse() {
+		if (expressions.size() == 0 || freeIds.size() < expressions.size() * SSA_COMPRESS_DEAD_RATIO)
+			return false;
+		compress();
+		return true;
+	}
+
+	SSADominatorTree* SSARepresentation::getDominatorTree() {
+		if (domTree.cfgVersion != cfgVersion)
+			domTree.build (this, false);
+		return &domTree;
+	}
+	SSADominatorTree* SSARepresentation::getPostDominatorTree() {
+		if (postDomTree.cfgVersion != cfgVersion)
+			postDomTree.build (this, true);
+		return &postDomTree;
+	}
+	SSALiveness* SSARepresentation::getLiveness(Architecture* arch) {
+		if (liveness.version != version)
+			liveness.analyze (arch, this);
+		return &liveness;
+	}
+	SSAConstLattice* SSARepresentation::getConstLattice() {
+		if (constLattice.version != version)
+			constLattice.analyze (this);
+		return &constLattice;
 	}
 
 	bool SSARepresentation::checkIntegrity() {
+		HList<HList<HId>> refs (expressions.size() + 1);
 		for (SSAExpression& expr : expressions) {
-			if (expr.id)
-				for (SSAArgument& arg : expr.subExpressions)
-					if (!(arg.type != SSAArgType::eId || (arg.ssaId && arg.ssaId <= expressions.size() && expressions[arg.ssaId].id)))
-						return false;
-			for (HId& id : expr.refs)
-				if (!(id && id <= expressions.size() && expressions[id].id))
+			if (!expr.id)
+				continue;
+			for (SSAArgument& arg : expr.subExpressions) {
+				if (arg.type != SSAArgType::eId)
+					continue;
+				if (!(arg.ssaId && arg.ssaId <= expressions.size() && expressions[arg.ssaId].id))
 					return false;
-			for (HId& id : expr.directRefs)
-				if (!(id && id <= expressions.size() && expressions[id].id))
+				HList<HId>& argRefs = expressions[arg.ssaId].refs;
+				if (!(arg.refIndex < argRefs.size() && argRefs[arg.refIndex] == expr.id))
 					return false;
+				refs[arg.ssaId].push_back(expr.id);
+			}
+		}
+		for (SSAExpression& expr : expressions) {
+			if (!expr.id)
+				continue;
+			HList<HId> exprRefs = expr.refs;
+			std::sort(exprRefs.begin(), exprRefs.end());
+			std::sort(refs[expr.id].begin(), refs[expr.id].end());
+			if (exprRefs != refs[expr.id])
+				return false;
 		}
 		return true;
 	}
 
-	void SSARepresentation::propagateRefCount (SSAExpression* expr) {
-		for (SSAArgument& arg : expr->subExpressions) {
-			if (arg.type == SSAArgType::eId && arg.ssaId) {
-				expressions[arg.ssaId].directRefs.push_back(expr->id);
-				changeRefCount(arg.ssaId, expr->id);
-			}
-		}
-	}
-	void SSARepresentation::propagateRefCount (HId id) {
-		if (!id)
+	void SSARepresentation::addRef (SSAArgument& arg, HId refId) {
+		if (!arg.ssaId)
 			return;
-		propagateRefCount (&expressions[id]);
-	}
-	void SSARepresentation::changeRefCount (HId id, HId refId) {
+		HList<HId>& refs = expressions[arg.ssaId].refs;
+		arg.refIndex = refs.size();
+		refs.push_back(refId);
+		markChanged(arg.ssaId);
+		markChanged(refId);
+	}
+	void SSARepresentation::removeRef (SSAArgument& arg, HId refId) {
+		HId id = arg.ssaId;
 		if (!id)
 			return;
-		SSAExpression& expr = expressions[id];
-		expr.refs.push_back(refId);
-		if (EXPR_IS_TRANSPARENT (expr.type)) {
-			std::vector<bool> visited;
-			visited.resize (expressions.size(), false);
-			changeRefCount (id, visited, refId);
+		markChanged(id);
+		markChanged(refId);
+		HList<HId>& refs = expressions[id].refs;
+		size_t index = arg.refIndex;
+		if (index >= refs.size() || refs[index] != refId) {//the argument was copied without its ref
+			index = refs.size();
+			while (index > 0 && refs[index - 1] != refId)
+				index--;
+			if (!index)
+				return;
+			index--;
+		}
+		//the order of the refs does not matter, so the last one takes the place of the removed one
+		//and the argument that owns the last one is moved with it
+		size_t last = refs.size() - 1;
+		if (index != last) {
+			HId movedId = refs[last];
+			refs[index] = movedId;
+			for (SSAArgument& movedArg : expressions[movedId].subExpressions) {
+				if (movedArg.type == SSAArgType::eId && movedArg.ssaId == id && movedArg.refIndex == last) {
+					movedArg.refIndex = index;
+					break;
+				}
+			}
 		}
+		refs.pop_back();
 	}
-	void SSARepresentation::changeRefCount (HId id, std::vector<bool>& visited, HId refId) {
-		if (!id || visited[id - 1])
-			return;
-		visited[id - 1] = true;
-		SSAExpression& expr = expressions[id];
-		expr.refs.push_back(refId);
-		if (EXPR_IS_TRANSPARENT (expr.type)) {
-			for (SSAArgument& arg : expr.subExpressions) {
-				if (arg.type == SSAArgType::eId)
-					changeRefCount (arg.ssaId, visited, refId);
-			}
+	void SSARepresentation::addRefs (SSAExpression* expr) {
+		for (SSAArgument& arg : expr->subExpressions) {
+			if (arg.type == SSAArgType::eId)
+				addRef(arg, expr->id);
 		}
-		else {
-			expr.refs.push_back(refId);
+	}
+	void SSARepresentation::removeRefs (SSAExpression* expr) {
+		for (SSAArgument& arg : expr->subExpressions) {
+			if (arg.type == SSAArgType::eId)
+				removeRef(arg, expr->id);
 		}
 	}
 	void SSARepresentation::recalcRefCounts() {
 		for (SSAExpression& expr : expressions) {
 			expr.refs.clear();
-			expr.directRefs.clear();
 		}
 		for (SSAExpression& expr : expressions) {
 			if (expr.id) {
-				propagateRefCount(&expr);
+				addRefs(&expr);
 			}
 		}
 	}
@@ -612,27 +656,26 @@ namespace holodec {
 			}
 		}
 		else if (argument.type == SSAArgType::eId) {
-			SSAExpression& expr = expressions[argument.ssaId];
-			switch (expr.type) {
-			case SSAExprType::eLoadAddr:
-				uint64_t base, index, disp, offset;
-				if (calcConstValue(expr.subExpressions[1], &base) &&
-					calcConstValue(expr.subExpressions[2], &index) &&
-					calcConstValue(expr.subExpressions[3], &disp) &&
-					calcConstValue(expr.subExpressions[4], &offset)) {
-					*result = base + (index * disp) + offset;
-					return true;
-				}
-			}
+			return getConstLattice()->getConst(argument.ssaId, result);
 		}
 		return false;
 	}
 	HId SSARepresentation::addExpr (SSAExpression* expr) {
 		expr->uniqueId = exprIdGen.next();
-		expressions.push_back (*expr);
-		HId newId = expressions.back().id;
-		if (!EXPR_IS_TRANSPARENT (expr->type))
-			propagateRefCount (newId);
+		HPROFILE_COUNT (eExpressionsCreated, 1);
+		HId newId;
+		if (!freeIds.empty()) {//reuse the slot of a removed expression
+			newId = freeIds.back();
+			freeIds.pop_back();
+			expressions[newId] = *expr;
+			expressions[newId].id = newId;
+		} else {
+			newId = expressions.push_back (*expr);
+		}
+		SSAExpression& newExpr = expressions[newId];
+		newExpr.refs.clear();
+		addRefs (&newExpr);
+		markChanged(newId);
 		return newId;
 	}
 
@@ -716,7 +759,11 @@ namespace holodec {
 
 	HList<HId>::iterator SSARepresentation::removeExpr (HList<HId>& ids, HList<HId>::iterator it) {
 		SSAExpression& expr = expressions[*it];
+		HPROFILE_COUNT (eExpressionsRemoved, 1);
+		removeRefs (&expr);
+		freeIds.push_back (expr.id);
 		expr.id = 0;
+		invalidateExpressions();
 		return ids.erase (it);
 	}
 	void SSARepresentation::removeExpr (HId ssaId, HId blockId) {
@@ -8,11 +8,16 @@
 #include "Argument.h"
 #include "General.h"
 #include "HIdList.h"
+#include "SSADominatorTree.h"
+#include "SSALiveness.h"
+#include "SSAConstLattice.h"
 #include "CHolodecHeader.h"
 
 #include <assert.h>
 
 #define SSA_LOCAL_USEID_MAX (4)
+//fraction of removed expressions after which compressIfSparse renumbers the expressions
+#define SSA_COMPRESS_DEAD_RATIO (0.25)
 
 namespace holodec {
 
@@ -122,6 +127,7 @@ namespace holodec {
 		//HId id = 0;
 		SSAArgType type = SSAArgType::eUndef;
 		uint32_t offset = 0, size = -1;
+		uint32_t refIndex = 0;//position of this use in the refs of ssaId
 		union {
 			HId ssaId;
 			ArgSInt sval;
@@ -292,13 +298,16 @@ namespace holodec {
 		uint64_t instrAddr = 0;
 		
 		//HLocalBackedList<SSAArgument, SSA_LOCAL_USEID_MAX> subExpressions;
+		//the expressions using this one, one entry for every argument referencing it
+		//kept up to date by the argument functions below and the add/remove/replace functions of SSARepresentation
 		HList<HId> refs;
-		HList<HId> directRefs;
 		HList<SSAArgument> subExpressions;
 
 		void addArgument(SSARepresentation* rep, SSAArgument arg);
 		void setArgument(SSARepresentation* rep, int index, SSAArgument arg);
+		HList<SSAArgument>::iterator insertArgument(SSARepresentation* rep, HList<SSAArgument>::iterator it, SSAArgument arg);
 		HList<SSAArgument>::iterator removeArgument(SSARepresentation* rep, HList<SSAArgument>::iterator it);
+		HList<SSAArgument>::iterator removeArguments(SSARepresentation* rep, HList<SSAArgument>::iterator first, HList<SSAArgument>::iterator last);
 		void replaceArgument(SSARepresentation* rep, int index, SSAArgument arg);
 		void setAllArguments(SSARepresentation* rep, HList<SSAArgument> args);
 
@@ -312,11 +321,11 @@ namespace holodec {
 	};
 	inline bool operator== (SSAExpression& lhs, SSAExpression& rhs) {
 		if (lhs.type == rhs.type && lhs.size == rhs.size && lhs.exprtype == rhs.exprtype && lhs.location == rhs.location && lhs.locref.refId == rhs.locref.refId && lhs.locref.index == rhs.locref.index) {
-			if (lhs.subExpressions.size() == rhs.subExpressions.size()) {
-				for (size_t i = 0; i < lhs.subExpressions.size(); i++) {
-					if (lhs.subExpressions[i] != rhs.subExpressions[i])
-						return false;
-				}
+			if (lhs.subExpressions.size() != rhs.subExpressions.size())
+				return false;
+			for (size_t i = 0; i < lhs.subExpressions.size(); i++) {
+				if (lhs.subExpressions[i] != rhs.subExpressions[i])
+					return false;
 			}
 			switch (rhs.type) {
 			case SSAExprType::eFlag:
@@ -354,31 +363,91 @@ namespace holodec {
 	struct SSARepresentation {
 		HIdList<SSABB> bbs;
 		HSparseIdList<SSAExpression> expressions;
+		HList<HId> freeIds;//slots of removed expressions which are reused by addExpr
 
 		HIdGenerator exprIdGen;
 
+		uint64_t cfgVersion = 1;
+		uint64_t version = 1;//changes with every change of the cfg or the expressions
+		uint64_t idVersion = 1;//changes when compress gives expressions new ids
+		SSADominatorTree domTree;
+		SSADominatorTree postDomTree;
+		SSALiveness liveness;
+		SSAConstLattice constLattice;
+
+		//when enabled every expression that is added or whose arguments or users change is logged
+		//every id is logged once until the changes are cleared, the ids are remapped by compress
+		bool trackChanges = false;
+		HList<HId> changedExprs;
+		HIdBitSet changedSet;//the ids in changedExprs
+
 		void clear(){
 			bbs.clear();
 			expressions.clear();
+			freeIds.clear();
+			trackChanges = false;
+			changedExprs.clear();
+			changedSet.clear();
+			invalidateCFG();
 		}
 
-		void replaceNodes(HMap<HId,SSAArgument>* replacements);
+		//has to be called whenever blocks or edges between blocks change
+		void invalidateCFG() {
+			cfgVersion++;
+			version++;
+		}
+		//has to be called whenever expressions or their arguments change
+		void invalidateExpressions() {
+			version++;
+		}
+		//has to be called when an expression is changed in place, e.g. its type or the offset of an argument
+		//changes of the arguments through the functions of SSAExpression are marked already
+		//the cached analyses are invalidated and the change is logged
+		void markChanged(HId id) {
+			version++;
+			logChange(id);
+		}
+		//logs the expression without invalidating the analyses, e.g. to visit it again in the next run of a pass
+		void logChange(HId id) {
+			if (!trackChanges || !id || changedSet.contains(id))
+				return;
+			changedSet.insert(id);
+			changedExprs.push_back(id);
+		}
+		void clearChanges() {
+			for (HId id : changedExprs)
+				changedSet.erase(id);
+			changedExprs.clear();
+		}
+		//the trees are cached until the cfg is invalidated
+		SSADominatorTree* getDominatorTree();
+		SSADominatorTree* getPostDominatorTree();
+		//cached until the cfg or the expressions are invalidated
+		SSALiveness* getLiveness(Architecture* arch);
+		//cached until the cfg or the expressions are invalidated
+		SSAConstLattice* getConstLattice();
+
+		void replaceNodes(HIdVector<SSAArgument>* replacements);
 		uint64_t replaceAllArgs(SSAExpression& origExpr, SSAArgument replaceArg);
 		uint64_t replaceArg(SSAExpression& origExpr, SSAArgument replaceArg);
-		void removeNodes(HSet<HId>* ids);
+		uint64_t replaceUses(HId userId, HId origId, SSAArgument replaceArg);
+		//like replaceUses but the refs of origId are left alone, for callers that took all of them
+		uint64_t replaceUseArgs(HId userId, HId origId, SSAArgument replaceArg);
+		uint64_t removeNodes(HIdBitSet* ids);
 		
 		void compress();
+		bool compressIfSparse();
 		
 		bool checkIntegrity();
 
-		void propagateRefCount(SSAExpression* expr);
-		void propagateRefCount(HId id);
-		
-		void changeRefCount(HId id, HId refId);
-		void changeRefCount(HId id, std::vector<bool>& visited, HId refId);
+		void addRef(SSAArgument& arg, HId refId);
+		void removeRef(SSAArgument& arg, HId refId);
+		void addRefs(SSAExpression* expr);
+		void removeRefs(SSAExpression* expr);
 		
 		void recalcRefCounts();
 
+		//uses the values of the cached constant lattice
 		bool calcConstValue(SSAArgument argument, uint64_t* result);
 		
 		HId addExpr(SSAExpression* expr);
@@ -4,6 +4,8 @@
 #include "Function.h"
 #include "Architecture.h"
 
+#include <algorithm>
+
 
 namespace holodec {
 
@@ -11,18 +13,25 @@ namespace holodec {
 
 		bool applied = false;
 
+		//the blocks by their start address, the first block of an address is taken like a scan over the blocks would
+		HMap<uint64_t, SSABB*> blocksByAddr;
+		for (SSABB& bb : function->ssaRep.bbs)
+			blocksByAddr.emplace(bb.startaddr, &bb);
+		auto getBlock = [&blocksByAddr] (uint64_t addr) -> SSABB* {
+			auto it = blocksByAddr.find(addr);
+			return it != blocksByAddr.end() ? it->second : nullptr;
+		};
+
 		for (SSABB& block : function->ssaRep.bbs) {
 			if (block.exprIds.size() && function->ssaRep.expressions[block.exprIds.back()].type == SSAExprType::eReturn)//if last statement is return then we do nothing
 				continue;
 			if (!block.fallthroughId) {
 				if (function->ssaRep.expressions[block.exprIds.back()].type != SSAExprType::eJmp && function->ssaRep.expressions[block.exprIds.back()].type != SSAExprType::eReturn) {
-					for (SSABB& bb : function->ssaRep.bbs) {
-						if (bb.startaddr == block.endaddr) {
-							block.fallthroughId = bb.id;
-							block.outBlocks.insert(bb.id);
-							bb.inBlocks.insert(block.id);
-							break;
-						}
+					if (SSABB* bb = getBlock(block.endaddr)) {
+						block.fallthroughId = bb->id;
+						block.outBlocks.insert(bb->id);
+						bb->inBlocks.insert(block.id);
+						function->ssaRep.invalidateCFG();
 					}
 				}
 				else {
@@ -32,60 +41,96 @@ namespace holodec {
 
 			for (HId& id : block.exprIds) {
 				SSAExpression& expression = function->ssaRep.expressions[id];
-				if (expression.type == SSAExprType::eJmp || expression.type == SSAExprType::eCJmp) {
-					if (expression.subExpressions[0].type == SSAArgType::eUInt) {
-						for (SSABB& bb : function->ssaRep.bbs) {
-							if (bb.startaddr == expression.subExpressions[0].uval) {
-								expression.subExpressions[0] = SSAArgument::createBlock(bb.id);
-								block.outBlocks.insert(bb.id);
-								bb.inBlocks.insert(block.id);
-								applied = true;
-								break;
-							}
-						}
-					}
-					else {
-						if (expression.subExpressions[0].type == SSAArgType::eOther && expression.subExpressions[0].location != SSALocation::eBlock) {
-							SSAExpression& loadExpr = function->ssaRep.expressions[expression.subExpressions[0].ssaId];
-							if (loadExpr.type == SSAExprType::eLoad) {
-								uint64_t baseaddr;
-								if (function->ssaRep.calcConstValue(loadExpr.subExpressions[0], &baseaddr)) {
-									if (arch->bitbase < sizeof(uint64_t) * 8)
-										baseaddr %= (1 << arch->bitbase);
-
-									Symbol* sym = binary->findSymbol(baseaddr, &SymbolType::symdynfunc);
-									if (sym) {
-										sym->print();
-									}
-								}
-							}
-						}
-						for (Register& reg : arch->registers) {
-							if (!reg.id || reg.directParentRef)
-								continue;
-							expression.subExpressions.push_back(SSAArgument::createReg(&reg, 0));
-						}
+				if ((expression.type == SSAExprType::eJmp || expression.type == SSAExprType::eCJmp) && expression.subExpressions[0].type == SSAArgType::eUInt) {
+					if (SSABB* bb = getBlock(expression.subExpressions[0].uval)) {
+						expression.subExpressions[0] = SSAArgument::createBlock(bb->id);
+						function->ssaRep.markChanged(expression.id);
+						block.outBlocks.insert(bb->id);
+						bb->inBlocks.insert(block.id);
+						function->ssaRep.invalidateCFG();
 						applied = true;
 					}
 				}
 				else if (expression.type == SSAExprType::eMultiBranch) {
 					for (auto it = expression.subExpressions.begin() + 1; it != expression.subExpressions.end(); ++it) {
-						if (it->type == SSAArgType::eUInt) {
-							for (SSABB& bb : function->ssaRep.bbs) {
-								if (bb.startaddr == it->uval) {
-									it->set(SSAArgument::createBlock(bb.id));
-									block.outBlocks.insert(bb.id);
-									bb.inBlocks.insert(block.id);
-									applied = true;
-									break;
-								}
+						if (it->type != SSAArgType::eUInt)
+							continue;
+						if (SSABB* bb = getBlock(it->uval)) {
+							it->set(SSAArgument::createBlock(bb->id));
+							function->ssaRep.markChanged(expression.id);
+							block.outBlocks.insert(bb->id);
+							bb->inBlocks.insert(block.id);
+							function->ssaRep.invalidateCFG();
+							applied = true;
+						}
+					}
+				}
+			}
+		}
+
+		//the targets of the indirect jumps are resolved after all edges are known with one analysis of the constants
+		//resolving them only adds arguments so the lattice stays valid for the whole loop
+		SSAConstLattice* lattice = nullptr;
+		for (SSABB& block : function->ssaRep.bbs) {
+			for (HId& id : block.exprIds) {
+				SSAExpression& expression = function->ssaRep.expressions[id];
+				if (expression.type != SSAExprType::eJmp && expression.type != SSAExprType::eCJmp)
+					continue;
+				SSAArgument& target = expression.subExpressions[0];
+				if (target.type == SSAArgType::eUInt || (target.type == SSAArgType::eOther && target.location == SSALocation::eBlock))
+					continue;
+				uint64_t targetaddr;
+				Function* targetFunc = nullptr;
+				if (target.type == SSAArgType::eId && target.ssaId) {
+					if (!lattice)
+						lattice = function->ssaRep.getConstLattice();
+					if (lattice->getConst(target.ssaId, &targetaddr))
+						targetFunc = binary->getFunctionByAddr(targetaddr);
+				}
+				if (expression.subExpressions[0].type == SSAArgType::eOther && expression.subExpressions[0].location != SSALocation::eBlock) {
+					SSAExpression& loadExpr = function->ssaRep.expressions[expression.subExpressions[0].ssaId];
+					if (loadExpr.type == SSAExprType::eLoad) {
+						uint64_t baseaddr;
+						if (function->ssaRep.calcConstValue(loadExpr.subExpressions[0], &baseaddr)) {
+							if (arch->bitbase < sizeof(uint64_t) * 8)
+								baseaddr %= (1 << arch->bitbase);
+
+							Symbol* sym = binary->findSymbol(baseaddr, &SymbolType::symdynfunc);
+							if (sym) {
+								sym->print();
 							}
 						}
 					}
 				}
+				//only the called functions are set up before this one, the others may be set up at the same time
+				if (targetFunc && std::find(function->funcsCalled.begin(), function->funcsCalled.end(), targetaddr) == function->funcsCalled.end())
+					targetFunc = nullptr;
+				if (targetFunc && targetFunc->liveInKnown) {
+					//only the registers read by the target function are arguments
+					for (uint32_t i = 0; i < arch->parentRegs.size(); i++) {
+						if (targetFunc->liveInRegs.contains(i))
+							expression.addArgument(&function->ssaRep, SSAArgument::createReg(arch->getRegister(arch->parentRegs[i]), 0));
+					}
+				}
+				else {
+					//the target is unknown or its blocks are not connected yet so every register may be read
+					for (Register& reg : arch->registers) {
+						if (!reg.id || reg.directParentRef)
+							continue;
+						expression.addArgument(&function->ssaRep, SSAArgument::createReg(&reg, 0));
+					}
+				}
+				applied = true;
 			}
 		}
 
+		//jumps from other functions to this one take the registers read here as arguments
+		if (!function->ssaRep.bbs.list.empty()) {
+			SSALiveness* liveness = function->ssaRep.getLiveness(arch);
+			function->liveInRegs = liveness->liveIn[function->ssaRep.bbs.list[0].id];
+		}
+		function->liveInKnown = true;
+
 		return applied;
 	}
 }
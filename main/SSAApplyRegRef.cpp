@@ -1,4 +1,6 @@
 #include "SSAApplyRegRef.h"
+#include "SSARegStateSolver.h"
+#include "Architecture.h"
 
 
 
@@ -6,75 +8,61 @@ namespace holodec {
 
 	bool SSAApplyRegRef::doTransformation(Binary* binary, Function* function) {
 		bool applied = false;
-		function->regStates.states.clear();
+		SSARegStateSolver solver(arch, binary);
+		solver.calcRegState(function, &function->regStates);
+
+		HIdBitSet unusedArgs;
 		for (SSAExpression& expr : function->ssaRep.expressions) {
-			if (expr.type == SSAExprType::eReturn) {
+			if (!expr.id)
+				continue;
+			if (expr.type == SSAExprType::eCall) {
+				FuncRegState* callState = solver.getCalleeState(expr);
+				if (!callState)
+					continue;
+				//mask of the register arguments that are not read by the called function
+				unusedArgs.clear();
 				for (SSAArgument& arg : expr.subExpressions) {
-					if (arg.location == SSALocation::eReg) {
-						Register* reg = arch->getRegister(arg.locref.refId);
-						RegisterState* state = function->regStates.getNewRegisterState(reg->parentRef.refId);
-						state->flags |= RegisterUsedFlag::eWrite;
-					}
-				}
-			}
-			else if (expr.type == SSAExprType::eInput) {
-				if (expr.location == SSALocation::eReg) {
-					Register* reg = arch->getRegister(expr.locref.refId);
-					RegisterState* state = function->regStates.getNewRegisterState(reg->parentRef.refId);
-					state->flags |= RegisterUsedFlag::eRead;
+					if (arg.location == SSALocation::eReg && arch->getRegSlice(arg.locref.refId))
+						unusedArgs.insert(arch->getRegSlice(arg.locref.refId)->parentIndex);
 				}
-			}
-			else if (expr.type == SSAExprType::eCall) {
-				if (expr.subExpressions[0].type != SSAArgType::eUInt)
+				unusedArgs.subtract(callState->reads);
+				if (unusedArgs.empty())
 					continue;
-				Function* callFunc = binary->getFunctionByAddr(expr.subExpressions[0].uval);
-				if (!(callFunc && callFunc->regStates.parsed))
-					continue;
-				for (auto it = expr.subExpressions.begin(); it != expr.subExpressions.end(); ++it) {
-					if (it->location != SSALocation::eReg)
-						continue;
-					Register* reg = arch->getRegister(it->locref.refId);
-					if (!reg)
-						continue;
-					RegisterState* state = callFunc->regStates.getRegisterState(reg->parentRef.refId);
-					if (!state || !state->flags.contains(RegisterUsedFlag::eRead)) {
-						it = expr.subExpressions.erase(it) - 1;
+				for (auto it = expr.subExpressions.begin(); it != expr.subExpressions.end();) {
+					if (it->location == SSALocation::eReg && arch->getRegSlice(it->locref.refId) && unusedArgs.contains(arch->getRegSlice(it->locref.refId)->parentIndex)) {
+						it = expr.removeArgument(&function->ssaRep, it);
 						applied = true;
-						continue;
+					}
+					else {
+						++it;
 					}
 				}
 			}
 			else if (expr.type == SSAExprType::eOutput) {
 				if (expr.subExpressions[0].type != SSAArgType::eId || expr.location != SSALocation::eReg)
 					continue;
-				SSAExpression& callExpr = function->ssaRep.expressions[expr.subExpressions[0].ssaId];
-				if (callExpr.subExpressions[0].type != SSAArgType::eUInt)
+				FuncRegState* callState = solver.getCalleeState(function->ssaRep.expressions[expr.subExpressions[0].ssaId]);
+				RegisterSlice* slice = arch->getRegSlice(expr.locref.refId);
+				if (!callState || !slice)
 					continue;
-				Function* callFunc = binary->getFunctionByAddr(callExpr.subExpressions[0].uval);
-				if (!(callFunc && callFunc->regStates.parsed))
-					continue;
-				Register* reg = arch->getRegister(expr.locref.refId);
-				if (!reg)
-					continue;
-				RegisterState* state = callFunc->regStates.getRegisterState(reg->parentRef.refId);
-				if (!state || !state->flags.contains(RegisterUsedFlag::eWrite)) {
-					expr.type = SSAExprType::eAssign;
-					expr.subExpressions.erase(expr.subExpressions.begin());
-					applied = true;
+				if (!callState->writes.contains(slice->parentIndex)) {
+					if (expr.subExpressions.size() > 1) {
+						expr.type = SSAExprType::eAssign;
+						function->ssaRep.markChanged(expr.id);
+						expr.removeArgument(&function->ssaRep, expr.subExpressions.begin());
+						applied = true;
+					}
 				}
-				else if (!state || !state->flags.contains(RegisterUsedFlag::eRead)) {
+				else if (!callState->reads.contains(slice->parentIndex)) {
 					if (expr.subExpressions.size() > 1) {
-						expr.subExpressions.erase(expr.subExpressions.begin() + 1);
+						expr.removeArgument(&function->ssaRep, expr.subExpressions.begin() + 1);
 						applied = true;
-
 					}
 				}
 			}
 		}
-		function->regStates.parsed = true;
 		return applied;
 	}
 
 
 }
-
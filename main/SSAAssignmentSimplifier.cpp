@@ -1,4 +1,5 @@
 #include "SSAAssignmentSimplifier.h"
+#include "HoloIO.h"
 #include "Argument.h"
 
 #include "General.h"
@@ -11,11 +12,10 @@ namespace holodec{
 	
 	bool SSAAssignmentSimplifier::doTransformation (Binary* binary, Function* function){
 		
-		printf ("Simplifying Assignments for Function at Address 0x%" PRIx64 "\n", function->baseaddr);
+		HLOG_DEBUG (g_pass_logger, "Simplifying Assignments for Function at Address 0x%" PRIx64, function->baseaddr);
 		
-		HMap<HId, SSAArgument> replacements;
+		HIdVector<SSAArgument> replacements (function->ssaRep.expressions.size());
 
-		replacements.clear();
 		for(SSAExpression& expr : function->ssaRep.expressions){
 			if(!expr.id)
 				continue;
@@ -41,16 +41,15 @@ namespace holodec{
 					}
 				}
 				if(undef){
-					replacements.insert(std::pair<HId, SSAArgument>(expr.id, SSAArgument::createUndef (expr.location, expr.locref, expr.size)));
+					replacements.insert(expr.id, SSAArgument::createUndef (expr.location, expr.locref, expr.size));
 				}else if(alwaysTheSame){
-					replacements.insert(std::pair<HId, SSAArgument>(expr.id, cmpArg));
+					replacements.insert(expr.id, cmpArg);
 				}
 			}
 		}
 		if(replacements.empty())
 			return false;
 		function->ssaRep.replaceNodes(&replacements);
-		function->ssaRep.compress();
 		return true;
 	}
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "SSACallingConvApplier.h"
+#include "HoloIO.h"
 #include "CallingConvention.h"
 #include "Architecture.h"
 #include <assert.h>
@@ -7,7 +8,7 @@ namespace holodec {
 
 	bool SSACallingConvApplier::doTransformation (Function* function) {
 
-		printf ("Apply Calling Convention in Function at Address 0x%" PRIx64 "\n", function->baseaddr);
+		HLOG_DEBUG (g_pass_logger, "Apply Calling Convention in Function at Address 0x%" PRIx64, function->baseaddr);
 		/*
 		CallingConvention* cc = arch->getCallingConvention (function->callingconvention);
 
@@ -0,0 +1,380 @@
+#include "SSAConstLattice.h"
+#include "SSA.h"
+
+#include <algorithm>
+
+namespace holodec {
+
+	static uint64_t maskToSize (uint64_t value, uint32_t size) {
+		if (size && size < 64)
+			return value & (((uint64_t) 1 << size) - 1);
+		return value;
+	}
+	static int64_t signExtend (uint64_t value, uint32_t size) {
+		if (size && size < 64 && (value >> (size - 1)) & 1)
+			return static_cast<int64_t> (value | ~(((uint64_t) 1 << size) - 1));
+		return static_cast<int64_t> (value);
+	}
+	static SSAConstValue constValue (uint64_t value) {
+		SSAConstValue result;
+		result.state = SSAConstState::eConst;
+		result.value = value;
+		return result;
+	}
+	static SSAConstValue varying() {
+		SSAConstValue result;
+		result.state = SSAConstState::eVarying;
+		return result;
+	}
+	//the value of a phi that can take both values
+	static SSAConstValue meet (SSAConstValue lhs, SSAConstValue rhs) {
+		if (lhs.state == SSAConstState::eUnknown)
+			return rhs;
+		if (rhs.state == SSAConstState::eUnknown)
+			return lhs;
+		if (lhs.state == SSAConstState::eConst && rhs.state == SSAConstState::eConst && lhs.value == rhs.value)
+			return lhs;
+		return varying();
+	}
+
+	void SSAConstLattice::analyze (SSARepresentation* ssaRep) {
+		this->ssaRep = ssaRep;
+		version = ssaRep->version;
+		size_t maxId = ssaRep->expressions.size();
+		size_t n = ssaRep->bbs.list.empty() ? 1 : ssaRep->bbs.list.back().id + 1;
+
+		values.assign (maxId + 1, SSAConstValue());
+		exprBlocks.assign (maxId + 1, 0);
+		executableBlocks = HIdBitSet (n);
+		executableIn.assign (n, HList<HId>());
+		visitedBlocks = HIdBitSet (n);
+		rootBlocks = HIdBitSet (n);
+		blockWorklist.clear();
+		exprWorklist.clear();
+
+		HList<uint32_t> predCount (n, 0);
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds)
+				exprBlocks[id] = bb.id;
+			for (HId outId : bb.outBlocks) {
+				if (outId < n)
+					predCount[outId]++;
+			}
+			if (bb.fallthroughId && bb.fallthroughId < n && std::find (bb.outBlocks.begin(), bb.outBlocks.end(), bb.fallthroughId) == bb.outBlocks.end())
+				predCount[bb.fallthroughId]++;
+		}
+		//blocks without predecessors may be the target of a jump that is not resolved yet
+		for (SSABB& bb : ssaRep->bbs) {
+			if (bb.id == ssaRep->bbs.list[0].id || !predCount[bb.id]) {
+				rootBlocks.insert (bb.id);
+				executableBlocks.insert (bb.id);
+				blockWorklist.push_back (bb.id);
+			}
+		}
+		do {
+			while (!blockWorklist.empty() || !exprWorklist.empty()) {
+				if (!blockWorklist.empty()) {
+					HId blockId = blockWorklist.back();
+					blockWorklist.pop_back();
+					visitBlock (blockId);
+					continue;
+				}
+				HId id = exprWorklist.back();
+				exprWorklist.pop_back();
+				SSAExpression& expr = ssaRep->expressions[id];
+				if (expr.id && visitedBlocks.contains (exprBlocks[id]))
+					visitExpression (expr);
+			}
+			//a condition that stays unknown depends on an expression that is not dominated by its definition
+			//so both successors are taken
+			for (SSABB& bb : ssaRep->bbs) {
+				if (!visitedBlocks.contains (bb.id) || bb.exprIds.empty())
+					continue;
+				SSAExpression& last = ssaRep->expressions[bb.exprIds.back()];
+				if (last.type == SSAExprType::eCJmp && last.subExpressions.size() == 2 && argumentValue (last.subExpressions[1]).state == SSAConstState::eUnknown) {
+					for (HId outId : bb.outBlocks)
+						markEdge (bb.id, outId);
+					if (bb.fallthroughId)
+						markEdge (bb.id, bb.fallthroughId);
+				}
+			}
+		} while (!blockWorklist.empty());
+		exprBlocks.clear();
+		blockWorklist.clear();
+		exprWorklist.clear();
+	}
+
+	void SSAConstLattice::markEdge (HId fromBlockId, HId toBlockId) {
+		if (!toBlockId || toBlockId >= executableIn.size() || isExecutableEdge (fromBlockId, toBlockId))
+			return;
+		executableIn[toBlockId].push_back (fromBlockId);
+		executableBlocks.insert (toBlockId);
+		//the first visit evaluates the whole block, later ones only the phis for the new edge
+		blockWorklist.push_back (toBlockId);
+	}
+	void SSAConstLattice::visitBlock (HId blockId) {
+		SSABB* bb = ssaRep->bbs.get (blockId);
+		if (!bb)
+			return;
+		bool first = !visitedBlocks.contains (blockId);
+		visitedBlocks.insert (blockId);
+		for (size_t i = 0; i < bb->exprIds.size(); i++) {
+			SSAExpression& expr = ssaRep->expressions[bb->exprIds[i]];
+			if (first || expr.type == SSAExprType::ePhi)
+				visitExpression (expr);
+		}
+		if (!first)
+			return;
+		SSAExpression* last = bb->exprIds.empty() ? nullptr : &ssaRep->expressions[bb->exprIds.back()];
+		if (last && last->type == SSAExprType::eCJmp)//successors are marked by the jump
+			return;
+		for (HId outId : bb->outBlocks)
+			markEdge (blockId, outId);
+		if (bb->fallthroughId)
+			markEdge (blockId, bb->fallthroughId);
+	}
+	void SSAConstLattice::visitExpression (SSAExpression& expr) {
+		SSAConstValue& value = values[expr.id];
+		if (value.state != SSAConstState::eVarying) {
+			SSAConstValue newValue = evaluate (expr);
+			//values only move down the lattice
+			if (value.state == SSAConstState::eConst && !(newValue.state == SSAConstState::eConst && newValue.value == value.value))
+				newValue = newValue.state == SSAConstState::eUnknown ? value : varying();
+			if (newValue.state != value.state || newValue.value != value.value) {
+				value = newValue;
+				for (HId refId : expr.refs)
+					exprWorklist.push_back (refId);
+			}
+		}
+		if (expr.type != SSAExprType::eCJmp)
+			return;
+		HId blockId = exprBlocks[expr.id];
+		SSABB* bb = ssaRep->bbs.get (blockId);
+		if (!bb || bb->exprIds.back() != expr.id)
+			return;
+		SSAArgument* target = expr.subExpressions.size() == 2 ? &expr.subExpressions[0] : nullptr;
+		SSAConstValue condition = target ? argumentValue (expr.subExpressions[1]) : varying();
+		if (condition.state == SSAConstState::eUnknown)
+			return;
+		if (condition.state == SSAConstState::eVarying || target->location != SSALocation::eBlock) {
+			for (HId outId : bb->outBlocks)
+				markEdge (blockId, outId);
+			if (bb->fallthroughId)
+				markEdge (blockId, bb->fallthroughId);
+		} else if (condition.value) {
+			markEdge (blockId, target->locref.refId);
+		} else if (bb->fallthroughId) {
+			markEdge (blockId, bb->fallthroughId);
+		} else {
+			for (HId outId : bb->outBlocks) {
+				if (outId != target->locref.refId)
+					markEdge (blockId, outId);
+			}
+		}
+	}
+
+	SSAConstValue SSAConstLattice::argumentValue (SSAArgument& arg) {
+		SSAConstValue value;
+		switch (arg.type) {
+		case SSAArgType::eUInt:
+			value = constValue (arg.uval);
+			break;
+		case SSAArgType::eSInt:
+			value = constValue (static_cast<uint64_t> (arg.sval));
+			break;
+		case SSAArgType::eId:
+			if (!arg.ssaId || arg.ssaId >= values.size())
+				return varying();
+			value = values[arg.ssaId];
+			break;
+		default:
+			return varying();
+		}
+		if (value.state == SSAConstState::eConst)
+			value.value = maskToSize (arg.offset < 64 ? value.value >> arg.offset : 0, arg.size);
+		return value;
+	}
+
+	SSAConstValue SSAConstLattice::evaluate (SSAExpression& expr) {
+		switch (expr.type) {
+		case SSAExprType::ePhi: {
+			SSAConstValue value;
+			HId blockId = exprBlocks[expr.id];
+			if (rootBlocks.contains (blockId))//also entered from outside of the known edges
+				return varying();
+			for (size_t i = 0; i + 1 < expr.subExpressions.size(); i += 2) {
+				SSAArgument& blockArg = expr.subExpressions[i];
+				SSAArgument& arg = expr.subExpressions[i + 1];
+				if (!isExecutableEdge (blockArg.locref.refId, blockId))
+					continue;
+				if (arg.type == SSAArgType::eId && arg.ssaId == expr.id)
+					continue;
+				value = meet (value, argumentValue (arg));
+			}
+			return value;
+		}
+		case SSAExprType::eAssign:
+			return expr.subExpressions.empty() ? varying() : argumentValue (expr.subExpressions[0]);
+		case SSAExprType::eOp:
+		case SSAExprType::eExtend:
+		case SSAExprType::eAppend:
+		case SSAExprType::eLoadAddr:
+			break;
+		case SSAExprType::eFlag://flags are specific to the operation they are calculated from
+		default:
+			return varying();
+		}
+		if (expr.exprtype == SSAType::eFloat || expr.subExpressions.empty())
+			return varying();
+		HList<uint64_t> args;
+		args.reserve (expr.subExpressions.size());
+		bool unknown = false;
+		for (SSAArgument& arg : expr.subExpressions) {
+			SSAConstValue value = argumentValue (arg);
+			if (value.state == SSAConstState::eVarying)
+				return varying();
+			unknown |= value.state == SSAConstState::eUnknown;
+			args.push_back (value.value);
+		}
+		if (unknown)
+			return SSAConstValue();
+
+		HList<SSAArgument>& subExprs = expr.subExpressions;
+		bool isSigned = expr.exprtype == SSAType::eInt;
+		uint64_t result = args[0];
+		switch (expr.type) {
+		case SSAExprType::eExtend:
+			if (isSigned)
+				result = static_cast<uint64_t> (signExtend (args[0], subExprs[0].size));
+			break;
+		case SSAExprType::eAppend: {
+			uint32_t shift = 0;
+			result = 0;
+			for (size_t i = 0; i < args.size(); i++) {
+				uint32_t size = subExprs[i].size;
+				if (!size || shift + size > 64)
+					return varying();
+				result |= maskToSize (args[i], size) << shift;
+				shift += size;
+			}
+		}
+		break;
+		case SSAExprType::eLoadAddr:
+			if (args.size() != 5)
+				return varying();
+			result = args[1] + (args[2] * args[3]) + args[4];
+			break;
+		case SSAExprType::eOp:
+			switch (expr.opType) {
+			case SSAOpType::eAdd:
+				for (size_t i = 1; i < args.size(); i++)
+					result += args[i];
+				break;
+			case SSAOpType::eSub:
+				for (size_t i = 1; i < args.size(); i++)
+					result -= args[i];
+				break;
+			case SSAOpType::eMul:
+				for (size_t i = 1; i < args.size(); i++)
+					result *= args[i];
+				break;
+			case SSAOpType::eBAnd:
+				for (size_t i = 1; i < args.size(); i++)
+					result &= args[i];
+				break;
+			case SSAOpType::eBOr:
+				for (size_t i = 1; i < args.size(); i++)
+					result |= args[i];
+				break;
+			case SSAOpType::eBXor:
+				for (size_t i = 1; i < args.size(); i++)
+					result ^= args[i];
+				break;
+			case SSAOpType::eAnd:
+				for (size_t i = 1; i < args.size(); i++)
+					result = result && args[i];
+				result = result != 0;
+				break;
+			case SSAOpType::eOr:
+				for (size_t i = 1; i < args.size(); i++)
+					result = result || args[i];
+				result = result != 0;
+				break;
+			case SSAOpType::eBNot:
+				result = ~args[0];
+				break;
+			case SSAOpType::eNot:
+				result = !args[0];
+				break;
+			default: {
+				//the remaining operations are binary and may depend on the sign
+				if (args.size() != 2)
+					return varying();
+				uint64_t lhs = args[0], rhs = args[1];
+				int64_t slhs = signExtend (lhs, subExprs[0].size), srhs = signExtend (rhs, subExprs[1].size);
+				switch (expr.opType) {
+				case SSAOpType::eDiv:
+				case SSAOpType::eMod:
+					if (!rhs || isSigned)
+						return varying();
+					result = expr.opType == SSAOpType::eDiv ? lhs / rhs : lhs % rhs;
+					break;
+				case SSAOpType::eEq:
+					result = lhs == rhs;
+					break;
+				case SSAOpType::eNe:
+					result = lhs != rhs;
+					break;
+				case SSAOpType::eLower:
+					result = isSigned ? slhs < srhs : lhs < rhs;
+					break;
+				case SSAOpType::eLe:
+					result = isSigned ? slhs <= srhs : lhs <= rhs;
+					break;
+				case SSAOpType::eGreater:
+					result = isSigned ? slhs > srhs : lhs > rhs;
+					break;
+				case SSAOpType::eGe:
+					result = isSigned ? slhs >= srhs : lhs >= rhs;
+					break;
+				case SSAOpType::eShl:
+				case SSAOpType::eSal:
+					result = rhs < 64 ? lhs << rhs : 0;
+					break;
+				case SSAOpType::eShr:
+					result = rhs < 64 ? lhs >> rhs : 0;
+					break;
+				case SSAOpType::eSar:
+					result = static_cast<uint64_t> (slhs >> (rhs < 64 ? rhs : 63));
+					break;
+				default:
+					return varying();
+				}
+			}
+			break;
+			}
+			break;
+		default:
+			return varying();
+		}
+		return constValue (maskToSize (result, expr.size));
+	}
+
+	void SSAConstLattice::clear() {
+		version = 0;
+		values.clear();
+		executableBlocks.clear();
+		executableIn.clear();
+	}
+
+	void SSAConstLattice::print (int indent) {
+		printIndent (indent);
+		printf ("Constants\n");
+		for (HId id = 0; id < values.size(); id++) {
+			if (values[id].state != SSAConstState::eConst)
+				continue;
+			printIndent (indent + 1);
+			printf ("%d = 0x%" PRIx64 "\n", id, values[id].value);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef SSACONSTLATTICE_H
+#define SSACONSTLATTICE_H
+
+#include "General.h"
+#include "HIdList.h"
+
+#include <algorithm>
+
+namespace holodec {
+
+	struct SSARepresentation;
+	struct SSAExpression;
+	struct SSAArgument;
+
+	enum class SSAConstState {
+		eUnknown = 0,//not evaluated yet or only reachable through edges that are never taken
+		eConst,
+		eVarying,
+	};
+	struct SSAConstValue {
+		SSAConstState state = SSAConstState::eUnknown;
+		uint64_t value = 0;
+	};
+
+	//sparse conditional constant propagation over the expressions of a function
+	//the entry block and blocks without predecessors are executable, other blocks only through an executable edge
+	//so a conditional jump with a constant condition keeps the not taken successor out of the evaluation
+	struct SSAConstLattice {
+		uint64_t version = 0;//version of the SSARepresentation the values were calculated for, 0 if never calculated
+		HList<SSAConstValue> values;//indexed by the expression id
+		HIdBitSet executableBlocks;
+		HList<HList<HId>> executableIn;//indexed by the block id, the predecessors with an executable edge to the block
+
+		void analyze (SSARepresentation* ssaRep);
+
+		bool getConst (HId id, uint64_t* result) {
+			if (id < values.size() && values[id].state == SSAConstState::eConst) {
+				*result = values[id].value;
+				return true;
+			}
+			return false;
+		}
+		bool isExecutable (HId blockId) {
+			return executableBlocks.contains (blockId);
+		}
+		bool isExecutableEdge (HId fromBlockId, HId toBlockId) {
+			if (toBlockId >= executableIn.size())
+				return false;
+			HList<HId>& preds = executableIn[toBlockId];
+			return std::find (preds.begin(), preds.end(), fromBlockId) != preds.end();
+		}
+		void clear();
+
+		void print (int indent = 0);
+
+	private:
+		SSARepresentation* ssaRep = nullptr;
+		HList<HId> exprBlocks;//block of every expression
+		HList<HId> blockWorklist;
+		HList<HId> exprWorklist;
+		HIdBitSet visitedBlocks;
+		HIdBitSet rootBlocks;
+
+		void markEdge (HId fromBlockId, HId toBlockId);
+		void visitBlock (HId blockId);
+		void visitExpression (SSAExpression& expr);
+		SSAConstValue evaluate (SSAExpression& expr);
+		SSAConstValue argumentValue (SSAArgument& arg);
+	};
+
+}
+
+#endif // SSACONSTLATTICE_H
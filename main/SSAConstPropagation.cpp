@@ -0,0 +1,115 @@
+#include "SSAConstPropagation.h"
+#include "HoloIO.h"
+
+#include "SSA.h"
+#include "Function.h"
+
+#include <algorithm>
+
+namespace holodec {
+
+	void SSAConstPropagation::removeEdge (HId fromBlockId, HId toBlockId) {
+		SSABB* from = ssaRep->bbs.get (fromBlockId);
+		SSABB* to = ssaRep->bbs.get (toBlockId);
+		if (from) {
+			auto it = std::find (from->outBlocks.begin(), from->outBlocks.end(), toBlockId);
+			if (it != from->outBlocks.end())
+				from->outBlocks.erase (it);
+			if (from->fallthroughId == toBlockId)
+				from->fallthroughId = 0;
+		}
+		if (!to)
+			return;
+		auto it = std::find (to->inBlocks.begin(), to->inBlocks.end(), fromBlockId);
+		if (it != to->inBlocks.end())
+			to->inBlocks.erase (it);
+		//the phis lose the value of the edge
+		for (HId id : to->exprIds) {
+			SSAExpression& expr = ssaRep->expressions[id];
+			if (expr.type != SSAExprType::ePhi)
+				continue;
+			for (auto argIt = expr.subExpressions.begin(); argIt != expr.subExpressions.end() && argIt + 1 != expr.subExpressions.end();) {
+				if (argIt->location == SSALocation::eBlock && argIt->locref.refId == fromBlockId)
+					argIt = expr.removeArguments (ssaRep, argIt, argIt + 2);
+				else
+					argIt += 2;
+			}
+		}
+	}
+
+	bool SSAConstPropagation::doTransformation (Binary* binary, Function* function) {
+
+		HLOG_DEBUG (g_pass_logger, "Constant Propagation for Function at Address 0x%" PRIx64, function->baseaddr);
+		ssaRep = &function->ssaRep;
+		foldedCount = 0;
+		foldedJumpCount = 0;
+		prunedBlockCount = 0;
+
+		//the lattice stays valid for the executable blocks while the others are removed
+		SSAConstLattice& lattice = *ssaRep->getConstLattice();
+		HIdBitSet dead (ssaRep->expressions.size());
+		HList<std::pair<HId, HId>> removedEdges;
+
+		for (SSABB& bb : ssaRep->bbs) {
+			if (!lattice.isExecutable (bb.id)) {
+				//the values of the block are never used by executable blocks except in phis of removed edges
+				for (HId id : bb.exprIds)
+					dead.insert (id);
+				for (HId outId : bb.outBlocks)
+					removedEdges.push_back (std::make_pair (bb.id, outId));
+				if (bb.fallthroughId)
+					removedEdges.push_back (std::make_pair (bb.id, bb.fallthroughId));
+				prunedBlockCount += !bb.exprIds.empty() || !bb.outBlocks.empty();
+				continue;
+			}
+			if (bb.exprIds.empty())
+				continue;
+			SSAExpression& expr = ssaRep->expressions[bb.exprIds.back()];
+			if (expr.type != SSAExprType::eCJmp || expr.subExpressions.size() != 2 || expr.subExpressions[0].location != SSALocation::eBlock)
+				continue;
+			HId targetId = expr.subExpressions[0].locref.refId;
+			bool toTarget = lattice.isExecutableEdge (bb.id, targetId);
+			bool toFallthrough = bb.fallthroughId && lattice.isExecutableEdge (bb.id, bb.fallthroughId);
+			if (toTarget == toFallthrough || targetId == bb.fallthroughId)
+				continue;
+			if (toTarget) {//always taken
+				expr.type = SSAExprType::eJmp;
+				ssaRep->markChanged (expr.id);
+				expr.removeArgument (ssaRep, expr.subExpressions.begin() + 1);
+				removedEdges.push_back (std::make_pair (bb.id, bb.fallthroughId));
+			} else {//never taken
+				dead.insert (expr.id);
+				removedEdges.push_back (std::make_pair (bb.id, targetId));
+			}
+			foldedJumpCount++;
+		}
+		for (std::pair<HId, HId>& edge : removedEdges)
+			removeEdge (edge.first, edge.second);
+		if (!removedEdges.empty())
+			ssaRep->invalidateCFG();
+		if (!dead.empty()) {
+			for (SSABB& bb : ssaRep->bbs) {
+				for (HId id : bb.exprIds) {
+					SSAExpression& expr = ssaRep->expressions[id];
+					if (dead.contains (id) && !expr.refs.empty())
+						ssaRep->replaceAllArgs (expr, SSAArgument::createUndef (expr.location, expr.locref, expr.size));
+				}
+			}
+			ssaRep->removeNodes (&dead);
+		}
+
+		for (SSABB& bb : ssaRep->bbs) {
+			if (!lattice.isExecutable (bb.id))
+				continue;
+			for (HId id : bb.exprIds) {
+				uint64_t value;
+				SSAExpression& expr = ssaRep->expressions[id];
+				if (EXPR_HAS_SIDEEFFECT (expr.type) || expr.refs.empty() || !lattice.getConst (id, &value))
+					continue;
+				foldedCount += ssaRep->replaceArg (expr, SSAArgument::createUVal (value, expr.size));
+			}
+		}
+		HLOG_DEBUG (g_pass_logger, "Folded %" PRIu64 " uses, %" PRIu64 " jumps and pruned %" PRIu64 " blocks", foldedCount, foldedJumpCount, prunedBlockCount);
+		return foldedCount || foldedJumpCount || prunedBlockCount || !dead.empty();
+	}
+}
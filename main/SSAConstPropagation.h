@@ -0,0 +1,27 @@
+#ifndef SSACONSTPROPAGATION_H
+#define SSACONSTPROPAGATION_H
+
+#include "SSATransformer.h"
+
+namespace holodec {
+
+	//replaces the uses of expressions with their constant value from the SSAConstLattice
+	//folds conditional jumps with a constant condition and empties the blocks that are not executable
+	class SSAConstPropagation : public SSATransformer {
+
+		SSARepresentation* ssaRep;
+
+		virtual bool doTransformation (Binary* binary, Function* function);
+
+		void removeEdge (HId fromBlockId, HId toBlockId);
+
+	public:
+		//counts of the last run
+		uint64_t foldedCount = 0;//uses replaced by a constant
+		uint64_t foldedJumpCount = 0;
+		uint64_t prunedBlockCount = 0;
+	};
+
+}
+
+#endif // SSACONSTPROPAGATION_H
@@ -1,4 +1,5 @@
 #include "SSADCETransformer.h"
+#include "HoloIO.h"
 #include <set>
 
 #include "SSA.h"
@@ -10,24 +11,65 @@ namespace holodec {
 
 	bool SSADCETransformer::doTransformation (Binary* binary, Function* function) {
 
-		printf ("DCE for Function at Address 0x%llx\n", function->baseaddr);
-		function->ssaRep.recalcRefCounts();
-		bool removed = false;
+		HLOG_DEBUG (g_pass_logger, "DCE for Function at Address 0x%" PRIx64, function->baseaddr);
 		ssaRep = &function->ssaRep;
-		do {
-			HSet<HId> toRemove;
-			for (auto it = function->ssaRep.expressions.begin(); it != function->ssaRep.expressions.end();++it){
-				if(!it->id || EXPR_HAS_SIDEEFFECT(it->type) || !it->refs.empty())
+		size_t maxId = ssaRep->expressions.size();
+
+		usecount.assign (maxId + 1, 0);
+		worklist.clear();
+		HIdBitSet dead (maxId);
+		//seed with the expressions that are not used
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds) {
+				SSAExpression& expr = ssaRep->expressions[id];
+				usecount[id] = expr.refs.size();
+				if (!EXPR_HAS_SIDEEFFECT (expr.type) && expr.refs.empty())
+					worklist.push_back (id);
+			}
+		}
+		//sweep chains of dead expressions
+		while (!worklist.empty()) {
+			HId id = worklist.back();
+			worklist.pop_back();
+			dead.insert (id);
+			for (SSAArgument& arg : ssaRep->expressions[id].subExpressions) {
+				if (arg.type != SSAArgType::eId || !arg.ssaId || dead.contains (arg.ssaId))
+					continue;
+				if (--usecount[arg.ssaId] == 0 && !EXPR_HAS_SIDEEFFECT (ssaRep->expressions[arg.ssaId].type))
+					worklist.push_back (arg.ssaId);
+			}
+		}
+		//the rest is only dead if it is not reachable from an expression with sideeffects
+		HIdBitSet live (maxId);
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds) {
+				if (!dead.contains (id) && EXPR_HAS_SIDEEFFECT (ssaRep->expressions[id].type)) {
+					live.insert (id);
+					worklist.push_back (id);
+				}
+			}
+		}
+		while (!worklist.empty()) {
+			HId id = worklist.back();
+			worklist.pop_back();
+			for (SSAArgument& arg : ssaRep->expressions[id].subExpressions) {
+				if (arg.type != SSAArgType::eId || !arg.ssaId || live.contains (arg.ssaId))
 					continue;
-				toRemove.insert(it->id);
+				live.insert (arg.ssaId);
+				worklist.push_back (arg.ssaId);
+			}
+		}
+		removedCycleCount = 0;
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds) {
+				if (!dead.contains (id) && !live.contains (id)) {
+					dead.insert (id);
+					removedCycleCount++;
+				}
 			}
-			if(toRemove.empty())
-				break;
-			removed |= !toRemove.empty();
-			function->ssaRep.removeNodes(&toRemove);
-			printf("Removed %d\n", toRemove.size());
-		}while(true);
-		function->ssaRep.compress();
-		return removed;
+		}
+		removedCount = ssaRep->removeNodes (&dead);
+		HLOG_DEBUG (g_pass_logger, "Removed %" PRIu64 " of which %" PRIu64 " in cycles", removedCount, removedCycleCount);
+		return removedCount != 0;
 	}
 }
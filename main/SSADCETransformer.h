@@ -9,9 +9,15 @@ namespace holodec {
 
 		SSARepresentation* ssaRep;
 		HList<HId> usecount;
+		HList<HId> worklist;
 		
 		virtual bool doTransformation (Binary* binary, Function* function);
 		
+	public:
+		//counts of the last run
+		uint64_t removedCount = 0;
+		uint64_t removedCycleCount = 0;//expressions that were only used by other dead expressions in a cycle
+		
 	};
 
 }
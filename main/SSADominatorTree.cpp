@@ -0,0 +1,174 @@
+#include "SSADominatorTree.h"
+#include "SSA.h"
+
+namespace holodec {
+
+	void SSADominatorTree::build (SSARepresentation* ssaRep, bool post) {
+		this->post = post;
+		cfgVersion = ssaRep->cfgVersion;
+
+		size_t n = ssaRep->bbs.list.empty() ? 1 : ssaRep->bbs.list.back().id + 1;
+		HList<HList<HId>> succs (n);
+		HList<HList<HId>> preds (n);
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId outId : bb.outBlocks) {
+				if (outId >= n)
+					continue;
+				succs[bb.id].push_back (outId);
+				preds[outId].push_back (bb.id);
+			}
+		}
+		HId root;
+		if (post) {
+			//edges are reversed and all blocks without successors are connected to the virtual exit node 0
+			std::swap (succs, preds);
+			for (SSABB& bb : ssaRep->bbs) {
+				if (bb.outBlocks.empty()) {
+					succs[0].push_back (bb.id);
+					preds[bb.id].push_back (0);
+				}
+			}
+			root = 0;
+		} else {
+			root = ssaRep->bbs.list.empty() ? 0 : ssaRep->bbs.list[0].id;
+		}
+
+		//postorder of the cfg
+		HList<uint32_t> poNumber (n, 0);//0 for unreachable blocks
+		HList<HId> po;
+		HList<std::pair<HId, size_t>> stack;
+		HIdBitSet visited (n);
+		visited.insert (root);
+		stack.push_back (std::make_pair (root, 0));
+		while (!stack.empty()) {
+			HId blockId = stack.back().first;
+			size_t index = stack.back().second;
+			if (index < succs[blockId].size()) {
+				stack.back().second++;
+				HId succId = succs[blockId][index];
+				if (!visited.contains (succId)) {
+					visited.insert (succId);
+					stack.push_back (std::make_pair (succId, 0));
+				}
+			} else {
+				po.push_back (blockId);
+				poNumber[blockId] = po.size();
+				stack.pop_back();
+			}
+		}
+		rpo.assign (po.rbegin(), po.rend());
+
+		const HId undef = (HId) - 1;
+		HList<HId> doms (n, undef);
+		doms[root] = root;
+		auto intersect = [&doms, &poNumber] (HId lhs, HId rhs) {
+			while (lhs != rhs) {
+				while (poNumber[lhs] < poNumber[rhs])
+					lhs = doms[lhs];
+				while (poNumber[rhs] < poNumber[lhs])
+					rhs = doms[rhs];
+			}
+			return lhs;
+		};
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (HId blockId : rpo) {
+				if (blockId == root)
+					continue;
+				HId newIdom = undef;
+				for (HId predId : preds[blockId]) {
+					if (doms[predId] == undef)
+						continue;
+					newIdom = newIdom == undef ? predId : intersect (predId, newIdom);
+				}
+				if (doms[blockId] != newIdom) {
+					doms[blockId] = newIdom;
+					changed = true;
+				}
+			}
+		}
+
+		idoms.assign (n, 0);
+		children.assign (n, HList<HId>());
+		frontiers.assign (n, HList<HId>());
+		for (HId blockId : rpo) {
+			if (blockId == root)
+				continue;
+			idoms[blockId] = doms[blockId];
+			children[doms[blockId]].push_back (blockId);
+		}
+		for (HId blockId : rpo) {
+			if (preds[blockId].size() < 2)
+				continue;
+			for (HId predId : preds[blockId]) {
+				if (doms[predId] == undef)
+					continue;
+				for (HId runner = predId; runner != doms[blockId]; runner = doms[runner]) {
+					if (frontiers[runner].empty() || frontiers[runner].back() != blockId)
+						frontiers[runner].push_back (blockId);
+					if (runner == root)
+						break;
+				}
+			}
+		}
+
+		//number the dominator tree so that dominance is an interval check
+		preorder.assign (n, 0);
+		postorder.assign (n, 0);
+		uint32_t preCounter = 0, postCounter = 0;
+		stack.clear();
+		stack.push_back (std::make_pair (root, 0));
+		preorder[root] = ++preCounter;
+		while (!stack.empty()) {
+			HId blockId = stack.back().first;
+			size_t index = stack.back().second;
+			if (index < children[blockId].size()) {
+				stack.back().second++;
+				HId childId = children[blockId][index];
+				preorder[childId] = ++preCounter;
+				stack.push_back (std::make_pair (childId, 0));
+			} else {
+				postorder[blockId] = ++postCounter;
+				stack.pop_back();
+			}
+		}
+	}
+
+	void SSADominatorTree::iteratedFrontier (HIdBitSet* defBlocks, HIdBitSet* result) {
+		HList<HId> worklist;
+		HIdBitSet queued (frontiers.size());
+		for (HId blockId : rpo) {
+			if (defBlocks->contains (blockId)) {
+				queued.insert (blockId);
+				worklist.push_back (blockId);
+			}
+		}
+		while (!worklist.empty()) {
+			HId blockId = worklist.back();
+			worklist.pop_back();
+			for (HId frontierId : frontiers[blockId]) {
+				if (result->contains (frontierId))
+					continue;
+				result->insert (frontierId);
+				if (!queued.contains (frontierId)) {
+					queued.insert (frontierId);
+					worklist.push_back (frontierId);
+				}
+			}
+		}
+	}
+
+	void SSADominatorTree::print (int indent) {
+		printIndent (indent);
+		printf ("%s\n", post ? "Post-Dominator Tree" : "Dominator Tree");
+		for (HId blockId : rpo) {
+			printIndent (indent + 1);
+			printf ("Block %d IDom %d Frontier ", blockId, idoms[blockId]);
+			for (HId frontierId : frontiers[blockId]) {
+				printf ("%d, ", frontierId);
+			}
+			printf ("\n");
+		}
+	}
+}
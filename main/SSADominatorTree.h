@@ -0,0 +1,49 @@
+#ifndef SSADOMINATORTREE_H
+#define SSADOMINATORTREE_H
+
+#include "General.h"
+#include "HIdList.h"
+
+namespace holodec {
+
+	struct SSARepresentation;
+
+	//dominator or post-dominator tree over the basic blocks of a SSARepresentation
+	//all lists are indexed by the block id, index 0 is the virtual exit node of the post-dominator tree
+	struct SSADominatorTree {
+		bool post = false;
+		uint64_t cfgVersion = 0;//version of the cfg the tree was built for, 0 if never built
+
+		HList<HId> idoms;//immediate dominator, 0 for the root and unreachable blocks
+		HList<HList<HId>> children;
+		HList<HList<HId>> frontiers;
+		HList<HId> rpo;//reachable blocks in reverse postorder of the cfg
+		HList<uint32_t> preorder;//interval of the block in the dominator tree for constant time dominance queries
+		HList<uint32_t> postorder;
+
+		//builds the tree with the algorithm of Cooper, Harvey and Kennedy
+		void build (SSARepresentation* ssaRep, bool post);
+
+		HId idom (HId blockId) {
+			return blockId < idoms.size() ? idoms[blockId] : 0;
+		}
+		bool reachable (HId blockId) {
+			return blockId < preorder.size() && preorder[blockId];
+		}
+		bool dominates (HId blockId, HId dominatedId) {
+			if (!reachable (blockId) || !reachable (dominatedId))
+				return false;
+			return preorder[blockId] <= preorder[dominatedId] && postorder[dominatedId] <= postorder[blockId];
+		}
+		HList<HId>& frontier (HId blockId) {
+			return frontiers[blockId];
+		}
+		//blocks in which a definition in one of the given blocks meets other definitions
+		void iteratedFrontier (HIdBitSet* defBlocks, HIdBitSet* result);
+
+		void print (int indent = 0);
+	};
+
+}
+
+#endif // SSADOMINATORTREE_H
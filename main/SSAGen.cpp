@@ -1,6 +1,9 @@
 #include "SSAGen.h"
+#include "HoloIO.h"
+#include "Profiler.h"
 #include "Architecture.h"
 #include <assert.h>
+#include <tuple>
 
 namespace holodec {
 
@@ -13,6 +16,106 @@ namespace holodec {
 
 	SSAGen::~SSAGen() {}
 
+	bool SSALiftKey::create (Instruction* instr) {
+		if (!instr->instrdef || instr->operands.size() > HINSTRUCTION_MAX_OPERANDS)
+			return false;
+		instrdefId = instr->instrdef->id;
+		opcount = (uint32_t) instr->operands.size();
+		for (uint32_t i = 0; i < opcount; i++) {
+			IRArgument& arg = instr->operands[i];
+			operands[i] = {arg.type, arg.size, arg.offset, 0, 0, 0, 0};
+			switch (arg.type) {
+			case IR_ARGTYPE_MEMOP:
+				operands[i].segment = arg.mem.segment;
+				operands[i].base = arg.mem.base;
+				operands[i].index = arg.mem.index;
+				break;
+			case IR_ARGTYPE_SINT:
+			case IR_ARGTYPE_UINT:
+			case IR_ARGTYPE_FLOAT:
+				operands[i].val = arg.uval;
+				break;
+			default:
+				operands[i].val = arg.ref.refId | ( (uint64_t) arg.ref.index << 32);
+				break;
+			}
+		}
+		return true;
+	}
+	bool operator< (const SSALiftKey& lhs, const SSALiftKey& rhs) {
+		if (lhs.instrdefId != rhs.instrdefId)
+			return lhs.instrdefId < rhs.instrdefId;
+		if (lhs.opcount != rhs.opcount)
+			return lhs.opcount < rhs.opcount;
+		for (uint32_t i = 0; i < lhs.opcount; i++) {
+			auto& lop = lhs.operands[i];
+			auto& rop = rhs.operands[i];
+			auto ltuple = std::tie (lop.type, lop.size, lop.offset, lop.val, lop.segment, lop.base, lop.index);
+			auto rtuple = std::tie (rop.type, rop.size, rop.offset, rop.val, rop.segment, rop.base, rop.index);
+			if (ltuple != rtuple)
+				return ltuple < rtuple;
+		}
+		return false;
+	}
+
+	void SSAGen::recordLiftTemplate (SSALiftTemplate* liftTemplate) {
+		SSABB* bb = getActiveBlock();
+		//all expressions of the instruction need to be appended to the active block in order
+		if (bb->exprIds.size() < liftExprIds.size() || !std::equal (liftExprIds.begin(), liftExprIds.end(), bb->exprIds.end() - liftExprIds.size()))
+			return;
+		//template arguments reference the n-th expression of the instruction starting with 1
+		auto templateIndex = [this] (HId ssaId) -> HId {
+			for (size_t i = 0; i < liftExprIds.size(); i++) {
+				if (liftExprIds[i] == ssaId)
+					return i + 1;
+			}
+			return 0;
+		};
+		HList<SSAExpression> expressions;
+		for (HId id : liftExprIds) {
+			SSAExpression expr = ssaRepresentation->expressions[id];
+			expr.id = 0;
+			expr.uniqueId = 0;
+			expr.refs.clear();
+			for (SSAArgument& arg : expr.subExpressions) {
+				if (arg.type == SSAArgType::eId && arg.ssaId) {
+					arg.ssaId = templateIndex (arg.ssaId);
+					if (!arg.ssaId)//references an expression outside of this instruction
+						return;
+				}
+			}
+			expressions.push_back (expr);
+		}
+		liftTemplate->expressions = expressions;
+		for (std::pair<HId, size_t>& memExpr : liftMemExprs) {
+			liftTemplate->memPatches.push_back (std::make_pair ( (size_t) (templateIndex (memExpr.first) - 1), memExpr.second));
+		}
+		liftTemplate->valid = true;
+	}
+	void SSAGen::instantiateLiftTemplate (SSALiftTemplate* liftTemplate) {
+		for (SSAExpression& templateExpr : liftTemplate->expressions) {
+			SSAExpression expression = templateExpr;
+			for (SSAArgument& arg : expression.subExpressions) {
+				if (arg.type == SSAArgType::eId && arg.ssaId)
+					arg.ssaId = liftExprIds[arg.ssaId - 1];
+			}
+			if (expression.type == SSAExprType::eLabel)
+				expression.subExpressions[0].uval = instruction->addr;
+			addExpression (&expression);
+		}
+		for (std::pair<size_t, size_t>& patch : liftTemplate->memPatches) {
+			SSAExpression& memexpr = ssaRepresentation->expressions[liftExprIds[patch.first]];
+			IRArgument& mem = instruction->operands[patch.second];
+			memexpr.subExpressions[3] = SSAArgument::createUVal (mem.mem.scale, arch->bitbase);
+			memexpr.subExpressions[4] = SSAArgument::createUVal (mem.mem.disp, arch->bitbase);
+		}
+	}
+	void SSAGen::printLiftCacheStats() {
+		uint64_t lookups = liftCacheHits + liftCacheMisses;
+		printf ("Lift-Cache: %zu Shapes, %" PRIu64 " Hits (%" PRIu64 " from Templates), %" PRIu64 " Misses, Hit-Rate %.2f%%\n",
+		        liftCache.size(), liftCacheHits, liftCacheTemplateHits, liftCacheMisses, lookups ? (100.0 * liftCacheHits) / lookups : 0.0);
+	}
+
 	IRRepresentation* SSAGen::matchIr (Instruction* instr) {
 
 		InstrDefinition* instrdef = instr->instrdef;
@@ -25,6 +128,7 @@ namespace holodec {
 						instrdef->irs[i].print(arch);
 						instr->print(arch);
 						printf("\n");*/
+						HPROFILE_COUNT (eIRMatches, 1);
 						return &instrdef->irs[i];
 					}
 					else {
@@ -36,6 +140,7 @@ namespace holodec {
 					}
 				}
 				else {
+					HPROFILE_COUNT (eIRMatches, 1);
 					return &instrdef->irs[i];
 				}
 			}
@@ -46,6 +151,7 @@ namespace holodec {
 		}
 		instr->print (arch);
 		printf ("Found No Match %s\n", instr->instrdef->mnemonics.cstr());
+		HPROFILE_COUNT (eIRMisses, 1);
 		return nullptr;
 	}
 
@@ -76,7 +182,20 @@ namespace holodec {
 		args[4].set(SSAArgument::createUVal (mem.mem.disp, arch->bitbase));
 
 		memexpr.subExpressions.assign (args, args + 5);
-		return IRArgument::createSSAId (addExpression (&memexpr), arch->bitbase);
+		HId ssaId = addExpression (&memexpr);
+		if (liftCacheable) {//remember which operand the displacement comes from
+			size_t i;
+			for (i = 0; i < instruction->operands.size(); i++) {
+				IRArgument& operand = instruction->operands[i];
+				if (operand.type == IR_ARGTYPE_MEMOP && operand.mem == mem.mem)
+					break;
+			}
+			if (i < instruction->operands.size())
+				liftMemExprs.push_back (std::make_pair (ssaId, i));
+			else
+				liftCacheable = false;
+		}
+		return IRArgument::createSSAId (ssaId, arch->bitbase);
 	}
 
 	template<typename ARGLIST>
@@ -233,6 +352,7 @@ namespace holodec {
 		case IR_ARGTYPE_FLOAT:
 			return argExpr;
 		case IR_ARGTYPE_IP:
+			liftCacheable = false;
 			return IRArgument::createUVal(instruction->addr + instruction->size, arch->wordbase * arch->instrptrsize);
 		case IR_ARGTYPE_REG:
 		case IR_ARGTYPE_STACK:
@@ -251,12 +371,7 @@ namespace holodec {
 		addExpression (&expression);
 	}
 	SSABB* SSAGen::getBlock (HId blockId) {
-		for (SSABB& bb : ssaRepresentation->bbs) {
-			if (bb.id == blockId) {
-				return &bb;
-			}
-		}
-		return nullptr;
+		return ssaRepresentation->bbs.get (blockId);
 	}
 	SSABB* SSAGen::getActiveBlock () {
 		if (!activeblock)
@@ -275,6 +390,8 @@ namespace holodec {
 		HId ssaId = ssaRepresentation->addAtEnd (expression, activeblock);
 		if (expression->type == SSAExprType::eOp)
 			lastOp = ssaId;
+		if (instruction)
+			liftExprIds.push_back (ssaId);
 		return ssaId;
 	}
 	void SSAGen::reset() {
@@ -307,6 +424,8 @@ namespace holodec {
 		instruction = nullptr;
 		arguments.clear();
 		tmpdefs.clear();
+		liftMemExprs.clear();
+		liftExprIds.clear();
 	}
 
 	HId SSAGen::splitBasicBlock (uint64_t addr) {
@@ -319,7 +438,7 @@ namespace holodec {
 					SSAExpression* expr = ssaRepresentation->expressions.get (*it);
 					assert (expr);
 					if (expr->type == SSAExprType::eLabel && expr->subExpressions.size() > 0 && expr->subExpressions[0].type == SSAArgType::eUInt && expr->subExpressions[0].uval == addr) {
-						printf ("Split SSA 0x%" PRIx64 "\n", addr);
+						HLOG_TRACE (g_analyzer_logger, "Split SSA 0x%" PRIx64, addr);
 						HId oldId = bb.id;
 						HId newEndAddr = bb.endaddr;
 						bb.endaddr = addr;
@@ -333,6 +452,7 @@ namespace holodec {
 						SSABB* oldbb = ssaRepresentation->bbs.get (oldId);
 						oldbb->fallthroughId = newbb->id;
 						oldbb->outBlocks = {newbb->id};
+						ssaRepresentation->invalidateCFG();
 
 						return newbb->id;
 					}
@@ -342,9 +462,11 @@ namespace holodec {
 		return 0;
 	}
 	HId SSAGen::createNewBlock () {
+		liftCacheable = false;
 		activeblock = nullptr;
 		SSABB block;
 		ssaRepresentation->bbs.push_back (block);
+		ssaRepresentation->invalidateCFG();
 		return ssaRepresentation->bbs.list.back().id;
 	}
 	void SSAGen::activateBlock (HId block) {
@@ -411,16 +533,44 @@ namespace holodec {
 		if (getActiveBlock()->startaddr > instruction->addr)
 			getActiveBlock()->startaddr = instruction->addr;
 
-		IRRepresentation* rep = matchIr (instruction);
+		SSALiftKey key;
+		bool keyed = key.create (instruction);
+		SSALiftTemplate* liftTemplate = nullptr;
+		if (keyed) {
+			auto it = liftCache.find (key);
+			if (it != liftCache.end())
+				liftTemplate = &it->second;
+		}
+		IRRepresentation* rep;
+		if (liftTemplate) {
+			liftCacheHits++;
+			rep = liftTemplate->rep;
+		} else {
+			liftCacheMisses++;
+			liftCacheable = true;
+			rep = matchIr (instruction);
+		}
 
 		if (rep) {
 			setupForInstr();
 			this->instruction = instruction;
-			for (size_t i = 0; i < instruction->operands.size(); i++) {
-				arguments.push_back (instruction->operands[i]);
+			if (liftTemplate && liftTemplate->valid) {
+				liftCacheTemplateHits++;
+				instantiateLiftTemplate (liftTemplate);
+			} else {
+				for (size_t i = 0; i < instruction->operands.size(); i++) {
+					arguments.push_back (instruction->operands[i]);
+				}
+				insertLabel (instruction->addr);
+				parseExpression (rep->rootExpr);
+				if (keyed && !liftTemplate) {
+					SSALiftTemplate& newTemplate = liftCache[key];
+					newTemplate.rep = rep;
+					//instructions that change the control flow or depend on their address are not relocatable
+					if (liftCacheable && !endOfBlock && fallthrough)
+						recordLiftTemplate (&newTemplate);
+				}
 			}
-			insertLabel (instruction->addr);
-			parseExpression (rep->rootExpr);
 		} else {
 			printf ("Could not find IR-Match for Instruction\n");//maybe at some point we will hit this ;)
 			instruction->print (arch);
@@ -455,16 +605,14 @@ namespace holodec {
 		}
 		case IR_ARGTYPE_TMP: {
 			assert (exprId.ref.refId);
-			for (SSATmpDef& def : tmpdefs) {
-				if (def.id == exprId.ref.refId) {
-					return def.arg;
-				}
-			}
+			if (IRArgument* arg = tmpdefs.get (exprId.ref.refId))
+				return *arg;
 			printf ("0x%" PRIx64 "\n", instruction->addr);
 			printf ("%d\n", exprId.ref.refId);
 			assert (false);
 		}
 		case IR_ARGTYPE_IP:
+			liftCacheable = false;
 			return IRArgument::createUVal (instruction->addr + instruction->size, arch->wordbase * arch->instrptrsize);
 		case IR_ARGTYPE_ID: {
 			IRExpression* irExpr = arch->getIrExpr (exprId.ref.refId);
@@ -499,12 +647,7 @@ namespace holodec {
 						addExpression (&expression);
 						break;
 					case IR_ARGTYPE_TMP:
-						for (auto it = tmpdefs.begin(); it != tmpdefs.end(); ++it) {
-							if ( (*it).id == arg.ref.refId) {
-								it = tmpdefs.erase (it);
-								break;
-							}
-						}
+						tmpdefs.erase (arg.ref.refId);
 						continue;
 					default:
 						assert (false);
@@ -546,14 +689,7 @@ namespace holodec {
 					}
 					break;
 					case IR_ARGTYPE_TMP: {
-						IRArgument arg = IRArgument::createSSAId (srcArg.ref.refId, ssaExpr->size);
-						for (SSATmpDef& def : tmpdefs) {
-							if (def.id == dstArg.ref.refId) {
-								def.arg = arg;
-								return IRArgument::create();
-							}
-						}
-						tmpdefs.push_back ({dstArg.ref.refId, arg});
+						tmpdefs.set (dstArg.ref.refId, IRArgument::createSSAId (srcArg.ref.refId, ssaExpr->size));
 						return IRArgument::create();
 					}
 					break;
@@ -572,14 +708,7 @@ namespace holodec {
 				case IR_ARGTYPE_TMP: {
 					expression.exprtype = SSAType::eUInt;
 					expression.subExpressions.push_back (srcSSAArg);
-					IRArgument arg = IRArgument::createSSAId (addExpression (&expression), expression.size);
-					for (SSATmpDef& def : tmpdefs) {
-						if (def.id == dstArg.ref.refId) {
-							def.arg = arg;
-							return IRArgument::create();
-						}
-					}
-					tmpdefs.push_back ({dstArg.ref.refId, arg});
+					tmpdefs.set (dstArg.ref.refId, IRArgument::createSSAId (addExpression (&expression), expression.size));
 					return IRArgument::create();
 				}
 				case IR_ARGTYPE_MEMOP: {
@@ -670,11 +799,13 @@ namespace holodec {
 					activeblock->fallthroughId = endBlockId;
 					activeblock->outBlocks.insert (endBlockId);
 					getBlock (endBlockId)->inBlocks.insert (activeblock->id);
+					ssaRepresentation->invalidateCFG();
 				} else {
 					SSABB* oldBB = getBlock (oldBlock);
 					oldBB->fallthroughId = endBlockId;
 					oldBB->outBlocks.insert (endBlockId);
 					getBlock (endBlockId)->inBlocks.insert (oldBB->id);
+					ssaRepresentation->invalidateCFG();
 				}
 				activateBlock (endBlockId);
 				return IRArgument::create ();
@@ -749,6 +880,7 @@ namespace holodec {
 				SSAExpression expression;
 				expression.type = SSAExprType::eCall;
 				expression.exprtype = irExpr->exprtype;
+				liftCacheable = false;
 				assert (subexpressioncount == 1);
 				expression.subExpressions.push_back (parseIRArg2SSAArg (parseExpression (irExpr->subExpressions[0])));
 
@@ -1027,7 +1159,7 @@ namespace holodec {
 				for (size_t i = 0; i < subexpressioncount; i++) {
 					args.push_back (parseExpression (irExpr->subExpressions[i]));
 				}
-				HList<SSATmpDef> cachedTemps = this->tmpdefs;
+				SSATmpDefs cachedTemps = this->tmpdefs;
 				HList<IRArgument> cachedArgs = this->arguments;
 
 				tmpdefs.clear();
@@ -1056,15 +1188,7 @@ namespace holodec {
 				for (size_t i = 0; i < subexpressioncount; i++) {
 					IRArgument& arg = irExpr->subExpressions[i];
 					if (arguments[i].type == IRArgTypes::IR_ARGTYPE_SSAID && arg.type == IRArgTypes::IR_ARGTYPE_TMP) {
-						bool found = false;
-						for (SSATmpDef& tmpDef : cachedTemps) {
-							if (tmpDef.id == arg.ref.refId) {
-								tmpDef.arg = arguments[i];
-								found = true;
-							}
-						}
-						if (!found)
-							cachedTemps.push_back({arg.ref.refId, arguments[i]});
+						cachedTemps.set (arg.ref.refId, arguments[i]);
 					}
 				}
 				this->tmpdefs = cachedTemps;
@@ -1120,6 +1244,7 @@ namespace holodec {
 				endBodyBB->fallthroughId = startCondId;
 				endBodyBB->outBlocks.insert (startCondId);
 				startCondBB->inBlocks.insert (endBodyId);
+				ssaRepresentation->invalidateCFG();
 
 				activateBlock (endId);
 				return IRArgument::create ();
@@ -7,9 +7,62 @@ namespace holodec {
 
 	struct Architecture;
 
-	struct SSATmpDef {
-		HId id;
-		IRArgument arg;
+	//the temporaries of one instruction indexed by their id
+	//a slot is only valid if it was written in the current generation, so clearing is O(1)
+	struct SSATmpDefs {
+		HList<IRArgument> args;
+		HList<uint32_t> generations;
+		uint32_t generation = 1;
+
+		IRArgument* get (HId id) {
+			if (id < args.size() && generations[id] == generation)
+				return &args[id];
+			return nullptr;
+		}
+		void set (HId id, IRArgument arg) {
+			if (id >= args.size()) {
+				args.resize (id + 1);
+				generations.resize (id + 1, 0);
+			}
+			args[id] = arg;
+			generations[id] = generation;
+		}
+		void erase (HId id) {
+			if (id < generations.size())
+				generations[id] = 0;
+		}
+		void clear() {
+			if (!++generation) {
+				for (uint32_t& gen : generations)
+					gen = 0;
+				generation = 1;
+			}
+		}
+	};
+
+	//the shape of an instruction: the definition and the kind/size/register signature of every operand
+	//mem-operands are keyed without scale and displacement, which are patched on instantiation
+	struct SSALiftKey {
+		HId instrdefId = 0;
+		uint32_t opcount = 0;
+		struct {
+			IRArgTypes type;
+			uint32_t size, offset;
+			uint64_t val;
+			HId segment, base, index;
+		} operands[HINSTRUCTION_MAX_OPERANDS];
+
+		bool create (Instruction* instr);
+	};
+	bool operator< (const SSALiftKey& lhs, const SSALiftKey& rhs);
+
+	struct SSALiftTemplate {
+		IRRepresentation* rep = nullptr;
+		bool valid = false;
+		//expressions of one lifted instance, ssaIds of arguments are relative to the first expression
+		HList<SSAExpression> expressions;
+		//pairs of expression index and operand index for LoadAddr expressions created from mem-operands
+		HList<std::pair<size_t, size_t>> memPatches;
 	};
 	
 	
@@ -29,7 +82,13 @@ namespace holodec {
 		Function* function = nullptr;
 		SSARepresentation* ssaRepresentation = nullptr;
 
-		HList<SSATmpDef> tmpdefs;
+		SSATmpDefs tmpdefs;
+
+		HMap<SSALiftKey, SSALiftTemplate> liftCache;
+		bool liftCacheable = false;
+		HList<std::pair<HId, size_t>> liftMemExprs;
+		HList<HId> liftExprIds;//expressions created for the current instruction
+		uint64_t liftCacheHits = 0, liftCacheMisses = 0, liftCacheTemplateHits = 0;
 
 		SSAGen (Architecture* arch);
 		~SSAGen();
@@ -55,6 +114,10 @@ namespace holodec {
 
 		IRRepresentation* matchIr (Instruction* instr);
 
+		void recordLiftTemplate (SSALiftTemplate* liftTemplate);
+		void instantiateLiftTemplate (SSALiftTemplate* liftTemplate);
+		void printLiftCacheStats();
+
 		template<typename ARGLIST>
 		IRArgument parseConstExpression (IRArgument argExpr, ARGLIST* arglist);
 		
@@ -0,0 +1,152 @@
+#include "SSAGlobalValueNumbering.h"
+#include "HoloIO.h"
+
+#include "SSA.h"
+#include "Function.h"
+
+namespace holodec {
+
+	static bool isNumberable (SSAExpression& expr) {
+		switch (expr.type) {
+		case SSAExprType::eOp:
+		case SSAExprType::eLoadAddr:
+		case SSAExprType::eFlag:
+		case SSAExprType::eExtend:
+		case SSAExprType::eAppend:
+		case SSAExprType::eCast:
+		case SSAExprType::eUpdatePart:
+			return !EXPR_HAS_SIDEEFFECT (expr.type);
+		default:
+			return false;
+		}
+	}
+	static uint64_t hashCombine (uint64_t hash, uint64_t value) {
+		return (hash ^ value) * 0x100000001b3ULL;
+	}
+	//hashes the fields compared by operator== and the offsets of the arguments
+	static uint64_t hashExpression (SSAExpression& expr) {
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		hash = hashCombine (hash, static_cast<uint64_t> (expr.type));
+		hash = hashCombine (hash, expr.size);
+		hash = hashCombine (hash, static_cast<uint64_t> (expr.exprtype));
+		hash = hashCombine (hash, static_cast<uint64_t> (expr.location));
+		hash = hashCombine (hash, (static_cast<uint64_t> (expr.locref.refId) << 32) | expr.locref.index);
+		if (expr.type == SSAExprType::eOp)
+			hash = hashCombine (hash, static_cast<uint64_t> (expr.opType));
+		else if (expr.type == SSAExprType::eFlag)
+			hash = hashCombine (hash, static_cast<uint64_t> (expr.flagType));
+		for (SSAArgument& arg : expr.subExpressions) {
+			hash = hashCombine (hash, static_cast<uint64_t> (arg.type));
+			hash = hashCombine (hash, (static_cast<uint64_t> (arg.size) << 32) | arg.offset);
+			hash = hashCombine (hash, static_cast<uint64_t> (arg.location));
+			hash = hashCombine (hash, (static_cast<uint64_t> (arg.locref.refId) << 32) | arg.locref.index);
+			switch (arg.type) {
+			case SSAArgType::eId:
+				hash = hashCombine (hash, arg.ssaId);
+				break;
+			case SSAArgType::eSInt:
+			case SSAArgType::eUInt:
+			case SSAArgType::eFloat:
+				hash = hashCombine (hash, arg.uval);
+				break;
+			default:
+				break;
+			}
+		}
+		return hash;
+	}
+	//operator== does not compare the offsets of the arguments
+	static bool isCongruent (SSAExpression& lhs, SSAExpression& rhs) {
+		if (!(lhs == rhs))
+			return false;
+		for (size_t i = 0; i < lhs.subExpressions.size(); i++) {
+			if (lhs.subExpressions[i].offset != rhs.subExpressions[i].offset)
+				return false;
+		}
+		return true;
+	}
+
+	bool SSAGlobalValueNumbering::visitBlock (SSABB* bb) {
+		bool applied = false;
+		for (HId id : bb->exprIds) {
+			SSAExpression& expr = ssaRep->expressions[id];
+			if (!isNumberable (expr) || expr.refs.empty())
+				continue;
+			uint64_t hash = hashExpression (expr);
+			HList<HId>& candidates = table[hash];
+			HId leaderId = 0;
+			for (HId candidateId : candidates) {
+				if (isCongruent (ssaRep->expressions[candidateId], expr)) {
+					leaderId = candidateId;
+					break;
+				}
+			}
+			if (!leaderId) {
+				candidates.push_back (id);
+				scopeHashes.push_back (hash);
+				continue;
+			}
+			mergedCount++;
+			mergedBytes += sizeof (SSAExpression) + expr.subExpressions.capacity() * sizeof (SSAArgument) + expr.refs.capacity() * sizeof (HId);
+			ssaRep->replaceAllArgs (expr, SSAArgument::createId (leaderId, expr.size));
+			applied = true;
+		}
+		return applied;
+	}
+
+	bool SSAGlobalValueNumbering::doTransformation (Binary* binary, Function* function) {
+
+		HLOG_DEBUG (g_pass_logger, "Global Value Numbering for Function at Address 0x%" PRIx64, function->baseaddr);
+		ssaRep = &function->ssaRep;
+		mergedCount = 0;
+		mergedBytes = 0;
+		if (ssaRep->bbs.list.empty())
+			return false;
+
+		SSADominatorTree* domTree = ssaRep->getDominatorTree();
+		table.clear();
+		scopeHashes.clear();
+		bool applied = false;
+		//depth first over the dominator tree, the table holds the expressions of the blocks on the path from the root
+		struct Scope {
+			HId blockId;
+			size_t childIndex;
+			size_t hashCount;
+		};
+		HList<Scope> stack;
+		HId rootId = domTree->rpo.empty() ? 0 : domTree->rpo[0];
+		if (rootId) {
+			stack.push_back ({rootId, 0, scopeHashes.size()});
+			applied |= visitBlock (ssaRep->bbs.get (rootId));
+		}
+		while (!stack.empty()) {
+			Scope& scope = stack.back();
+			HList<HId>& children = domTree->children[scope.blockId];
+			if (scope.childIndex < children.size()) {
+				HId childId = children[scope.childIndex++];
+				stack.push_back ({childId, 0, scopeHashes.size()});
+				applied |= visitBlock (ssaRep->bbs.get (childId));
+				continue;
+			}
+			while (scopeHashes.size() > scope.hashCount) {
+				table[scopeHashes.back()].pop_back();
+				scopeHashes.pop_back();
+			}
+			stack.pop_back();
+		}
+		totalMergedCount += mergedCount;
+		totalMergedBytes += mergedBytes;
+		HLOG_DEBUG (g_pass_logger, "Merged %" PRIu64 " expressions with %" PRIu64 " bytes", mergedCount, mergedBytes);
+		return applied;
+	}
+
+	void SSAGlobalValueNumbering::mergeStats (SSAGlobalValueNumbering* other) {
+		totalMergedCount += other->totalMergedCount;
+		totalMergedBytes += other->totalMergedBytes;
+	}
+	void SSAGlobalValueNumbering::printStats() {
+		printf ("Global Value Numbering\n");
+		printIndent (1);
+		printf ("Merged Expressions: %" PRIu64 " Bytes: %" PRIu64 "\n", totalMergedCount, totalMergedBytes);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef SSAGLOBALVALUENUMBERING_H
+#define SSAGLOBALVALUENUMBERING_H
+
+#include "SSATransformer.h"
+
+#include <unordered_map>
+
+namespace holodec {
+
+	//merges expressions without sideeffects that compute the same value from the same arguments
+	//the blocks are visited in dominator tree order so the expression that is kept dominates the merged ones
+	class SSAGlobalValueNumbering : public SSATransformer {
+
+		SSARepresentation* ssaRep;
+		std::unordered_map<uint64_t, HList<HId>> table;//hash to the expressions of the dominating blocks
+		HList<uint64_t> scopeHashes;//hashes in the order they were added to the table
+
+		virtual bool doTransformation (Binary* binary, Function* function);
+
+		bool visitBlock (SSABB* bb);
+
+	public:
+		//counts of the last run
+		uint64_t mergedCount = 0;
+		uint64_t mergedBytes = 0;//memory of the merged expressions
+		//counts of all runs
+		uint64_t totalMergedCount = 0;
+		uint64_t totalMergedBytes = 0;
+
+		void mergeStats (SSAGlobalValueNumbering* other);
+		void printStats();
+	};
+
+}
+
+#endif // SSAGLOBALVALUENUMBERING_H
@@ -0,0 +1,101 @@
+#include "SSALiveness.h"
+#include "SSA.h"
+#include "Architecture.h"
+
+namespace holodec {
+
+	void SSALiveness::analyze (Architecture* arch, SSARepresentation* ssaRep) {
+		version = ssaRep->version;
+		size_t n = ssaRep->bbs.list.empty() ? 1 : ssaRep->bbs.list.back().id + 1;
+		size_t regCount = arch->parentRegs.size();
+
+		liveIn.assign (n, HIdBitSet (regCount));
+		liveOut.assign (n, HIdBitSet (regCount));
+		HList<HIdBitSet> defs (n, HIdBitSet (regCount));
+		HList<HList<HId>> preds (n);
+
+		//upward exposed uses are the initial live-in sets
+		for (SSABB& bb : ssaRep->bbs) {
+			HIdBitSet& uses = liveIn[bb.id];
+			HIdBitSet& kills = defs[bb.id];
+			for (HId outId : bb.outBlocks) {
+				if (outId < n)
+					preds[outId].push_back (bb.id);
+			}
+			for (HId id : bb.exprIds) {
+				SSAExpression& expr = ssaRep->expressions[id];
+				for (SSAArgument& arg : expr.subExpressions) {
+					if (arg.type != SSAArgType::eId || arg.location != SSALocation::eReg)
+						continue;
+					if (arg.ssaId && ssaRep->expressions[arg.ssaId].type != SSAExprType::eInput)
+						continue;
+					RegisterSlice* slice = arch->getRegSlice (arg.locref.refId);
+					if (slice && !kills.contains (slice->parentIndex))
+						uses.insert (slice->parentIndex);
+				}
+				if (expr.location != SSALocation::eReg || expr.type == SSAExprType::eInput || EXPR_IS_TRANSPARENT (expr.type))
+					continue;
+				//only a write to the whole register kills it
+				RegisterSlice* slice = arch->getRegSlice (expr.locref.refId);
+				if (slice && slice->parentId == expr.locref.refId)
+					kills.insert (slice->parentIndex);
+			}
+		}
+
+		HList<HId> worklist;
+		HIdBitSet queued (n);
+		for (auto it = ssaRep->bbs.list.rbegin(); it != ssaRep->bbs.list.rend(); ++it) {
+			worklist.push_back (it->id);
+			queued.insert (it->id);
+		}
+		HIdBitSet newLiveIn;
+		while (!worklist.empty()) {
+			HId blockId = worklist.back();
+			worklist.pop_back();
+			queued.erase (blockId);
+
+			SSABB* bb = ssaRep->bbs.get (blockId);
+			for (HId outId : bb->outBlocks) {
+				if (outId < n)
+					liveOut[blockId].unite (liveIn[outId]);
+			}
+			newLiveIn = liveOut[blockId];
+			newLiveIn.subtract (defs[blockId]);
+			if (!liveIn[blockId].unite (newLiveIn))
+				continue;
+			for (HId predId : preds[blockId]) {
+				if (!queued.contains (predId)) {
+					queued.insert (predId);
+					worklist.push_back (predId);
+				}
+			}
+		}
+	}
+
+	void SSALiveness::clear() {
+		version = 0;
+		liveIn.clear();
+		liveOut.clear();
+	}
+
+	void SSALiveness::print (Architecture* arch, int indent) {
+		printIndent (indent);
+		printf ("Liveness\n");
+		for (size_t blockId = 0; blockId < liveIn.size(); blockId++) {
+			if (liveIn[blockId].empty() && liveOut[blockId].empty())
+				continue;
+			printIndent (indent + 1);
+			printf ("Block %zu In: ", blockId);
+			for (uint32_t i = 0; i < arch->parentRegs.size(); i++) {
+				if (liveIn[blockId].contains (i))
+					printf ("%s, ", arch->getRegister (arch->parentRegs[i])->name.cstr());
+			}
+			printf ("Out: ");
+			for (uint32_t i = 0; i < arch->parentRegs.size(); i++) {
+				if (liveOut[blockId].contains (i))
+					printf ("%s, ", arch->getRegister (arch->parentRegs[i])->name.cstr());
+			}
+			printf ("\n");
+		}
+	}
+}
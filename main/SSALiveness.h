@@ -0,0 +1,32 @@
+#ifndef SSALIVENESS_H
+#define SSALIVENESS_H
+
+#include "General.h"
+#include "HIdList.h"
+
+namespace holodec {
+
+	struct Architecture;
+	struct SSARepresentation;
+
+	//block level liveness of the top-level registers, the bits of the sets are parentIndices
+	//a register is used by an argument which is not bound to a definition yet or which is bound to an input
+	//inputs do not kill a register so the live-in set of the entry block are the registers read by the function
+	struct SSALiveness {
+		uint64_t version = 0;//version of the SSARepresentation the sets were calculated for, 0 if never calculated
+		HList<HIdBitSet> liveIn;//indexed by the block id
+		HList<HIdBitSet> liveOut;
+
+		void analyze (Architecture* arch, SSARepresentation* ssaRep);
+
+		bool isLiveIn (HId blockId, uint32_t parentIndex) {
+			return blockId < liveIn.size() && liveIn[blockId].contains (parentIndex);
+		}
+		void clear();
+
+		void print (Architecture* arch, int indent = 0);
+	};
+
+}
+
+#endif // SSALIVENESS_H
@@ -0,0 +1,146 @@
+#include "SSAPassManager.h"
+#include "Profiler.h"
+
+#include <chrono>
+
+namespace holodec {
+
+	void SSAPassManager::addPass (const char* name, SSATransformer* transformer, bool interprocedural) {
+		passes.push_back ({name, transformer, interprocedural, SSAPassStats()});
+	}
+
+	SSAFunctionPassState* SSAPassManager::getState (Function* function) {
+		SSAFunctionPassState* state = &functionStates[function];
+		if (state->lastRun.size() != passes.size())
+			state->lastRun.resize (passes.size(), 0);
+		return state;
+	}
+
+	bool SSAPassManager::runPass (size_t index, Function* function, SSAFunctionPassState* state) {
+		SSAPass& pass = passes[index];
+		if (state->lastRun[index] == function->ssaRep.version) {
+			pass.stats.skips++;
+			state->stats.skips++;
+			return false;
+		}
+		uint64_t version = function->ssaRep.version;
+		auto start = std::chrono::steady_clock::now();
+		bool applied;
+		{
+			HPROFILE_SCOPE (pass.name, "addr", function->baseaddr);
+			applied = pass.transformer->doTransformation (binary, function);
+		}
+		double time = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+		pass.stats.runs++;
+		pass.stats.time += time;
+		state->stats.time += time;
+		//a pass can change the function without reporting it, e.g. when it only adds edges
+		bool changed = applied || function->ssaRep.version != version;
+		if (changed) {
+			pass.stats.changes++;
+			state->stats.changes++;
+			function->ssaRep.invalidateExpressions();
+		} else {
+			state->lastRun[index] = version;
+		}
+		return changed;
+	}
+
+	bool SSAPassManager::run (Function* function) {
+		SSAFunctionPassState* state = getState (function);
+		bool applied = false;
+		for (size_t i = 0; i < passes.size(); i++)
+			applied |= runPass (i, function, state);
+		state->stats.runs++;
+		function->ssaRep.compressIfSparse();
+		return applied;
+	}
+
+	bool SSAPassManager::runToFixpoint (Function* function) {
+		bool changed = false;
+		while (run (function))
+			changed = true;
+		return changed;
+	}
+
+	void SSAPassManager::runToFixpoint (HList<Function*>& functions) {
+		HMap<Function*, HList<Function*>> callers;
+		for (Function* function : functions) {
+			for (uint64_t addr : function->funcsCalled) {
+				Function* callee = binary->getFunctionByAddr (addr);
+				if (callee)
+					callers[callee].push_back (function);
+			}
+		}
+		HList<Function*> worklist (functions.begin(), functions.end());
+		for (Function* function : functions)
+			getState (function)->queued = true;
+		for (size_t i = 0; i < worklist.size(); i++) {
+			Function* function = worklist[i];
+			getState (function)->queued = false;
+
+			FuncRegState regStates = function->regStates;
+			runToFixpoint (function);
+			if (regStates == function->regStates)
+				continue;
+			//the callers need to apply the new register states
+			auto it = callers.find (function);
+			if (it == callers.end())
+				continue;
+			for (Function* caller : it->second) {
+				markDirty (caller, true);
+				SSAFunctionPassState* state = getState (caller);
+				if (!state->queued) {
+					state->queued = true;
+					worklist.push_back (caller);
+				}
+			}
+		}
+	}
+
+	void SSAPassManager::markDirty (Function* function, bool interproceduralOnly) {
+		SSAFunctionPassState* state = getState (function);
+		for (size_t i = 0; i < passes.size(); i++) {
+			if (!interproceduralOnly || passes[i].interprocedural)
+				state->lastRun[i] = 0;
+		}
+	}
+
+	void SSAPassManager::mergeStats (SSAPassManager* other) {
+		for (size_t i = 0; i < passes.size() && i < other->passes.size(); i++) {
+			SSAPassStats& stats = passes[i].stats;
+			SSAPassStats& otherStats = other->passes[i].stats;
+			stats.runs += otherStats.runs;
+			stats.skips += otherStats.skips;
+			stats.changes += otherStats.changes;
+			stats.time += otherStats.time;
+		}
+		for (auto& entry : other->functionStates) {
+			SSAFunctionPassState* state = getState (entry.first);
+			state->stats.runs += entry.second.stats.runs;
+			state->stats.skips += entry.second.stats.skips;
+			state->stats.changes += entry.second.stats.changes;
+			state->stats.time += entry.second.stats.time;
+		}
+	}
+
+	void SSAPassManager::printStats (bool perFunction) {
+		printf ("Pass Statistics\n");
+		for (SSAPass& pass : passes) {
+			printIndent (1);
+			printf ("%-24s Runs: %6" PRIu64 " Skipped: %6" PRIu64 " Changed: %6" PRIu64 " Time: %8.3f ms\n", pass.name, pass.stats.runs, pass.stats.skips, pass.stats.changes, pass.stats.time * 1000.0);
+		}
+		if (!perFunction)
+			return;
+		printf ("Function Statistics\n");
+		for (Function* function : binary->functions) {
+			auto it = functionStates.find (function);
+			if (it == functionStates.end())
+				continue;
+			SSAPassStats& stats = it->second.stats;
+			printIndent (1);
+			printf ("%-24s Iterations: %4" PRIu64 " Skipped: %6" PRIu64 " Changed: %6" PRIu64 " Time: %8.3f ms\n", binary->getSymbol (function->symbolref)->name.cstr(), stats.runs, stats.skips, stats.changes, stats.time * 1000.0);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef SSAPASSMANAGER_H
+#define SSAPASSMANAGER_H
+
+#include "SSATransformer.h"
+#include "Function.h"
+
+namespace holodec {
+
+	struct SSAPassStats {
+		uint64_t runs = 0;//for functions the number of rounds over all passes
+		uint64_t skips = 0;
+		uint64_t changes = 0;
+		double time = 0.0;//wall time in seconds
+	};
+
+	struct SSAPass {
+		const char* name;
+		SSATransformer* transformer;
+		bool interprocedural;//depends on the register states of the called functions
+		SSAPassStats stats;
+	};
+
+	struct SSAFunctionPassState {
+		HList<uint64_t> lastRun;//per pass the version of the function when the pass last ran without changing it
+		SSAPassStats stats;
+		bool queued = false;
+	};
+
+	//runs passes on functions and only where the function changed since the pass last ran on it
+	//the analyses cached in the SSARepresentation are invalidated whenever a pass changes a function
+	struct SSAPassManager {
+		Binary* binary;
+		HList<SSAPass> passes;
+		HMap<Function*, SSAFunctionPassState> functionStates;
+
+		SSAPassManager (Binary* binary) : binary (binary) {}
+
+		void addPass (const char* name, SSATransformer* transformer, bool interprocedural = false);
+
+		//runs every pass once in order, returns true if any pass changed the function
+		bool run (Function* function);
+		//runs the passes until no pass changes the function
+		bool runToFixpoint (Function* function);
+		//runs the passes to a fixpoint on all functions
+		//functions are only revisited if the register states of a called function changed
+		void runToFixpoint (HList<Function*>& functions);
+
+		//forces the passes to run again on the function
+		void markDirty (Function* function, bool interproceduralOnly = false);
+
+		//adds the statistics of another manager with the same passes
+		void mergeStats (SSAPassManager* other);
+		void printStats (bool perFunction = true);
+
+	private:
+		SSAFunctionPassState* getState (Function* function);
+		bool runPass (size_t index, Function* function, SSAFunctionPassState* state);
+	};
+
+}
+
+#endif // SSAPASSMANAGER_H
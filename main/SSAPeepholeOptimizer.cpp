@@ -2,6 +2,7 @@
 #include "Function.h"
 #include <cassert>
 #include <algorithm>
+#include <functional>
 
 namespace holodec {
 
@@ -12,19 +13,85 @@ namespace holodec {
 	}
 
 	bool SSAPeepholeOptimizer::doTransformation(Binary* binary, Function* function) {
+		SSARepresentation& ssaRep = function->ssaRep;
+		PhRuleSet& ruleSet = phOpt->ruleSet;
 
-		bool applied = false;
-
-		for (size_t i = 0; i < function->ssaRep.expressions.size();) {
-			SSAExpression& expr = function->ssaRep.expressions[i + 1];
-
-			if (!phOpt->ruleSet.match(arch, &function->ssaRep, &expr)) {
-				i++;
+		//the expressions are visited in the order of their ids like a scan over the function would
+		//an expression that changes behind the current one is left for the next run
+		HList<HId> worklist;//min-heap
+		HList<HId> deferred;
+		HIdBitSet queued (ssaRep.expressions.size());
+		HId position = 0;
+		auto push = [&worklist, &deferred, &queued, &position] (HId id) {
+			if (!id || queued.contains (id))
+				return;
+			queued.insert (id);
+			if (id < position) {
+				deferred.push_back (id);
+			} else {
+				worklist.push_back (id);
+				std::push_heap (worklist.begin(), worklist.end(), std::greater<HId>());
 			}
-			else {
-				applied = true;
+		};
+		//a change can make the expression itself match and every expression above it
+		//that reaches it through at most maxDepth arguments matched by the rules
+		HList<HId> users;
+		auto pushWithUsers = [&ssaRep, &ruleSet, &users, &push] (HId id) {
+			push (id);
+			users.clear();
+			users.push_back (id);
+			size_t begin = 0;
+			for (uint32_t depth = 0; depth < ruleSet.maxDepth && begin < users.size(); depth++) {
+				size_t end = users.size();
+				for (size_t i = begin; i < end; i++) {
+					SSAExpression& expr = ssaRep.expressions[users[i]];
+					if (!expr.id || !ruleSet.isArgument (&expr))
+						continue;
+					for (HId refId : expr.refs) {
+						push (refId);
+						users.push_back (refId);
+					}
+				}
+				begin = end;
 			}
+		};
+
+		if (!ssaRep.trackChanges) {
+			//first run on this function, every expression is a candidate
+			for (HId id = 1; id <= ssaRep.expressions.size(); id++)
+				push (id);
+			ssaRep.trackChanges = true;
+		} else {
+			//only expressions changed since the last run
+			for (HId id : ssaRep.changedExprs)
+				if (id <= ssaRep.expressions.size())
+					pushWithUsers (id);
+		}
+		ssaRep.clearChanges();
+
+		bool applied = false;
+		while (!worklist.empty()) {
+			std::pop_heap (worklist.begin(), worklist.end(), std::greater<HId>());
+			HId id = worklist.back();
+			worklist.pop_back();
+			queued.erase (id);
+			position = id;
+			if (!ssaRep.expressions[id].id || !ruleSet.match (arch, &ssaRep, &ssaRep.expressions[id]))
+				continue;
+			applied = true;
+			//revisit everything the rule touched, the root is matched again until no rule applies
+			for (HId changedId : ssaRep.changedExprs)
+				pushWithUsers (changedId);
+			for (HId matchedId : ruleSet.context.expressionsMatched)
+				pushWithUsers (matchedId);
+			pushWithUsers (id);
+			ssaRep.clearChanges();
 		}
+		ssaRep.clearChanges();
+		for (HId id : deferred)
+			ssaRep.logChange (id);
+		if (phOpt->reorderByHits)
+			ruleSet.reorderByHits();
 		return applied;
 	}
 
@@ -1,4 +1,5 @@
 #include "SSAPhiNodeGenerator.h"
+#include "HoloIO.h"
 #include "Function.h"
 #include "Architecture.h"
 #include <assert.h>
@@ -9,7 +10,7 @@ namespace holodec {
 	void setSSAArg(SSARepresentation* ssaRep, SSAExpression* expr, HId argIndex, SSAArgument arg) {
 		if (arg.ssaId == 338)
 			printf("");
-		expr->subExpressions[argIndex].replace(arg);
+		expr->replaceArgument(ssaRep, argIndex, arg);
 	}
 
 	void BasicBlockWrapper::print (Architecture* arch) {
@@ -29,53 +30,98 @@ namespace holodec {
 		printf ("\n");
 
 		printf ("Outputs ");
-		for (SSARegDef& def : outputs) {
-			printf ("%s, ", arch->getRegister (def.regId)->name.cstr());
+		for (size_t i = 0; i < outputs.defined.size(); i++) {
+			for (uint64_t mask = outputs.defined[i]; mask; mask &= mask - 1) {
+				printf ("%s, ", arch->getRegister (arch->parentSliceRegs[i][lowestBitIndex (mask)])->name.cstr());
+			}
 		}
 		printf ("\n");
 	}
 
-
-	void SSAPhiNodeGenerator::addRegDef(HId id, Register* reg, HList<SSARegDef>* list, bool replace) {
-		bool rep = false;
-		int i = 0;
-		for (auto it = list->begin(); it != list->end();) {
-			if(id == 0xa4)
-				i++;
-			if (it->regId == reg->id || (replace && it->parentId == reg->parentRef.refId && (reg->offset <= it->offset && (it->offset + it->size) <= (reg->offset + reg->size)))) {
-				if (rep) {
-					it = list->erase (it);
-					continue;
-				} else {
-					*it = {id, reg->id, reg->parentRef.refId, reg->offset, reg->size};
-					rep = true;
-				}
-			}
-			++it;
+	void SSARegDefs::add(Architecture* arch, HId ssaId, Register* reg, bool replace) {
+		if (defined.empty()) {
+			defined.resize (arch->parentRegs.size(), 0);
+			ssaIds.resize (arch->regSlices.size(), 0);
 		}
-		if (!rep)
-			list->push_back ({id, reg->id, reg->parentRef.refId, reg->offset, reg->size});
+		RegisterSlice* slice = arch->getRegSlice (reg->id);
+		assert (slice);
+		if (replace)
+			defined[slice->parentIndex] &= ~slice->containsMask;
+		defined[slice->parentIndex] |= slice->bit();
+		ssaIds[reg->id] = ssaId;
+	}
+	HId SSARegDefs::get(Architecture* arch, Register* reg, HId* defRegId) {
+		if (defined.empty())
+			return 0;
+		RegisterSlice* slice = arch->getRegSlice (reg->id);
+		assert (slice);
+		uint64_t mask = defined[slice->parentIndex] & slice->containedMask;
+		if (!mask)
+			return 0;
+		*defRegId = arch->parentSliceRegs[slice->parentIndex][lowestBitIndex (mask)];
+		return ssaIds[*defRegId];
+	}
+	void SSARegDefs::clear() {
+		for (uint64_t& mask : defined)
+			mask = 0;
+	}
 
+	SSAArgument getRegDefArg(Architecture* arch, HId ssaId, HId defRegId, Register* reg) {
+		if (defRegId == reg->id)
+			return SSAArgument::createId(ssaId, reg->size);
+		return SSAArgument::createReg(reg, ssaId, reg->offset - arch->getRegister(defRegId)->offset);
 	}
 
-	SSAArgument SSAPhiNodeGenerator::getSSAId(BasicBlockWrapper* wrapper, Register* reg) {
 
-		while (true) {
+	BasicBlockWrapper* SSAPhiNodeGenerator::getWrapper(HId id) {
+		SSABB* bb = function->ssaRep.bbs.get(id);
+		if (!bb)
+			return nullptr;
+		return &bbwrappers[bb - function->ssaRep.bbs.list.data()];
+	}
 
-			for (SSARegDef& def : wrapper->outputs) {
-				if (def.regId == reg->id) {
-					return SSAArgument::createId(def.ssaId, reg->size);
-					break;
-				}
+	void SSAPhiNodeGenerator::getDominator() {
+		domTree = function->ssaRep.getDominatorTree();
+		liveness = function->ssaRep.getLiveness(arch);
+		phiBlocks.clear();
+		phiBlocks.resize(arch->parentRegs.size());
+		phiBlocksCalculated.clear();
+	}
+	bool SSAPhiNodeGenerator::needsPhi(HId blockId, Register* reg) {
+		if (!domTree->reachable(blockId))
+			return true;
+		RegisterSlice* slice = arch->getRegSlice(reg->id);
+		assert(slice);
+		if (!phiBlocksCalculated.contains(slice->parentIndex)) {
+			HIdBitSet defBlocks(domTree->idoms.size());
+			defBlocks.insert(domTree->rpo[0]);
+			for (BasicBlockWrapper& wrapper : bbwrappers) {
+				if (!wrapper.outputs.defined.empty() && wrapper.outputs.defined[slice->parentIndex])
+					defBlocks.insert(wrapper.ssaBB->id);
 			}
-			for (SSARegDef& def : wrapper->outputs) {
-				if ((def.parentId == (HId)reg->parentRef) && ((def.offset <= reg->offset) && ((reg->offset + reg->size) <= (def.offset + def.size)))) {
-					return SSAArgument::createReg(reg, def.ssaId, reg->offset - def.offset);
-				}
+			HIdBitSet& blocks = phiBlocks[slice->parentIndex];
+			domTree->iteratedFrontier(&defBlocks, &blocks);
+			for (HId frontierId : domTree->rpo) {
+				if (blocks.contains(frontierId) && !liveness->isLiveIn(frontierId, slice->parentIndex))
+					blocks.erase(frontierId);
 			}
-			if (wrapper->ssaBB->inBlocks.size() != 1)
+			phiBlocksCalculated.insert(slice->parentIndex);
+		}
+		return phiBlocks[slice->parentIndex].contains(blockId);
+	}
+
+	SSAArgument SSAPhiNodeGenerator::getSSAId(BasicBlockWrapper* wrapper, Register* reg) {
+
+		while (true) {
+			HId defRegId;
+			if (HId ssaId = wrapper->outputs.get(arch, reg, &defRegId))
+				return getRegDefArg(arch, ssaId, defRegId, reg);
+			if (wrapper->ssaBB->inBlocks.size() == 1)
+				wrapper = getWrapper(wrapper->ssaBB->inBlocks[0]);
+			else if (wrapper->ssaBB->inBlocks.size() > 1 && !needsPhi(wrapper->ssaBB->id, reg))
+				wrapper = getWrapper(domTree->idom(wrapper->ssaBB->id));
+			else
 				break;
-			wrapper = getWrapper(wrapper->ssaBB->inBlocks[0]);
 		}
 		assert(wrapper->ssaBB->inBlocks.size() > 1);
 
@@ -89,29 +135,26 @@ namespace holodec {
 		phinode.size = parent_reg->size;
 		phinode.instrAddr = wrapper->ssaBB->startaddr;
 		HId id = function->ssaRep.addAtStart(&phinode, wrapper->ssaBB);
-		addRegDef(id, parent_reg, &wrapper->outputs, false);
+		wrapper->outputs.add(arch, id, parent_reg, false);
 		for (HId bbId : wrapper->ssaBB->inBlocks) {
 			//expressions need to reloaded after each call to getSSAId as they may insert an expression
-			function->ssaRep.expressions[id].subExpressions.push_back(SSAArgument::createBlock(bbId));
-			function->ssaRep.expressions[id].subExpressions.push_back(getSSAId(getWrapper(bbId), parent_reg));
+			SSAArgument arg = getSSAId(getWrapper(bbId), parent_reg);
+			function->ssaRep.expressions[id].addArgument(&function->ssaRep, SSAArgument::createBlock(bbId));
+			function->ssaRep.expressions[id].addArgument(&function->ssaRep, arg);
 		}
 		return SSAArgument::createReg(parent_reg, id);
 	}
-	SSAArgument SSAPhiNodeGenerator::getSSAId(BasicBlockWrapper* wrapper, HList<SSARegDef>& defs, Register* reg) {
+	SSAArgument SSAPhiNodeGenerator::getSSAId(BasicBlockWrapper* wrapper, SSARegDefs& defs, Register* reg) {
 
-		for (SSARegDef& def : defs) {
-			if (def.regId == reg->id) {
-				return SSAArgument::createId(def.ssaId, reg->size);
-			}
-		}
-		for (SSARegDef& def : defs) {
-			if ((def.parentId == (HId)reg->parentRef) && ((def.offset <= reg->offset) && ((reg->offset + reg->size) <= (def.offset + def.size)))) {
-				return SSAArgument::createReg(reg, def.ssaId, reg->offset - def.offset);
-			}
-		}
+		HId defRegId;
+		if (HId ssaId = defs.get(arch, reg, &defRegId))
+			return getRegDefArg(arch, ssaId, defRegId, reg);
 		if (wrapper->ssaBB->inBlocks.size() == 1) {
 			return getSSAId(getWrapper(wrapper->ssaBB->inBlocks[0]), reg);
 		}
+		if (wrapper->ssaBB->inBlocks.size() > 1 && !needsPhi(wrapper->ssaBB->id, reg)) {
+			return getSSAId(getWrapper(domTree->idom(wrapper->ssaBB->id)), reg);
+		}
 
 		assert(wrapper->ssaBB->inBlocks.size() > 1);
 
@@ -125,28 +168,22 @@ namespace holodec {
 		phinode.size = parent_reg->size;
 		phinode.instrAddr = wrapper->ssaBB->startaddr;
 		HId id = function->ssaRep.addAtStart(&phinode, wrapper->ssaBB);
-		addRegDef(id, parent_reg, &defs, false);
-		bool contains = false;
-		for (SSARegDef& def : wrapper->outputs) {
-			if (def.regId == parent_reg->id || ((def.parentId == (HId)parent_reg->parentRef) && ((def.offset <= parent_reg->offset) && ((parent_reg->offset + parent_reg->size) <= (def.offset + def.size))))) {
-				contains = true;
-				break;
-			}
-		}
-		if (!contains) {
-			addRegDef(id, parent_reg, &wrapper->outputs, false);
+		defs.add(arch, id, parent_reg, false);
+		if (!wrapper->outputs.get(arch, parent_reg, &defRegId)) {
+			wrapper->outputs.add(arch, id, parent_reg, false);
 		}
 		for (HId bbId : wrapper->ssaBB->inBlocks) {
 			//expressions need to reloaded after each call to getSSAId as they may insert an expression
-			function->ssaRep.expressions[id].subExpressions.push_back(SSAArgument::createBlock(bbId));
-			function->ssaRep.expressions[id].subExpressions.push_back(getSSAId(getWrapper(bbId), parent_reg));
+			SSAArgument arg = getSSAId(getWrapper(bbId), parent_reg);
+			function->ssaRep.expressions[id].addArgument(&function->ssaRep, SSAArgument::createBlock(bbId));
+			function->ssaRep.expressions[id].addArgument(&function->ssaRep, arg);
 		}
 		return SSAArgument::createReg(parent_reg, id);
 	}
 
 	bool SSAPhiNodeGenerator::doTransformation (Binary* binary, Function* function) {
 
-		printf ("Generating Phi-Nodes for Function at Address 0x%" PRIx64 "\n", function->baseaddr);
+		HLOG_DEBUG (g_pass_logger, "Generating Phi-Nodes for Function at Address 0x%" PRIx64, function->baseaddr);
 		this->binary = binary;
 		this->function = function;
 
@@ -161,7 +198,7 @@ namespace holodec {
 				SSAExpression* expr = function->ssaRep.expressions.get(id);
 				switch (expr->location) {
 				case SSALocation::eReg:
-					addRegDef(expr->id, arch->getRegister(expr->locref.refId), &bbwrapper.outputs, !EXPR_IS_TRANSPARENT(expr->type));
+					bbwrapper.outputs.add(arch, expr->id, arch->getRegister(expr->locref.refId), !EXPR_IS_TRANSPARENT(expr->type));
 					break;
 				default:
 					break;
@@ -169,8 +206,11 @@ namespace holodec {
 			}
 		}
 
+		getDominator();
+
+		SSARegDefs defs;
 		for (BasicBlockWrapper& bbwrapper : bbwrappers) {//iterate Blocks
-			HList<SSARegDef> defs;
+			defs.clear();
 			for (size_t j = 0; j < bbwrapper.ssaBB->exprIds.size(); j++) {//iterate Expressions
 				HId id = bbwrapper.ssaBB->exprIds[j];
 				SSAExpression* expr = function->ssaRep.expressions.get(id);
@@ -185,36 +225,35 @@ namespace holodec {
 					SSAArgument anArg = getSSAId(&bbwrapper, defs, reg);
 					assert(anArg.ssaId);
 					expr = function->ssaRep.expressions.get(id);//reload Expression
-					expr->subExpressions[i].replace(anArg);
+					expr->replaceArgument(&function->ssaRep, i, anArg);
 					continue;
 				}
 				switch (expr->location) {
 				case SSALocation::eReg:
-					addRegDef(expr->id, arch->getRegister(expr->locref.refId), &defs, !EXPR_IS_TRANSPARENT(expr->type));
+					defs.add(arch, expr->id, arch->getRegister(expr->locref.refId), !EXPR_IS_TRANSPARENT(expr->type));
 					break;
 				default:
 					break;
 				}
 			}
 		}
-		function->ssaRep.compress();
 		return true;
 	}
 
 	bool SSAPhiNodeGenerator::handleBBs (BasicBlockWrapper* wrapper, Register* reg,  std::vector<std::pair<HId, HId>>& gatheredIds, std::vector<HId>& visitedBlocks) {
 		//printf ("\nHandling Block %d\n", wrapper->ssaBB->id);
 
-		SSARegDef* foundParentDef = nullptr;
-		for (SSARegDef& regDef : wrapper->outputs) {
-			if (regDef.parentId == reg->parentRef.refId) {
-				if (regDef.regId == reg->id) {
-					gatheredIds.push_back(std::make_pair(wrapper->ssaBB->id,regDef.ssaId));
-					//printf ("\Found perfect Match %d\n", regDef.ssaId);
-					return true;
-				} else if (regDef.regId == reg->parentRef.refId) {
-					//printf ("\Found parent Match %d\n", regDef.ssaId);
-					foundParentDef = &regDef;
-				}
+		HId foundParentDef = 0;
+		if (!wrapper->outputs.defined.empty()) {
+			RegisterSlice* slice = arch->getRegSlice(reg->id);
+			uint64_t mask = wrapper->outputs.defined[slice->parentIndex];
+			if (mask & slice->bit()) {
+				gatheredIds.push_back(std::make_pair(wrapper->ssaBB->id, wrapper->outputs.ssaIds[reg->id]));
+				//printf ("\Found perfect Match %d\n", regDef.ssaId);
+				return true;
+			} else if (mask & arch->getRegSlice(reg->parentRef.refId)->bit()) {
+				//printf ("\Found parent Match %d\n", regDef.ssaId);
+				foundParentDef = wrapper->outputs.ssaIds[reg->parentRef.refId];
 			}
 		}
 		if (foundParentDef) {
@@ -226,15 +265,15 @@ namespace holodec {
 			expr.location = SSALocation::eReg;
 			expr.locref = {reg->id, 0};
 			expr.subExpressions = {
-				SSAArgument::createReg({foundParentDef->regId, 0}, reg->size, reg->offset, foundParentDef->ssaId)
+				SSAArgument::createReg({reg->parentRef.refId, 0}, reg->size, reg->offset, foundParentDef)
 			};
 			bool found = false;
 			for (auto it = wrapper->ssaBB->exprIds.begin(); it != wrapper->ssaBB->exprIds.end(); ++it) {
-				if (foundParentDef->ssaId == *it) {
-					expr.instrAddr = function->ssaRep.expressions[foundParentDef->ssaId].instrAddr;
+				if (foundParentDef == *it) {
+					expr.instrAddr = function->ssaRep.expressions[foundParentDef].instrAddr;
 
 					HId exprId = *function->ssaRep.addAfter (&expr, wrapper->ssaBB->exprIds, it);
-					addRegDef (exprId, reg, &wrapper->outputs, false);
+					wrapper->outputs.add (arch, exprId, reg, false);
 					gatheredIds.push_back(std::make_pair(wrapper->ssaBB->id, exprId));
 					found = true;
 					break;
@@ -4,13 +4,20 @@
 #include "SSATransformer.h"
 #include "General.h"
 #include "Architecture.h"
+#include "SSALiveness.h"
 
 namespace holodec {
 
-	struct SSARegDef{
-		HId ssaId;
-		HId regId, parentId;
-		uint64_t offset, size;
+	//the register definitions of a block
+	//per parent register a mask of the slices which are defined and per register the defining ssaId
+	struct SSARegDefs{
+		HList<uint64_t> defined;//indexed by parentIndex
+		HList<HId> ssaIds;//indexed by register id
+
+		void add(Architecture* arch, HId ssaId, Register* reg, bool replace);
+		//the definition of the register or of the smallest defined register containing it
+		HId get(Architecture* arch, Register* reg, HId* defRegId);
+		void clear();
 	};
 	struct SSAMemDef{
 		HId ssaId;
@@ -20,7 +27,7 @@ namespace holodec {
 	struct BasicBlockWrapper{
 		SSABB* ssaBB;
 		
-		HList<SSARegDef> outputs;
+		SSARegDefs outputs;
 		
 		void print(Architecture* arch);
 	};
@@ -30,30 +37,27 @@ namespace holodec {
 		Function* function;
 		
 		HList<BasicBlockWrapper> bbwrappers;
+
+		SSADominatorTree* domTree = nullptr;
+		SSALiveness* liveness = nullptr;
+		HList<HIdBitSet> phiBlocks;//per parent register the blocks in which definitions meet and the register is live
+		HIdBitSet phiBlocksCalculated;
 		
 		virtual bool doTransformation (Binary* binary, Function* function);
 		
-		SSARegDef findRegDef();
-
 		void resolveRegs();
 
-		void addRegDef(HId id, Register* reg, HList<SSARegDef>* list, bool replace);
-
 		SSAArgument getSSAId(BasicBlockWrapper* wrapper, Register* reg);
-		SSAArgument getSSAId(BasicBlockWrapper* wrapper, HList<SSARegDef>& defs, Register* reg);
+		SSAArgument getSSAId(BasicBlockWrapper* wrapper, SSARegDefs& defs, Register* reg);
 		
 		bool handleBBs(BasicBlockWrapper* wrapper, Register* reg, std::vector<std::pair<HId, HId>>& gatheredIds, std::vector<HId>& visitedBlocks);
 		bool handleBBs(BasicBlockWrapper* wrapper, Memory* mem, std::vector<std::pair<HId, HId>>& gatheredIds, std::vector<HId>& visitedBlocks);
 		
-		BasicBlockWrapper* getWrapper(HId id){
-			for(BasicBlockWrapper& wrapper : bbwrappers){
-				if(wrapper.ssaBB->id == id)
-					return &wrapper;
-			}
-			return nullptr;
-		}
+		BasicBlockWrapper* getWrapper(HId id);
 		
 		void getDominator();
+		//if false the value of the register at the start of the block is the one at the end of the immediate dominator
+		bool needsPhi(HId blockId, Register* reg);
 	};
 
 }
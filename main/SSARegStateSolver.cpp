@@ -0,0 +1,253 @@
+#include "SSARegStateSolver.h"
+#include "SSA.h"
+#include "Binary.h"
+#include "Architecture.h"
+
+#include <algorithm>
+
+namespace holodec {
+
+	uint32_t SSARegStateSolver::parentIndex (HId regId) {
+		RegisterSlice* slice = arch->getRegSlice (regId);
+		return slice ? slice->parentIndex : (uint32_t) - 1;
+	}
+
+	FuncRegState* SSARegStateSolver::getCalleeState (SSAExpression& callExpr) {
+		if (callExpr.type != SSAExprType::eCall || callExpr.subExpressions.empty() || callExpr.subExpressions[0].type != SSAArgType::eUInt)
+			return nullptr;
+		Function* callFunc = binary->getFunctionByAddr (callExpr.subExpressions[0].uval);
+		if (!callFunc || !callFunc->regStates.parsed)
+			return nullptr;
+		return &callFunc->regStates;
+	}
+
+	void SSARegStateSolver::need (SSAArgument& arg) {
+		if (arg.type != SSAArgType::eId || !arg.ssaId || needed.contains (arg.ssaId))
+			return;
+		needed.insert (arg.ssaId);
+		worklist.push_back (arg.ssaId);
+	}
+
+	//the states of the expressions whose search is finished, the others hold their position in the search
+	static const uint32_t UNCHANGED_NO = 0;
+	static const uint32_t UNCHANGED_YES = 1;
+
+	static uint64_t unchangedKey (HId id, uint32_t index) {
+		return ((uint64_t) id << 32) | index;
+	}
+	//the arguments that decide whether the value of the expression is unchanged
+	static SSAArgument* nextUnchangedArg (SSAExpression& expr, uint32_t* next) {
+		switch (expr.type) {
+		case SSAExprType::eAssign:
+			if (*next == 0 && !expr.subExpressions.empty())
+				return &expr.subExpressions[(*next)++];
+			return nullptr;
+		case SSAExprType::eOutput:
+			if (*next == 0) {
+				*next = 2;
+				return &expr.subExpressions[1];
+			}
+			return nullptr;
+		case SSAExprType::ePhi:
+			while (*next < expr.subExpressions.size()) {
+				SSAArgument* arg = &expr.subExpressions[(*next)++];
+				if (arg->location != SSALocation::eBlock)
+					return arg;
+			}
+			return nullptr;
+		default:
+			return nullptr;
+		}
+	}
+
+	void SSARegStateSolver::pushUnchanged (SSARepresentation* ssaRep, HId id, uint32_t index) {
+		SSAExpression& expr = ssaRep->expressions[id];
+		bool unchanged;
+		switch (expr.type) {
+		case SSAExprType::eInput:
+			unchanged = expr.location == SSALocation::eReg && parentIndex (expr.locref.refId) == index;
+			break;
+		case SSAExprType::eAssign:
+		case SSAExprType::ePhi:
+			unchanged = true;
+			break;
+		case SSAExprType::eOutput: {
+			unchanged = false;
+			if (expr.location != SSALocation::eReg || parentIndex (expr.locref.refId) != index || expr.subExpressions.size() < 2)
+				break;
+			if (expr.subExpressions[0].type != SSAArgType::eId)
+				break;
+			FuncRegState* state = getCalleeState (ssaRep->expressions[expr.subExpressions[0].ssaId]);
+			unchanged = state && !state->writes.contains (index);
+		}
+		break;
+		default:
+			unchanged = false;
+			break;
+		}
+		uint32_t position = unchangedPosition++;
+		uint64_t key = unchangedKey (id, index);
+		unchangedStates[key] = position;
+		unchangedStack.push_back (key);
+		unchangedFrames.push_back ({id, 0, position, unchanged});
+	}
+
+	//the argument is the value of the register at the entry of the function
+	//the value of an assignment, of the output of a call that does not write the register or of a phi is unchanged if all their arguments are
+	//the search is iterative because phi chains can be long, a cycle of phis does not change the value
+	//the expressions of a cycle get the same result, the results are kept for the whole calcRegState
+	bool SSARegStateSolver::isUnchanged (SSARepresentation* ssaRep, SSAArgument& arg, uint32_t index) {
+		if (arg.type != SSAArgType::eId || !arg.ssaId || arg.offset)
+			return false;
+		auto it = unchangedStates.find (unchangedKey (arg.ssaId, index));
+		if (it != unchangedStates.end())
+			return it->second == UNCHANGED_YES;
+		pushUnchanged (ssaRep, arg.ssaId, index);
+		while (true) {
+			UnchangedFrame& frame = unchangedFrames.back();
+			SSAArgument* childArg = frame.unchanged ? nextUnchangedArg (ssaRep->expressions[frame.id], &frame.next) : nullptr;
+			if (childArg) {
+				if (childArg->type != SSAArgType::eId || !childArg->ssaId || childArg->offset) {
+					frame.unchanged = false;
+					continue;
+				}
+				auto childIt = unchangedStates.find (unchangedKey (childArg->ssaId, index));
+				if (childIt == unchangedStates.end())
+					pushUnchanged (ssaRep, childArg->ssaId, index);
+				else if (childIt->second == UNCHANGED_NO)
+					frame.unchanged = false;
+				else if (childIt->second != UNCHANGED_YES)//still searched, so it is part of a cycle with this expression
+					frame.low = std::min (frame.low, childIt->second);
+				continue;
+			}
+			UnchangedFrame done = frame;
+			unchangedFrames.pop_back();
+			uint64_t key = unchangedKey (done.id, index);
+			if (done.low == unchangedStates[key]) {//the first expression of a cycle decides for all of them
+				uint64_t member;
+				do {
+					member = unchangedStack.back();
+					unchangedStack.pop_back();
+					unchangedStates[member] = done.unchanged ? UNCHANGED_YES : UNCHANGED_NO;
+				} while (member != key);
+			}
+			if (unchangedFrames.empty())
+				return done.unchanged;
+			UnchangedFrame& parent = unchangedFrames.back();
+			parent.unchanged = parent.unchanged && done.unchanged;
+			parent.low = std::min (parent.low, done.low);
+		}
+	}
+
+	void SSARegStateSolver::calcRegState (Function* function, FuncRegState* state) {
+		SSARepresentation* ssaRep = &function->ssaRep;
+		size_t regCount = arch->parentRegs.size();
+		if (allRegs.count() != regCount) {
+			allRegs.clear();
+			for (uint32_t i = 0; i < regCount; i++)
+				allRegs.insert (i);
+		}
+		state->clear();
+		state->reads.resize (regCount);
+		state->writes.resize (regCount);
+		state->clobbers.resize (regCount);
+		state->parsed = true;
+
+		needed.clear();
+		needed.resize (ssaRep->expressions.size());
+		worklist.clear();
+		unchangedStates.clear();
+		unchangedPosition = UNCHANGED_YES + 1;
+		//expressions with sideeffects are needed, the rest only if a needed expression uses them
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds) {
+				SSAExpression& expr = ssaRep->expressions[id];
+				if (EXPR_HAS_SIDEEFFECT (expr.type) && !needed.contains (id)) {
+					needed.insert (id);
+					worklist.push_back (id);
+				}
+			}
+		}
+		while (!worklist.empty()) {
+			SSAExpression& expr = ssaRep->expressions[worklist.back()];
+			worklist.pop_back();
+			switch (expr.type) {
+			case SSAExprType::eCall: {
+				FuncRegState* callState = getCalleeState (expr);
+				state->clobbers.unite (callState ? callState->clobbers : allRegs);
+				for (SSAArgument& arg : expr.subExpressions) {
+					//registers that are not read by the called function are not needed
+					if (arg.location == SSALocation::eReg && callState && !callState->reads.contains (parentIndex (arg.locref.refId)))
+						continue;
+					need (arg);
+				}
+			}
+			break;
+			case SSAExprType::eOutput: {
+				uint32_t index = expr.location == SSALocation::eReg ? parentIndex (expr.locref.refId) : (uint32_t) - 1;
+				FuncRegState* callState = nullptr;
+				if (expr.subExpressions[0].type == SSAArgType::eId)
+					callState = getCalleeState (ssaRep->expressions[expr.subExpressions[0].ssaId]);
+				//the previous value is needed until SSAApplyRegRef removes it so that the state only grows with the states of the called functions
+				if (!callState || callState->writes.contains (index))
+					need (expr.subExpressions[0]);
+				if (expr.subExpressions.size() > 1)
+					need (expr.subExpressions[1]);
+			}
+			break;
+			case SSAExprType::eReturn: {
+				for (SSAArgument& arg : expr.subExpressions) {
+					if (arg.location == SSALocation::eReg) {
+						uint32_t index = parentIndex (arg.locref.refId);
+						if (isUnchanged (ssaRep, arg, index))
+							continue;
+						state->writes.insert (index);
+					}
+					need (arg);
+				}
+			}
+			break;
+			default:
+				for (SSAArgument& arg : expr.subExpressions)
+					need (arg);
+				break;
+			}
+		}
+		for (SSABB& bb : ssaRep->bbs) {
+			for (HId id : bb.exprIds) {
+				SSAExpression& expr = ssaRep->expressions[id];
+				if (expr.location != SSALocation::eReg)
+					continue;
+				uint32_t index = parentIndex (expr.locref.refId);
+				if (index == (uint32_t) - 1)
+					continue;
+				if (expr.type == SSAExprType::eInput) {
+					if (needed.contains (id))
+						state->reads.insert (index);
+				} else if (expr.type != SSAExprType::ePhi && expr.type != SSAExprType::eOutput) {
+					state->clobbers.insert (index);
+				}
+			}
+		}
+		state->clobbers.unite (state->writes);
+	}
+
+	void SSARegStateSolver::solve (HList<Function*>& functions) {
+		for (Function* function : functions) {
+			function->regStates.clear();
+			function->regStates.parsed = true;
+		}
+		FuncRegState state;
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (Function* function : functions) {
+				calcRegState (function, &state);
+				FuncRegState& current = function->regStates;
+				changed |= current.reads.unite (state.reads);
+				changed |= current.writes.unite (state.writes);
+				changed |= current.clobbers.unite (state.clobbers);
+			}
+		}
+	}
+}
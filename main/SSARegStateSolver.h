@@ -0,0 +1,57 @@
+#ifndef SSAREGSTATESOLVER_H
+#define SSAREGSTATESOLVER_H
+
+#include "General.h"
+#include "HIdList.h"
+#include "Function.h"
+
+namespace holodec {
+
+	struct Binary;
+	struct Architecture;
+
+	//calculates the FuncRegState of functions in SSA form from the states of the functions they call
+	//called functions which are not parsed yet are assumed to read, write and clobber every register
+	struct SSARegStateSolver {
+		Architecture* arch;
+		Binary* binary;
+
+		SSARegStateSolver (Architecture* arch, Binary* binary) : arch (arch), binary (binary) {}
+
+		//one step with the current states of the called functions
+		void calcRegState (Function* function, FuncRegState* state);
+		//solves a strongly connected component of the call graph
+		//the states start empty and only grow so that a register which is only passed on to a recursive call is not read
+		void solve (HList<Function*>& functions);
+
+		//the state of the function called by a call expression, nullptr if unknown
+		FuncRegState* getCalleeState (SSAExpression& callExpr);
+
+	private:
+		//an expression in the search of isUnchanged
+		struct UnchangedFrame {
+			HId id;
+			uint32_t next;//the next argument to visit
+			uint32_t low;//the smallest position in the search of an expression in the same cycle
+			bool unchanged;
+		};
+
+		HIdBitSet allRegs;
+		HIdBitSet needed;
+		HList<HId> worklist;
+
+		//per expression and parent register index the result of isUnchanged or the position in the search while it is running
+		HMap<uint64_t, uint32_t> unchangedStates;
+		uint32_t unchangedPosition;
+		HList<UnchangedFrame> unchangedFrames;
+		HList<uint64_t> unchangedStack;
+
+		bool isUnchanged (SSARepresentation* ssaRep, SSAArgument& arg, uint32_t parentIndex);
+		void pushUnchanged (SSARepresentation* ssaRep, HId id, uint32_t parentIndex);
+		void need (SSAArgument& arg);
+		uint32_t parentIndex (HId regId);
+	};
+
+}
+
+#endif // SSAREGSTATESOLVER_H
@@ -1,16 +1,23 @@
 #include "SSATransformToC.h"
+#include "Profiler.h"
+
+#include <chrono>
 
 
 namespace holodec{
 	
 
 	bool SSATransformToC::shouldResolve(SSAExpression& expr) {
-		if (resolveIds.find(expr.id) != resolveIds.end()) {
+		if (resolveIds.contains(expr.id)) {
 			return true;
 		}
 		if (expr.refs.size() > 1) {
 			return true;
 		}
+		//values flowing through phi-nodes and updates need their own variable
+		if (!expr.refs.empty() && (EXPR_IS_TRANSPARENT(expr.type) || EXPR_IS_TRANSPARENT(function->ssaRep.expressions[expr.refs[0]].type))) {
+			return true;
+		}
 		if (EXPR_HAS_SIDEEFFECT(expr.type)) {
 			return true;
 		}
@@ -19,208 +26,244 @@ namespace holodec{
 
 
 	void SSATransformToC::printBasicBlock(SSABB& bb) {
-		printf("Basic Block %d\n", bb.id);
+		out->append("Basic Block ");
+		out->appendNumber(bb.id);
+		out->append('\n');
 		for (HId id : bb.exprIds) {
 			SSAExpression& expr = function->ssaRep.expressions[id];
 			if (shouldResolve(expr))
 				printExpression(expr);
 		}
 
-		if(bb.fallthroughId)
-			printf("goto %d\n", bb.fallthroughId);
+		if (bb.fallthroughId) {
+			out->append("goto ");
+			out->appendNumber(bb.fallthroughId);
+			out->append('\n');
+		}
 	}
-	void SSATransformToC::resolveArgs(SSAExpression& expr, const char* delimiter) {
-		printf("(");
+	void SSATransformToC::expandArgs(SSAExpression& expr, const char* delimiter) {
+		text("(");
 		for (size_t i = 0; i < expr.subExpressions.size(); i++) {
 			SSAArgument& arg = expr.subExpressions[i];
-			resolveArg(arg);
+			argument(arg);
 			if(i + 1 != expr.subExpressions.size())
-				printf("%s", delimiter);
+				text(delimiter);
 		}
-		printf(")");
+		text(")");
 	}
-	void SSATransformToC::resolveArg(SSAArgument& arg) {
+	void SSATransformToC::expandArg(SSAArgument& arg) {
 
 		switch (arg.type) {
 		case SSAArgType::eUndef:
-			printf("undef");
+			text("undef");
 			break;
 		case SSAArgType::eSInt:
-			printf("%d", arg.sval);
+			signedNumber(arg.sval);
 			break;
 		case SSAArgType::eUInt:
-			printf("%u", arg.uval);
+			number(arg.uval);
 			break;
 		case SSAArgType::eFloat:
-			printf("%f", arg.fval);
+			floatNumber(arg.fval);
 			break;
 		case SSAArgType::eId: {
 			SSAExpression& subExpr = function->ssaRep.expressions[arg.ssaId];
 			bool nonZeroOffset = (arg.offset != 0), nonFullSize = (arg.offset + arg.size != subExpr.size);
 			if (nonFullSize) {
-				printf("(");
-				if (subExpr.exprtype == SSAType::eFloat)
-					printf("(float_%d) ", arg.size);
-				else if (subExpr.exprtype == SSAType::eUInt)
-					printf("(uint%d_t) ", arg.size);
-				else if (subExpr.exprtype == SSAType::eInt)
-					printf("(int%d_t) ", arg.size);
+				text("(");
+				if (subExpr.exprtype == SSAType::eFloat) {
+					text("(float_");
+					number(arg.size);
+					text(") ");
+				}
+				else if (subExpr.exprtype == SSAType::eUInt) {
+					text("(uint");
+					number(arg.size);
+					text("_t) ");
+				}
+				else if (subExpr.exprtype == SSAType::eInt) {
+					text("(int");
+					number(arg.size);
+					text("_t) ");
+				}
 			}
 			if (nonZeroOffset)
-				printf("(");
-			if (resolveIds.find(arg.ssaId) == resolveIds.end()) {
+				text("(");
+			if (!resolveIds.contains(arg.ssaId)) {
 				if(subExpr.type != SSAExprType::eInput)
-					printf("(");
-				resolveExpression(subExpr);
+					text("(");
+				expression(subExpr);
 				if (subExpr.type != SSAExprType::eInput)
-					printf(")");
+					text(")");
 			}
 			else {
-				printf("var%d", arg.ssaId);
+				text("var");
+				number(arg.ssaId);
+			}
+			if (nonZeroOffset) {
+				text(" >> ");
+				number(arg.offset);
+				text(")");
 			}
-			if (nonZeroOffset)
-				printf(" >> %d)", arg.offset);
 			if (nonFullSize)
-				printf(")");
+				text(")");
 		}break;
 		case SSAArgType::eOther:
 			break;
 		}
 	}
-	void SSATransformToC::resolveExpression(SSAExpression& expr) {
+	void SSATransformToC::expandExpression(SSAExpression& expr) {
 		switch (expr.type) {
 		case SSAExprType::eInvalid:
 			break;
 		case SSAExprType::eLabel:
 			break;
 		case SSAExprType::eUndef:
-			printf("undef ");
+			text("undef ");
 			break;
 		case SSAExprType::eNop:
 			break;
 		case SSAExprType::eOp: {
 			for (size_t i = 0; i < expr.subExpressions.size(); ++i) {
 				SSAArgument& arg = expr.subExpressions[i];
-				resolveArg(arg);
+				argument(arg);
 				if (i + 1 != expr.subExpressions.size()) {
 					switch (expr.opType) {
 					case SSAOpType::eMul:
-						printf(" * ");
+						text(" * ");
 						break;
 					case SSAOpType::eDiv:
-						printf(" / ");
+						text(" / ");
 						break;
 					case SSAOpType::eSub:
-						printf(" - ");
+						text(" - ");
 						break;
 					case SSAOpType::eAdd:
-						printf(" + ");
+						text(" + ");
 						break;
 					case SSAOpType::eAnd:
-						printf(" && ");
+						text(" && ");
 						break;
 					case SSAOpType::eOr:
-						printf(" || ");
+						text(" || ");
 						break;
 					case SSAOpType::eEq:
-						printf(" == ");
+						text(" == ");
 						break;
 					case SSAOpType::eNe:
-						printf(" != ");
+						text(" != ");
 						break;
 					case SSAOpType::eLe:
-						printf(" <= ");
+						text(" <= ");
 						break;
 					case SSAOpType::eLower:
-						printf(" < ");
+						text(" < ");
 						break;
 					case SSAOpType::eGe:
-						printf(" >= ");
+						text(" >= ");
 						break;
 					case SSAOpType::eGreater:
-						printf(" > ");
+						text(" > ");
 						break;
 					default:
-						printf(" op ");
+						text(" op ");
 					}
 				}
 			}
 		}break;
 		case SSAExprType::eLoadAddr:
-			printf("[");
-			resolveArg(expr.subExpressions[1]);
-			printf("+");
-			resolveArg(expr.subExpressions[2]);
-			printf("*");
-			resolveArg(expr.subExpressions[3]);
-			printf("+");
-			resolveArg(expr.subExpressions[4]);
-			printf("]");
+			text("[");
+			argument(expr.subExpressions[1]);
+			text("+");
+			argument(expr.subExpressions[2]);
+			text("*");
+			argument(expr.subExpressions[3]);
+			text("+");
+			argument(expr.subExpressions[4]);
+			text("]");
 			break;
 		case SSAExprType::eFlag:
-			printf("Flag-");
+			text("Flag-");
 			switch (expr.flagType) {
 			case SSAFlagType::eC:
-				printf("Carry");
+				text("Carry");
 				break;
 			case SSAFlagType::eO:
-				printf("Overflow");
+				text("Overflow");
 				break;
 			case SSAFlagType::eU:
-				printf("Underflow");
+				text("Underflow");
 				break;
 			}
-			printf("(");
-			resolveArg(expr.subExpressions[0]);
-			printf(")");
+			text("(");
+			argument(expr.subExpressions[0]);
+			text(")");
 			break;
 		case SSAExprType::eBuiltin:{
-			printf("%s ", arch->getBuiltin(expr.builtinId)->name.cstr());
-			resolveArgs(expr);
+			text(arch->getBuiltin(expr.builtinId)->name.cstr());
+			text(" ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eExtend: {
-			if (expr.exprtype == SSAType::eFloat)
-				printf("(float_%d)", expr.size);
-			else if (expr.exprtype == SSAType::eInt)
-				printf("(int%d_t)", expr.size);
-			else if (expr.exprtype == SSAType::eUInt)
-				printf("(uint%d_t)", expr.size);
+			if (expr.exprtype == SSAType::eFloat) {
+				text("(float_");
+				number(expr.size);
+				text(")");
+			}
+			else if (expr.exprtype == SSAType::eInt) {
+				text("(int");
+				number(expr.size);
+				text("_t)");
+			}
+			else if (expr.exprtype == SSAType::eUInt) {
+				text("(uint");
+				number(expr.size);
+				text("_t)");
+			}
 			else
-				printf("extend%d", expr.size);
-			resolveArgs(expr);
+				{
+				text("extend");
+				number(expr.size);
+			}
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eUpdatePart: {
-			printf("UpdatePart");
+			text("UpdatePart");
 		}break;
 		case SSAExprType::eAppend: {
-			printf("(");
+			text("(");
 			uint32_t offset = 0;
 			for (size_t i = 0; i < expr.subExpressions.size(); i++) {
 				SSAArgument& arg = expr.subExpressions[i];
-				resolveArg(arg);
-				if(offset)
-					printf(" << %d", offset);
+				argument(arg);
+				if(offset) {
+					text(" << ");
+					number(offset);
+				}
 				offset += arg.size;
 				if (i + 1 != expr.subExpressions.size())
-					printf(" | ");
+					text(" | ");
 			}
-			printf(")");
+			text(")");
 		}break;
 		case SSAExprType::eCast: {
 			if (expr.exprtype == SSAType::eFloat)
-				printf("F");
+				text("F");
 			else if (expr.exprtype == SSAType::eInt)
-				printf("S");
+				text("S");
 			else if (expr.exprtype == SSAType::eUInt)
-				printf("U");
-			printf("Cast%d ");
-			resolveArgs(expr);
+				text("U");
+			text("Cast");
+			number(expr.size);
+			text(" ");
+			expandArgs(expr);
 		}break;
 
 		case SSAExprType::eInput:
 			for (CArgument& arg : arguments) {
 				if (arg.ssaId == expr.id) {
-					printf("arg%d", arg.id);
+					text("arg");
+					number(arg.id);
 				}
 			}
 			break;
@@ -228,103 +271,153 @@ namespace holodec{
 			break;
 
 		case SSAExprType::eCall: {
-			printf("Call ");
-			resolveArgs(expr);
+			text("Call ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eReturn: {
-			printf("Return ");
-			printf("(");
+			text("Return ");
+			text("(");
 			for (size_t i = 0; i < expr.subExpressions.size(); i++) {
 				SSAArgument& arg = expr.subExpressions[i];
 				if (arg.location == SSALocation::eReg) {
-					printf("%s: ", arch->getRegister(arg.locref.refId)->name.cstr());
+					text(arch->getRegister(arg.locref.refId)->name.cstr());
+					text(": ");
 				}
-				resolveArg(arg);
+				argument(arg);
 				if (i + 1 != expr.subExpressions.size())
-					printf(", ");
+					text(", ");
 			}
-			printf(")");
+			text(")");
 		}break;
 		case SSAExprType::eSyscall: {
-			printf("Syscall ");
-			resolveArgs(expr);
+			text("Syscall ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eTrap: {
-			printf("Trap ");
-			resolveArgs(expr);
+			text("Trap ");
+			expandArgs(expr);
 		}break;
 
 		case SSAExprType::ePhi: {
-			printf("Phi ");
-			resolveArgs(expr);
+			text("Phi ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eAssign: {
-			resolveArg(expr.subExpressions[0]);
+			argument(expr.subExpressions[0]);
 		}break;
 
 		case SSAExprType::eJmp: {
-			printf("Jmp ");
-			resolveArgs(expr);
+			text("Jmp ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eCJmp: {
-			printf("CJmp ");
-			resolveArgs(expr);
+			text("CJmp ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eMultiBranch:
-			printf("Multibranch");
+			text("Multibranch");
 			break;
 		case SSAExprType::eMemAccess: {
-			printf("MemAccess ");
-			resolveArgs(expr);
+			text("MemAccess ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::ePush: {
-			printf("Push ");
-			resolveArgs(expr);
+			text("Push ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::ePop: {
-			printf("Pop ");
-			resolveArgs(expr);
+			text("Pop ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eStore: {
-			printf("Store ");
-			resolveArgs(expr);
+			text("Store ");
+			expandArgs(expr);
 		}break;
 		case SSAExprType::eLoad: {
-			printf("Load ");
-			resolveArgs(expr);
+			text("Load ");
+			expandArgs(expr);
 		}break;
 		}
 	}
+	void SSATransformToC::resolve(CToken token) {
+		switch (token.type) {
+		case CTokenType::eText:
+			out->append(token.text);
+			return;
+		case CTokenType::eSInt:
+			out->appendNumber(token.sval);
+			return;
+		case CTokenType::eUInt:
+			out->appendNumber(token.uval);
+			return;
+		case CTokenType::eFloat:
+			out->appendFloat(token.fval);
+			return;
+		case CTokenType::eArg:
+			expandArg(*token.arg);
+			break;
+		case CTokenType::eExpr:
+			expandExpression(*token.expr);
+			break;
+		}
+		stack.insert(stack.end(), expansion.rbegin(), expansion.rend());
+		expansion.clear();
+	}
+	void SSATransformToC::resolveExpression(SSAExpression& expr) {
+		size_t base = stack.size();
+		expandExpression(expr);
+		stack.insert(stack.end(), expansion.rbegin(), expansion.rend());
+		expansion.clear();
+		while (stack.size() > base) {
+			CToken token = stack.back();
+			stack.pop_back();
+			resolve(token);
+		}
+	}
 	void SSATransformToC::printExpression(SSAExpression& expr) {
 		resolveIds.insert(expr.id);
-		printIndent(1);
-		printf("var%d = ", expr.id);
+		out->appendIndent(1);
+		out->append("var");
+		out->appendNumber(expr.id);
+		out->append(" = ");
 		resolveExpression(expr);
-		puts("");
+		out->append('\n');
 	}
 
 	bool SSATransformToC::doTransformation (Binary* binary, Function* function){
-		printf("Transform To C\n");
-
+		HStringBuilder text;
+		render(binary, function, &text);
+		text.write(stdout);
+		return false;
+	}
+	void SSATransformToC::render (Binary* binary, Function* function, HStringBuilder* out){
+		HPROFILE_SCOPE ("TransformToC", "addr", function->baseaddr);
 		this->binary = binary;
 		this->function = function;
+		this->out = out;
+		out->append("Transform To C\n");
 
 		//function->print(binary->arch);
 		Symbol *sym = binary->getSymbol(function->symbolref);
 
 		arguments.clear();
 		resolveIds.clear();
-		printf("Function: %s\n", sym->name.cstr());
-		printf("Calling Functions: ");
+		resolveIds.resize(function->ssaRep.expressions.size());
+		out->append("Function: ");
+		out->append(sym->name.cstr());
+		out->append("\nCalling Functions: ");
 		for (uint64_t addr : function->funcsCall) {
-			printf("0x%x ", addr);
+			out->append("0x");
+			out->appendNumber(addr, 16);
+			out->append(' ');
 		}
-		printf("\n");
-		printf("CalledFunctions: ");
+		out->append("\nCalledFunctions: ");
 		for (uint64_t addr : function->funcsCalled) {
-			printf("0x%x ", addr);
+			out->append("0x");
+			out->appendNumber(addr, 16);
+			out->append(' ');
 		}
-		printf("\n");
+		out->append('\n');
 		{
 			SSABB& bb = function->ssaRep.bbs[1];
 			for (HId id : bb.exprIds) {
@@ -336,12 +429,16 @@ namespace holodec{
 					}
 				}
 			}
-			printIndent(1);
-			printf("Input (");
-			for (CArgument arg : arguments) {
-				printf("arg%d: %s ", arg.id, arg.regRef.name.cstr());
+			out->appendIndent(1);
+			out->append("Input (");
+			for (CArgument& arg : arguments) {
+				out->append("arg");
+				out->appendNumber(arg.id);
+				out->append(": ");
+				out->append(arg.regRef.name.cstr());
+				out->append(' ');
 			}
-			puts(")\n");
+			out->append(")\n\n");
 			for (HId id = 2; id < function->ssaRep.bbs.size(); ++id) {
 				SSABB& bb = function->ssaRep.bbs[id];
 				for (HId id : bb.exprIds) {
@@ -362,7 +459,64 @@ namespace holodec{
 		for (size_t index = 1; index < function->ssaRep.bbs.list.size(); ++index) {
 			printBasicBlock(function->ssaRep.bbs.list[index]);
 		}
-		return false;
+		this->out = nullptr;
 	}
-}
 
+	SSACEmitter::SSACEmitter (Binary* binary, uint32_t threadCount) : binary (binary), threadStats (threadCount) {
+		for (uint32_t i = 0; i < threadCount; i++) {
+			SSATransformToC* transformer = new SSATransformToC();
+			transformer->arch = binary->arch;
+			transformers.push_back (transformer);
+		}
+	}
+	SSACEmitter::~SSACEmitter() {
+		for (SSATransformToC* transformer : transformers)
+			delete transformer;
+	}
+
+	JobFuture<CFunctionText*> SSACEmitter::queue (JobController* jobController, Function* function, const std::vector<JobHandle>& dependencies, JobGroup* group) {
+		//the entry is created here, the task only writes to its own entry
+		CFunctionText* text = &texts[function];
+		return jobController->async ([this, function, text] (JobContext context) {
+			CEmitStats& stats = threadStats[context.threadId];
+			auto start = std::chrono::steady_clock::now();
+			function->ssaRep.compress();
+			if (text->version == function->ssaRep.version && text->idVersion == function->ssaRep.idVersion) {
+				stats.cachedCount++;
+				return text;
+			}
+			text->text.clear();
+			transformers[context.threadId]->render (binary, function, &text->text);
+			text->version = function->ssaRep.version;
+			text->idVersion = function->ssaRep.idVersion;
+			stats.renderedCount++;
+			stats.renderedBytes += text->text.size();
+			stats.time += std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+			return text;
+		}, dependencies, group);
+	}
+	void SSACEmitter::render (JobController* jobController, HList<Function*>& functions) {
+		JobGroup group;
+		for (Function* function : functions)
+			queue (jobController, function, {}, &group);
+		jobController->wait (&group);
+	}
+	void SSACEmitter::write (Function* function, FILE* file) {
+		auto it = texts.find (function);
+		assert (it != texts.end());
+		it->second.text.write (file);
+	}
+
+	void SSACEmitter::printStats() {
+		CEmitStats total;
+		for (CEmitStats& stats : threadStats) {
+			total.renderedCount += stats.renderedCount;
+			total.cachedCount += stats.cachedCount;
+			total.renderedBytes += stats.renderedBytes;
+			total.time += stats.time;
+		}
+		printf ("C Emission\n");
+		printIndent (1);
+		printf ("Rendered: %" PRIu64 " Cached: %" PRIu64 " Bytes: %" PRIu64 " Time: %8.3f ms\n", total.renderedCount, total.cachedCount, total.renderedBytes, total.time * 1000.0);
+	}
+}
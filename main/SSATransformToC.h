@@ -2,6 +2,8 @@
 #define SSATRANSFORMTOC_H
 
 #include "SSATransformer.h"
+#include "HStringBuilder.h"
+#include "JobController.h"
 namespace holodec {
 
 	struct CArgument {
@@ -10,23 +12,129 @@ namespace holodec {
 		StringRef regRef;
 	};
 
+	enum class CTokenType {
+		eText,
+		eSInt,
+		eUInt,
+		eFloat,
+		eArg,//expanded into further tokens
+		eExpr,//expanded into further tokens
+	};
+	//a piece of the output of an expression
+	struct CToken {
+		CTokenType type;
+		union {
+			const char* text;
+			int64_t sval;
+			uint64_t uval;
+			double fval;
+			SSAArgument* arg;
+			SSAExpression* expr;
+		};
+	};
+
+	//renders a function into the string builder
+	//nested expressions are resolved with an explicit stack so deep expression trees can not overflow the call stack
 	struct SSATransformToC : public SSATransformer {
 
 		Binary* binary;
 		Function* function;
-		HSet<HId> resolveIds;
+		HIdBitSet resolveIds;
 		HIdList<CArgument> arguments;
+		HStringBuilder* out = nullptr;
+		HList<CToken> stack;//tokens that still have to be written, the next one at the back
+		HList<CToken> expansion;//tokens of the argument or expression that is expanded, in output order
 
+		//writes the function to stdout
 		virtual bool doTransformation (Binary* binary, Function* function);
+		void render (Binary* binary, Function* function, HStringBuilder* out);
 
 		void printBasicBlock(SSABB& bb);
 		void printExpression(SSAExpression& expression);
-		void resolveArgs(SSAExpression& expression, const char* delimiter = ", ");
-		void resolveArg(SSAArgument& arg);
 		void resolveExpression(SSAExpression& expression);
 		bool shouldResolve(SSAExpression& expr);
 
 		bool shouldResolve(HId id);
+
+	private:
+		void resolve (CToken token);
+		//append the tokens of one level to the expansion
+		void expandArgs(SSAExpression& expression, const char* delimiter = ", ");
+		void expandArg(SSAArgument& arg);
+		void expandExpression(SSAExpression& expression);
+
+		void text (const char* str) {
+			CToken token;
+			token.type = CTokenType::eText;
+			token.text = str;
+			expansion.push_back (token);
+		}
+		void signedNumber (int64_t value) {
+			CToken token;
+			token.type = CTokenType::eSInt;
+			token.sval = value;
+			expansion.push_back (token);
+		}
+		void number (uint64_t value) {
+			CToken token;
+			token.type = CTokenType::eUInt;
+			token.uval = value;
+			expansion.push_back (token);
+		}
+		void floatNumber (double value) {
+			CToken token;
+			token.type = CTokenType::eFloat;
+			token.fval = value;
+			expansion.push_back (token);
+		}
+		void argument (SSAArgument& arg) {
+			CToken token;
+			token.type = CTokenType::eArg;
+			token.arg = &arg;
+			expansion.push_back (token);
+		}
+		void expression (SSAExpression& expr) {
+			CToken token;
+			token.type = CTokenType::eExpr;
+			token.expr = &expr;
+			expansion.push_back (token);
+		}
+	};
+
+	struct CFunctionText {
+		uint64_t version = 0;//version of the SSARepresentation the text was rendered from, 0 if never rendered
+		uint64_t idVersion = 0;
+		HStringBuilder text;
+	};
+
+	struct CEmitStats {
+		uint64_t renderedCount = 0;
+		uint64_t cachedCount = 0;
+		uint64_t renderedBytes = 0;
+		double time = 0.0;//seconds spent in the render jobs
+	};
+
+	//renders functions into C on the job threads with one SSATransformToC per thread
+	//the text of a function is kept until its SSARepresentation changes, so functions that did not change are not rendered again
+	struct SSACEmitter {
+		Binary* binary;
+		HList<SSATransformToC*> transformers;//indexed by the thread id
+		HList<CEmitStats> threadStats;//indexed by the thread id
+		HMap<Function*, CFunctionText> texts;
+
+		SSACEmitter (Binary* binary, uint32_t threadCount);
+		~SSACEmitter();
+
+		//queues a task that compresses the function and renders it if it changed since it was last rendered
+		//the function must not change until the task is finished
+		//has to be called from one thread only
+		JobFuture<CFunctionText*> queue (JobController* jobController, Function* function, const std::vector<JobHandle>& dependencies = {}, JobGroup* group = nullptr);
+		//queues all functions and waits for them
+		void render (JobController* jobController, HList<Function*>& functions);
+		//writes the text of a rendered function
+		void write (Function* function, FILE* file);
+
+		void printStats();
 	};
 
 }
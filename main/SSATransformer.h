@@ -14,6 +14,8 @@ namespace holodec {
 	struct SSATransformer {
 		Architecture* arch;
 
+		virtual ~SSATransformer() = default;
+
 		virtual bool doTransformation (Binary* binary, Function* function) = 0;
 	};
 
@@ -0,0 +1,215 @@
+#include "SyntheticFunction.h"
+#include "Function.h"
+#include "Architecture.h"
+
+namespace holodec {
+
+	SyntheticFunctionGenerator::SyntheticFunctionGenerator (Architecture* arch, SyntheticFunctionConfig config) : arch (arch), config (config), random (config.seed) {
+		//all registers have the size of the first one so the operations do not need extends
+		for (Register& reg : arch->registers) {
+			if (registers.size() >= config.registers)
+				break;
+			if (!reg.id || reg.directParentRef || reg.type != RegType::eGPR)
+				continue;
+			if (registers.empty() || registers[0]->size == reg.size)
+				registers.push_back (&reg);
+		}
+		if (!this->config.instructions)
+			this->config.instructions = 1;
+	}
+
+	bool SyntheticFunctionGenerator::generate (Function* function) {
+		if (registers.empty())
+			return false;
+		blocks.clear();
+		if (config.blocks > 1)
+			generateRegion (0, config.blocks - 1);
+		addBlock (Exit::eReturn);
+		lift (function);
+		return true;
+	}
+
+	uint32_t SyntheticFunctionGenerator::addBlock (Exit exit) {
+		blocks.push_back ({exit, {}});
+		return (uint32_t) blocks.size() - 1;
+	}
+
+	//adds exactly count blocks
+	void SyntheticFunctionGenerator::generateRegion (uint32_t depth, uint32_t count) {
+		while (count) {
+			uint32_t choice = random() % 8;
+			uint32_t switchSize = 2 * config.switchFanout + 2;
+			uint32_t size;
+			//the constructs take at most half of the remaining blocks unless they need more
+			auto pickSize = [this, count] (uint32_t minSize) {
+				uint32_t maxSize = std::max (minSize, count / 2);
+				return minSize + random() % (maxSize - minSize + 1);
+			};
+			if (choice < 2 && depth < config.loopDepth && count >= 3) {
+				size = pickSize (3);
+				generateLoop (depth, size);
+			} else if (choice == 2 && config.switchFanout && count >= switchSize) {
+				size = pickSize (switchSize);
+				generateSwitch (depth, size);
+			} else if (choice < 6 && count >= 3) {
+				size = pickSize (3);
+				generateIfElse (depth, size);
+			} else {
+				size = 1;
+				addBlock (Exit::eFallthrough);
+			}
+			count -= size;
+		}
+	}
+	void SyntheticFunctionGenerator::generateIfElse (uint32_t depth, uint32_t count) {
+		uint32_t condition = addBlock (Exit::eBranch);
+		uint32_t rest = count - 3;
+		uint32_t thenCount = random() % (rest + 1);
+		generateRegion (depth, thenCount);
+		uint32_t thenEnd = addBlock (Exit::eJump);
+		uint32_t elseStart = (uint32_t) blocks.size();
+		generateRegion (depth, rest - thenCount);
+		uint32_t join = addBlock (Exit::eFallthrough);
+		blocks[condition].targets = {elseStart};
+		blocks[thenEnd].targets = {join};
+	}
+	//the header leaves the loop, the body falls through to the latch which jumps back to the header
+	void SyntheticFunctionGenerator::generateLoop (uint32_t depth, uint32_t count) {
+		uint32_t header = addBlock (Exit::eBranch);
+		generateRegion (depth + 1, count - 3);
+		uint32_t latch = addBlock (Exit::eJump);
+		uint32_t exit = addBlock (Exit::eFallthrough);
+		blocks[header].targets = {exit};
+		blocks[latch].targets = {header};
+	}
+	//the switch falls through to the first case, every case jumps to the join block
+	void SyntheticFunctionGenerator::generateSwitch (uint32_t depth, uint32_t count) {
+		uint32_t fanout = config.switchFanout;
+		uint32_t switchBlock = addBlock (Exit::eSwitch);
+		uint32_t rest = count - 2 - fanout;
+		HList<uint32_t> caseStarts;
+		HList<uint32_t> caseEnds;
+		for (uint32_t i = 0; i < fanout; i++) {
+			uint32_t caseCount = i + 1 == fanout ? rest : random() % (rest / (fanout - i) * 2 + 1);
+			caseCount = std::min (caseCount, rest);
+			rest -= caseCount;
+			caseStarts.push_back ((uint32_t) blocks.size());
+			generateRegion (depth, caseCount);
+			caseEnds.push_back (addBlock (Exit::eJump));
+		}
+		uint32_t join = addBlock (Exit::eFallthrough);
+		blocks[switchBlock].targets = caseStarts;
+		for (uint32_t caseEnd : caseEnds)
+			blocks[caseEnd].targets = {join};
+	}
+
+	void SyntheticFunctionGenerator::lift (Function* function) {
+		static const SSAOpType opTypes[] = {SSAOpType::eAdd, SSAOpType::eSub, SSAOpType::eBAnd, SSAOpType::eBOr, SSAOpType::eBXor};
+		const uint64_t instrSize = 2;
+		uint64_t blockSize = config.instructions * instrSize;
+		SSARepresentation& ssaRep = function->ssaRep;
+		ssaRep.clear();
+		for (size_t i = 0; i < blocks.size(); i++) {
+			SSABB bb;
+			bb.startaddr = function->baseaddr + i * blockSize;
+			bb.endaddr = bb.startaddr + blockSize;
+			ssaRep.bbs.push_back (bb);
+		}
+		auto pickRegister = [this] () {
+			return registers[random() % registers.size()];
+		};
+		auto blockAddr = [function, blockSize] (uint32_t index) {
+			return function->baseaddr + index * blockSize;
+		};
+		for (size_t i = 0; i < blocks.size(); i++) {
+			SSABB* bb = &ssaRep.bbs.list[i];
+			if (i == 0) {
+				for (Register& reg : arch->registers) {
+					if (!reg.id || reg.directParentRef)
+						continue;
+					SSAExpression expression;
+					expression.type = SSAExprType::eInput;
+					expression.exprtype = SSAType::eUInt;
+					expression.instrAddr = function->baseaddr;
+					expression.location = SSALocation::eReg;
+					expression.locref = {reg.id, 0};
+					expression.size = reg.size;
+					ssaRep.addAtEnd (&expression, bb);
+				}
+			}
+			uint64_t addr = bb->startaddr;
+			for (uint32_t j = 0; j < config.instructions; j++, addr += instrSize) {
+				SSAExpression label;
+				label.type = SSAExprType::eLabel;
+				label.exprtype = SSAType::ePc;
+				label.size = arch->bitbase;
+				label.instrAddr = addr;
+				label.subExpressions.push_back (SSAArgument::createUVal (addr, arch->bitbase));
+				ssaRep.addAtEnd (&label, bb);
+
+				Register* dst = pickRegister();
+				SSAExpression expression;
+				expression.type = SSAExprType::eOp;
+				expression.opType = opTypes[random() % (sizeof (opTypes) / sizeof (opTypes[0]))];
+				expression.exprtype = SSAType::eUInt;
+				expression.size = dst->size;
+				expression.location = SSALocation::eReg;
+				expression.locref = {dst->id, 0};
+				expression.instrAddr = addr;
+				expression.subExpressions.push_back (SSAArgument::createReg (pickRegister()));
+				if (random() % 4)
+					expression.subExpressions.push_back (SSAArgument::createReg (pickRegister()));
+				else
+					expression.subExpressions.push_back (SSAArgument::createUVal (random() % 256, dst->size));
+				ssaRep.addAtEnd (&expression, bb);
+			}
+			addr -= instrSize;//the exit belongs to the last instruction
+
+			Block& block = blocks[i];
+			SSAExpression expression;
+			expression.exprtype = SSAType::ePc;
+			expression.size = arch->bitbase;
+			expression.instrAddr = addr;
+			switch (block.exit) {
+			case Exit::eFallthrough:
+				continue;
+			case Exit::eJump:
+				expression.type = SSAExprType::eJmp;
+				expression.subExpressions.push_back (SSAArgument::createUVal (blockAddr (block.targets[0]), arch->bitbase));
+				break;
+			case Exit::eBranch: {
+				SSAExpression condition;
+				condition.type = SSAExprType::eOp;
+				condition.opType = random() % 2 ? SSAOpType::eNe : SSAOpType::eLower;
+				condition.exprtype = SSAType::eUInt;
+				condition.size = 1;
+				condition.instrAddr = addr;
+				condition.subExpressions.push_back (SSAArgument::createReg (pickRegister()));
+				condition.subExpressions.push_back (SSAArgument::createReg (pickRegister()));
+				HId conditionId = ssaRep.addAtEnd (&condition, bb);
+				expression.type = SSAExprType::eCJmp;
+				expression.subExpressions.push_back (SSAArgument::createUVal (blockAddr (block.targets[0]), arch->bitbase));
+				expression.subExpressions.push_back (SSAArgument::createId (conditionId, 1));
+			}
+			break;
+			case Exit::eSwitch:
+				expression.type = SSAExprType::eMultiBranch;
+				expression.subExpressions.push_back (SSAArgument::createReg (pickRegister()));
+				for (uint32_t target : block.targets)
+					expression.subExpressions.push_back (SSAArgument::createUVal (blockAddr (target), arch->bitbase));
+				break;
+			case Exit::eReturn:
+				expression.type = SSAExprType::eReturn;
+				expression.subExpressions.push_back (SSAArgument::createUVal (0, arch->bitbase));
+				for (Register& reg : arch->registers) {
+					if (!reg.id || reg.directParentRef)
+						continue;
+					expression.subExpressions.push_back (SSAArgument::createReg (&reg));
+				}
+				break;
+			}
+			ssaRep.addAtEnd (&expression, bb);
+		}
+		ssaRep.invalidateCFG();
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef SYNTHETICFUNCTION_H
+#define SYNTHETICFUNCTION_H
+
+#include "General.h"
+
+#include <random>
+
+namespace holodec {
+
+	struct Architecture;
+	struct Function;
+	struct Register;
+
+	struct SyntheticFunctionConfig {
+		uint32_t blocks = 1024;//number of basic blocks
+		uint32_t instructions = 6;//instructions per block
+		uint32_t registers = 8;//general purpose registers the instructions read and write
+		uint32_t loopDepth = 2;//maximum nesting of loops
+		uint32_t switchFanout = 0;//targets of every switch, 0 for no switches
+		uint32_t seed = 1;
+	};
+
+	//builds structured control flow out of straight blocks, if/else, loops and switches
+	//the ssa is created in the form the lifting produces, the registers are not resolved and the jumps
+	//target addresses, so the function has to go through AddressToBlock and PhiNodeGenerator like a lifted one
+	struct SyntheticFunctionGenerator {
+		enum class Exit {
+			eFallthrough,
+			eJump,
+			eBranch,//conditional jump to the target or fall through to the next block
+			eSwitch,//multibranch to the targets or fall through to the next block
+			eReturn,
+		};
+		struct Block {
+			Exit exit;
+			HList<uint32_t> targets;//indices of the target blocks
+		};
+
+		Architecture* arch;
+		SyntheticFunctionConfig config;
+		std::mt19937 random;
+		HList<Register*> registers;
+		HList<Block> blocks;
+
+		SyntheticFunctionGenerator (Architecture* arch, SyntheticFunctionConfig config);
+
+		//returns false if the architecture has no general purpose registers
+		bool generate (Function* function);
+
+	private:
+		uint32_t addBlock (Exit exit);
+		void generateRegion (uint32_t depth, uint32_t count);
+		void generateIfElse (uint32_t depth, uint32_t count);
+		void generateLoop (uint32_t depth, uint32_t count);
+		void generateSwitch (uint32_t depth, uint32_t count);
+		void lift (Function* function);
+	};
+}
+
+#endif // SYNTHETICFUNCTION_H
@@ -1,6 +1,7 @@
 
 #include "AvrFunctionAnalyzer.h"
 #include "../Binary.h"
+#include "../HoloIO.h"
 
 namespace holoavr{
 
@@ -758,19 +759,19 @@ namespace holoavr{
 			instr->instrdef = arch->getInstrDef(AVR_INSTR_WDR);
 			return true;
 		}
-		printf("Cannot disassemble Instruction 0x%x,\n", firstbytes);
+		HLOG_WARN (g_analyzer_logger, "Cannot disassemble Instruction 0x%x", firstbytes);
 		return false;
 	}
 
 	bool AVRFunctionAnalyzer::analyzeInsts(size_t addr) {
-		printf("Disassembling at position 0x%x\n", addr);
+		HLOG_TRACE (g_analyzer_logger, "Disassembling at position 0x%zx", addr);
 
 
 		do {
 			Instruction instruction;
 
 			if (!parseInstruction(&instruction, binary, addr, arch)) {
-				printf("Cannot disassemble at Addr 0x%x,\n", addr);
+				HLOG_WARN (g_analyzer_logger, "Cannot disassemble at Addr 0x%zx", addr);
 				return false;
 			}
 
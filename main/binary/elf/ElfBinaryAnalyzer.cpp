@@ -22,7 +22,7 @@ T* getPtrInFile(File* file, uint64_t addr) {
 }
 //TODO byte order!!!
 template<typename T>
-const T& getValue(File* file, uint64_t addr, Endianess endianess) {
+T getValue(File* file, uint64_t addr, Endianess endianess) {
 	uint8_t buffer[sizeof(T)];
 	switch (endianess) {
 	case Endianess::eBig: {
@@ -32,7 +32,7 @@ const T& getValue(File* file, uint64_t addr, Endianess endianess) {
 	}break;
 	case Endianess::eLittle: {
 		for (int i = 1; i <= sizeof(T); i++) {
-			buffer[i] = file->data[addr + sizeof(T) - i];
+			buffer[i - 1] = file->data[addr + sizeof(T) - i];
 		}
 	}break;
 	}
@@ -509,7 +509,7 @@ bool holoelf::ElfBinaryAnalyzer::parseSectionHeaderTable() {
 			continue;
 		binary->addSection(section);
 	}
-#if !defined(__GNUC__) || !defined(__MINGW32__)
+#if !defined(__GNUC__) && !defined(__MINGW32__)
 	delete[]sections;
 	delete[]nameoffset;
 #endif
@@ -16,6 +16,11 @@
 #include "SSACallingConvApplier.h"
 #include "SSAAssignmentSimplifier.h"
 #include "SSADCETransformer.h"
+#include "SSAConstPropagation.h"
+#include "SSAGlobalValueNumbering.h"
+#include "SSAPassManager.h"
+#include "CallGraph.h"
+#include "SSARegStateSolver.h"
 #include "HIdList.h"
 #include "SSAPeepholeOptimizer.h"
 #include "SSATransformToC.h"
@@ -25,6 +30,8 @@
 
 #include "CHolodec.h"
 #include "JobController.h"
+#include "Profiler.h"
+#include "MemoryAccounting.h"
 
 #include <thread>
 
@@ -81,13 +88,6 @@ FileFormat ihexfileformat = { "ihex", "ihex",{
 extern Architecture holox86::x86architecture;
 
 
-holodec::JobController jc;
-
-void job_thread (uint32_t id) {
-	printf ("Job-Thread %d Starting\n", id);
-	jc.start_job_loop ({id});
-	printf ("Job-Thread %d Exiting\n", id);
-}
 #include <clang-c/Index.h>  // This is libclang.
 
 void parseCXType(CXType type) {
@@ -323,22 +323,6 @@ int main (int argc, const char** argv) {
 	 
 	g_logger.log<LogLevel::eInfo> ("Init X86\n");
 
-	std::vector<std::thread*> threads;
-	for (int i = 0; i < 10; i++) {
-		threads.push_back (new std::thread (job_thread, i));
-	}
-
-
-	jc.wait_for_finish();
-
-	jc.wait_for_exit();
-
-	g_logger.log<LogLevel::eInfo> ("Jobs %d\n", jc.jobs.size());
-
-	for (auto it = threads.begin(); it != threads.end(); ++it) {
-		(*it)->join();
-		delete *it;
-	}
 	if (argc < 2) {
 		g_logger.log<LogLevel::eWarn>("No parameters given\n");
 		return -1;
@@ -347,11 +331,22 @@ int main (int argc, const char** argv) {
 	g_logger.log<LogLevel::eInfo>("Analysing file %s\n", argv[1]);
 	HString filename = argv[1];
 	Main::initMain();
+	//HOLODEC_TRACE=<file> records the hot-path counters and timed scopes and writes them as Chrome trace events
+	const char* traceFile = getenv("HOLODEC_TRACE");
+	if (traceFile)
+		Profiler::get().enable();
+	//HOLODEC_MEMORY reports the resident set size after every stage and the memory of the binary and its functions
+	bool memoryReport = getenv("HOLODEC_MEMORY") != nullptr;
+	MemoryTracker memory;
+	if (memoryReport)
+		memory.record("init");
 	File* file = Main::loadDataFromFile (filename);
 	if (!file) {
 		g_logger.log<LogLevel::eWarn> ("Could not Load File %s\n", filename.cstr());
 		return -1;
 	}
+	if (memoryReport)
+		memory.record("load");
 
 	Main::g_main->registerFileFormat (&elffileformat);
 	Main::g_main->registerArchitecture (&holox86::x86architecture);
@@ -375,6 +370,8 @@ int main (int argc, const char** argv) {
 	}
 	analyzer->init (file);
 	Binary* binary = analyzer->binary;
+	if (memoryReport)
+		memory.record("parse", binary);
 
 	for(Section* section : binary->sections){
 		section->print();
@@ -399,15 +396,19 @@ int main (int argc, const char** argv) {
 			newfunction->symbolref = sym->id;
 			newfunction->baseaddr = sym->vaddr;
 			newfunction->addrToAnalyze.insert (sym->vaddr);
-			binary->functions.push_back (newfunction);
+			binary->addFunction (newfunction);
 		}
 	}
+	CallGraph callGraph;
+	for (Function* func : binary->functions)
+		callGraph.addFunction (func);
 	bool funcAnalyzed;
 	do {
 		funcAnalyzed = false;
 		for (Function* func : binary->functions) {
 			if (!func->addrToAnalyze.empty()) {
 				func_analyzer->analyzeFunction (func);
+				callGraph.addCalls (func);
 				funcAnalyzed = true;
 				if (!func->funcsCalled.empty()) {
 					for (uint64_t addr : func->funcsCalled) {
@@ -420,7 +421,8 @@ int main (int argc, const char** argv) {
 							newfunction->symbolref = symbol->id;
 							newfunction->baseaddr = symbol->vaddr;
 							newfunction->addrToAnalyze.insert(symbol->vaddr);
-							binary->functions.push_back (newfunction);
+							binary->addFunction (newfunction);
+							callGraph.addFunction (newfunction);
 						}
 					}
 				}
@@ -428,23 +430,12 @@ int main (int argc, const char** argv) {
 			}
 		}
 	} while (funcAnalyzed);
+	func_analyzer->ssaGen.printLiftCacheStats();
+	if (memoryReport)
+		memory.record("decode", binary);
 
 	binary->print();
 
-	std::vector<SSATransformer*> transformers = {
-		new SSAAddressToBlockTransformer(),//0
-		new SSAPhiNodeGenerator(),//1
-		new SSAAssignmentSimplifier(),//2
-		new SSAPeepholeOptimizer(),//3
-		new SSADCETransformer(),//4
-		new SSAApplyRegRef(),//5
-		new SSATransformToC(),//6
-	};
-
-	for (SSATransformer* transform : transformers) {
-		transform->arch = binary->arch;
-	}
-
 	PeepholeOptimizer* optimizer = parsePhOptimizer ();
 
 	g_peephole_logger.level = LogLevel::eDebug;
@@ -458,46 +449,118 @@ int main (int argc, const char** argv) {
 		0x2525,
 		0x2516,
 	};
+	//one job thread per hardware thread unless HOLODEC_THREADS is set
+	JobController jobs;
+	uint32_t threadCount = jobs.threadCount();
+	//the passes keep state so every job thread gets its own instances
+	HList<SSAPassManager*> setupPasses;
+	for (uint32_t i = 0; i < threadCount; i++) {
+		SSAPassManager* passManager = new SSAPassManager(binary);
+		passManager->addPass("AddressToBlock", new SSAAddressToBlockTransformer());
+		passManager->addPass("PhiNodeGenerator", new SSAPhiNodeGenerator());
+		for (SSAPass& pass : passManager->passes)
+			pass.transformer->arch = binary->arch;
+		setupPasses.push_back(passManager);
+	}
+	HList<SSAPassManager*> optimizerPasses;
+	HList<SSAPeepholeOptimizer*> peepholeOptimizers;
+	HList<SSAGlobalValueNumbering*> valueNumberings;
+	for (uint32_t i = 0; i < threadCount; i++) {
+		SSAPassManager* passManager = new SSAPassManager(binary);
+		SSAPeepholeOptimizer* peepholeOptimizer = new SSAPeepholeOptimizer();
+		SSAGlobalValueNumbering* valueNumbering = new SSAGlobalValueNumbering();
+		passManager->addPass("AssignmentSimplifier", new SSAAssignmentSimplifier());
+		passManager->addPass("PeepholeOptimizer", peepholeOptimizer);
+		passManager->addPass("ConstPropagation", new SSAConstPropagation());
+		passManager->addPass("GlobalValueNumbering", valueNumbering);
+		passManager->addPass("DCE", new SSADCETransformer());
+		passManager->addPass("ApplyRegRef", new SSAApplyRegRef(), true);
+		for (SSAPass& pass : passManager->passes)
+			pass.transformer->arch = binary->arch;
+		optimizerPasses.push_back(passManager);
+		peepholeOptimizers.push_back(peepholeOptimizer);
+		valueNumberings.push_back(valueNumbering);
+	}
+
+	HList<Function*> functions;
 	for (uint64_t addr : funcs) {
 		Function* func = binary->getFunctionByAddr(addr);
-		if (func) {
-			transformers[0]->doTransformation(binary, func);
-			transformers[1]->doTransformation(binary, func);
-			assert(func->ssaRep.checkIntegrity());
-			func->ssaRep.recalcRefCounts();
-		}
+		if (func)
+			functions.push_back(func);
 	}
-	bool funcChanged = false;
-	do {
-		printf("---------------------\n");
-		printf("Run Transformations\n");
-		printf("---------------------\n");
-		funcChanged = false;
-		for (uint64_t addr : funcs) {
-			Function* func = binary->getFunctionByAddr(addr);
-			if (func) {
-				bool applied = false;
-				do {
-					applied = false;
-					applied |= transformers[2]->doTransformation(binary, func);
-					func->ssaRep.recalcRefCounts();
-					applied |= transformers[3]->doTransformation(binary, func);
-					applied |= transformers[4]->doTransformation(binary, func);
-					applied |= transformers[5]->doTransformation(binary, func);
-					funcChanged |= applied;
-					//func->print(binary->arch);
-				} while (applied);
-			}
+	printf("---------------------\n");
+	printf("Run Transformations\n");
+	printf("---------------------\n");
+	callGraph.print();
+	callGraph.update();
+	//setup, optimization and emission of different functions overlap, the tasks only wait for what they read
+	JobGroup pipeline;
+	//the setup of a function reads the registers of the functions it calls, so they are set up before it
+	//functions which do not call each other are set up in parallel
+	HMap<Function*, JobHandle> setupTasks;
+	callGraph.queueBottomUp(&jobs, functions, [&setupPasses](HList<Function*>& scc, JobContext context) {
+		for (Function* func : scc) {
+			setupPasses[context.threadId]->run(func);
+			assert(func->ssaRep.checkIntegrity());
 		}
-	} while (funcChanged);
-	for (uint64_t addr : funcs) {
-		Function* func = binary->getFunctionByAddr(addr);
-		if (func) {
-			func->ssaRep.recalcRefCounts();
-			transformers[6]->doTransformation(binary, func);
-			holodec::g_logger.log<LogLevel::eInfo>("Symbol %s", binary->getSymbol(func->symbolref)->name.cstr());
-			func->print(binary->arch);
+	}, {}, &pipeline, &setupTasks);
+	//functions are optimized after their own setup and after their callees so the register states of the callees are final
+	HMap<Function*, JobHandle> optimizeTasks;
+	callGraph.queueBottomUp(&jobs, functions, [&optimizerPasses, &callGraph, binary](HList<Function*>& scc, JobContext context) {
+		//recursive functions start from the smallest register states that are consistent with each other
+		if (callGraph.isRecursive(scc[0])) {
+			SSARegStateSolver solver(binary->arch, binary);
+			solver.solve(scc);
 		}
+		optimizerPasses[context.threadId]->runToFixpoint(scc);
+	}, {}, &pipeline, &optimizeTasks, &setupTasks);
+	//a function is rendered once it is optimized, its callers only read its register states
+	SSACEmitter emitter(binary, threadCount);
+	HList<JobFuture<CFunctionText*>> texts;
+	for (Function* func : functions) {
+		//functions outside of the call graph are neither set up nor optimized
+		auto it = optimizeTasks.find(func);
+		texts.push_back(emitter.queue(&jobs, func, it != optimizeTasks.end() ? std::vector<JobHandle>{it->second} : std::vector<JobHandle>(), &pipeline));
+	}
+	//written in the order of the list while the later functions are still processed
+	for (size_t i = 0; i < functions.size(); i++) {
+		texts[i].get()->text.write(stdout);
+		holodec::g_logger.log<LogLevel::eInfo>("Symbol %s", binary->getSymbol(functions[i]->symbolref)->name.cstr());
+		functions[i]->print(binary->arch);
+	}
+	jobs.wait(&pipeline);
+	jobs.wait_for_exit();
+	if (memoryReport)
+		memory.record("pipeline", binary);
+	//the statistics come after the messages the passes logged
+	flushLogs();
+	for (uint32_t i = 1; i < threadCount; i++) {
+		setupPasses[0]->mergeStats(setupPasses[i]);
+		optimizerPasses[0]->mergeStats(optimizerPasses[i]);
+		peepholeOptimizers[0]->phOpt->ruleSet.mergeStats(&peepholeOptimizers[i]->phOpt->ruleSet);
+		valueNumberings[0]->mergeStats(valueNumberings[i]);
+	}
+	setupPasses[0]->printStats(false);
+	optimizerPasses[0]->printStats();
+	peepholeOptimizers[0]->phOpt->ruleSet.printStats();
+	valueNumberings[0]->printStats();
+	emitter.printStats();
+	jobs.printStats();
+	if (traceFile) {
+		Profiler::get().printStats();
+		Profiler::get().writeTrace(traceFile);
+	}
+	if (memoryReport)
+		memory.print(binary);
+	for (SSAPassManager* passManager : setupPasses) {
+		for (SSAPass& pass : passManager->passes)
+			delete pass.transformer;
+		delete passManager;
+	}
+	for (SSAPassManager* passManager : optimizerPasses) {
+		for (SSAPass& pass : passManager->passes)
+			delete pass.transformer;
+		delete passManager;
 	}
 	delete optimizer;
 
@@ -0,0 +1,596 @@
+#include "PhCompiler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+namespace holodec {
+
+	static const char* exprTypeNames[] = {
+		"Label", "Undef", "Nop", "Op", "LoadAddr", "Flag", "Builtin", "Extend", "UpdatePart", "Append", "Cast", "Input", "Output", "Call",
+		"Return", "Syscall", "Trap", "Phi", "Assign", "Jmp", "CJmp", "MultiBranch", "MemAccess", "Push", "Pop", "Store", "Load", nullptr
+	};
+	static const char* opTypeNames[] = {
+		"Add", "Sub", "Mul", "Div", "Mod", "And", "Or", "Not", "Eq", "Ne", "Lower", "Le", "Greater", "Ge",
+		"BAnd", "BOr", "BXor", "BNot", "Shr", "Shl", "Sar", "Sal", "Ror", "Rol", nullptr
+	};
+	static const char* flagTypeNames[] = {"C", "O", "U", nullptr};
+	static const char* argTypeNames[] = {"Undef", "SInt", "UInt", "Float", "Id", "Other", nullptr};
+	static const char* typeNames[] = {"Unknown", "Int", "UInt", "Float", "Pc", "Memaccess", nullptr};
+
+	//maps a name of the rule file to the enum value of the generated code
+	static std::string enumValue (const char* enumName, const char** names, HString& value) {
+		for (size_t i = 0; names[i]; i++) {
+			if (caseCmpHString (value, names[i]))
+				return std::string (enumName) + "::e" + names[i];
+		}
+		return std::string();
+	}
+	static bool isNumber (HString& value) {
+		char* end;
+		strtoll (value.cstr(), &end, 0);
+		return value && *end == '\0';
+	}
+	static std::string expr (uint32_t depth) {
+		return "e" + std::to_string (depth);
+	}
+	static std::string arg (uint32_t depth, uint32_t index) {
+		return expr (depth) + "->subExpressions[" + std::to_string (index - 1) + "]";
+	}
+	//bounds check of an argument, empty if an earlier test already checked the number of arguments
+	static std::string argGuard (HList<PhTest>* tests, uint32_t depth, uint32_t index) {
+		for (PhTest& test : *tests) {
+			if (test.depth == depth && test.minArgs >= index)
+				return std::string();
+		}
+		return expr (depth) + "->subExpressions.size() >= " + std::to_string (index);
+	}
+	static std::string joinConditions (const std::string& lhs, const std::string& rhs) {
+		return lhs.empty() ? rhs : (rhs.empty() ? lhs : lhs + " && " + rhs);
+	}
+	static std::string quote (HString& string) {
+		std::string quoted = "\"";
+		for (const char* c = string.cstr(); *c; c++) {
+			if (*c == '"' || *c == '\\')
+				quoted += '\\';
+			quoted += *c;
+		}
+		return quoted + "\"";
+	}
+
+	void PhCompiler::printError (PhCall& call, const char* message) {
+		printf ("%s:%d: %s in %s\n", filename.cstr(), call.line, message, call.name.cstr());
+		failed = true;
+	}
+
+	bool PhCompiler::compile (HList<PhMatcher>& matchers) {
+		for (PhMatcher& matcher : matchers) {
+			filename = matcher.filename;
+			HString name = matcher.name ? matcher.name : HString (("Rule " + std::to_string (matcher.line)).c_str());
+			//matchers with the same name count as one rule
+			uint32_t rule = 0;
+			while (rule < ruleNames.size() && !(ruleNames[rule] == name))
+				rule++;
+			if (rule == ruleNames.size())
+				ruleNames.push_back (name);
+			HList<PhTest> prefix;
+			addMatcher (matcher, rule, 1, prefix);
+		}
+		return !failed;
+	}
+
+	void PhCompiler::addMatcher (PhMatcher& matcher, uint32_t rule, uint32_t depth, HList<PhTest>& prefix) {
+		maxDepth = std::max (maxDepth, depth);
+		HList<PhTest> tests = prefix;
+		for (PhCall& call : matcher.rules) {
+			if (!addRule (call, depth, &tests))
+				return;
+		}
+		for (PhSubmatch& submatch : matcher.submatches) {
+			PhTest descend;
+			descend.code = joinConditions (argGuard (&tests, depth, submatch.index), arg (depth, submatch.index) + ".type == SSAArgType::eId");
+			descend.minArgs = submatch.index;
+			descend.depth = depth;
+			descend.argIndex = submatch.index;
+			HList<PhTest> subPrefix = tests;
+			subPrefix.push_back (descend);
+			for (PhMatcher& subMatcher : submatch.matchers) {
+				//remember which expressions a rule can look at below the root
+				std::string condition;
+				HList<PhTest> typeTests;
+				for (PhCall& call : subMatcher.rules) {
+					if (call.name == "type")
+						addRule (call, 0, &typeTests);
+				}
+				if (typeTests.empty()) {
+					anyArgument = true;
+				} else {
+					for (PhTest& test : typeTests) {
+						if (test.switchable)
+							condition += (condition.empty() ? "" : " && ") + test.subject + " == " + test.value;
+					}
+					argumentConditions.push_back (condition);
+				}
+				addMatcher (subMatcher, rule, depth + 1, subPrefix);
+			}
+		}
+		if (!matcher.actions.empty()) {
+			PhPath path;
+			path.tests = tests;
+			path.rule = rule;
+			path.depth = depth;
+			for (PhCall& call : matcher.actions) {
+				if (!addAction (call, depth, &path.actions))
+					return;
+			}
+			paths.push_back (path);
+		}
+	}
+
+	bool PhCompiler::addRule (PhCall& call, uint32_t depth, HList<PhTest>* tests) {
+		std::string e = expr (depth);
+		bool negate = call.has ("not");
+		PhTest test;
+		test.depth = depth;
+		if (call.name == "type") {
+			if (negate) {
+				printError (call, "not is not supported");
+				return false;
+			}
+			PhParam* type = call.get ("type");
+			PhParam* op = call.get ("op");
+			PhParam* flag = call.get ("flag");
+			PhParam* size = call.get ("size");
+			std::string typeValue;
+			if (type) {
+				typeValue = enumValue ("SSAExprType", exprTypeNames, type->value);
+				if (typeValue.empty()) {
+					printError (call, "unknown expression type");
+					return false;
+				}
+			} else if (op) {
+				typeValue = "SSAExprType::eOp";
+			} else if (flag) {
+				typeValue = "SSAExprType::eFlag";
+			}
+			if ((op && typeValue != "SSAExprType::eOp") || (flag && typeValue != "SSAExprType::eFlag")) {
+				printError (call, "op needs type Op and flag needs type Flag");
+				return false;
+			}
+			if (!typeValue.empty()) {
+				test.subject = e + "->type";
+				test.value = typeValue;
+				test.switchable = true;
+				test.code = test.subject + " == " + test.value;
+				tests->push_back (test);
+			}
+			if (op || flag) {
+				test.subject = e + (op ? "->opType" : "->flagType");
+				test.value = op ? enumValue ("SSAOpType", opTypeNames, op->value) : enumValue ("SSAFlagType", flagTypeNames, flag->value);
+				if (test.value.empty()) {
+					printError (call, op ? "unknown op" : "unknown flag");
+					return false;
+				}
+				test.code = test.subject + " == " + test.value;
+				tests->push_back (test);
+			}
+			if (size) {
+				if (!isNumber (size->value)) {
+					printError (call, "size is not a number");
+					return false;
+				}
+				test.subject = e + "->size";
+				test.value = size->value.cstr();
+				test.switchable = false;
+				test.code = test.subject + " == " + test.value;
+				tests->push_back (test);
+			}
+			return true;
+		}
+		std::string condition;
+		std::string guard;
+		if (call.name == "argcount") {
+			PhParam* count = call.get ("count");
+			PhParam* min = call.get ("min");
+			if ((count && !isNumber (count->value)) || (min && !isNumber (min->value)) || (!count && !min)) {
+				printError (call, "count or min needed");
+				return false;
+			}
+			if (count) {
+				test.subject = e + "->subExpressions.size()";
+				test.value = count->value.cstr();
+				condition = test.subject + " == " + test.value;
+			} else {
+				condition = e + "->subExpressions.size() >= " + min->value.cstr();
+			}
+			if (!negate)
+				test.minArgs = atoi (count ? count->value.cstr() : min->value.cstr());
+		} else if (call.name == "argtype" || call.name == "argvalue" || call.name == "argoffset" || call.name == "argsize") {
+			PhParam* index = call.get ("index");
+			if (!index || !isNumber (index->value) || !atoi (index->value.cstr())) {
+				printError (call, "index starting at 1 needed");
+				return false;
+			}
+			uint32_t argIndex = atoi (index->value.cstr());
+			guard = argGuard (tests, depth, argIndex);
+			std::string a = arg (depth, argIndex);
+			if (call.name == "argtype") {
+				PhParam* type = call.get ("type");
+				test.value = type ? enumValue ("SSAArgType", argTypeNames, type->value) : std::string();
+				if (test.value.empty()) {
+					printError (call, "unknown argument type");
+					return false;
+				}
+				test.subject = a + ".type";
+				condition = test.subject + " == " + test.value;
+			} else if (call.name == "argvalue") {
+				PhParam* value = call.get ("value");
+				PhParam* uval = call.get ("uval");
+				PhParam* sval = call.get ("sval");
+				if (value && isNumber (value->value)) {
+					condition = a + ".isValue (" + value->value.cstr() + ")";
+				} else if (uval && isNumber (uval->value)) {
+					condition = a + ".type == SSAArgType::eUInt && " + a + ".uval == " + uval->value.cstr();
+				} else if (sval && isNumber (sval->value)) {
+					condition = a + ".type == SSAArgType::eSInt && " + a + ".sval == " + sval->value.cstr();
+				} else {
+					printError (call, "value, uval or sval needed");
+					return false;
+				}
+			} else {
+				const char* member = call.name == "argoffset" ? "offset" : "size";
+				PhParam* value = call.get (member);
+				if (!value || !isNumber (value->value)) {
+					printError (call, "value needed");
+					return false;
+				}
+				test.subject = a + "." + member;
+				test.value = value->value.cstr();
+				condition = test.subject + " == " + test.value;
+			}
+		} else if (call.name == "cmp_arg") {
+			PhParam* argIndex = call.get ("argIndex");
+			PhParam* foundIndex = call.get ("foundIndex");
+			PhParam* foundArgIndex = call.get ("foundArgIndex");
+			uint32_t otherDepth = foundIndex ? atoi (foundIndex->value.cstr()) : depth;
+			if (!argIndex || !foundArgIndex || !atoi (argIndex->value.cstr()) || !atoi (foundArgIndex->value.cstr()) || !otherDepth || otherDepth > depth) {
+				printError (call, "argIndex, foundArgIndex and a foundIndex of an enclosing matcher needed");
+				return false;
+			}
+			guard = joinConditions (argGuard (tests, depth, atoi (argIndex->value.cstr())), argGuard (tests, otherDepth, atoi (foundArgIndex->value.cstr())));
+			condition = arg (depth, atoi (argIndex->value.cstr())) + " == " + arg (otherDepth, atoi (foundArgIndex->value.cstr()));
+		} else if (call.name == "usedonlyin") {
+			PhParam* type = call.get ("type");
+			std::string typeValue = type ? enumValue ("SSAExprType", exprTypeNames, type->value) : std::string();
+			if (typeValue.empty()) {
+				printError (call, "unknown expression type");
+				return false;
+			}
+			condition = "usedOnlyIn (ssaRep, *" + e + ", " + typeValue + ")";
+		} else {
+			printError (call, "unknown rule");
+			return false;
+		}
+		if (negate) {
+			condition = "!(" + condition + ")";
+			test.subject.clear();
+		}
+		test.code = joinConditions (guard, condition);
+		tests->push_back (test);
+		return true;
+	}
+
+	bool PhCompiler::addAction (PhCall& call, uint32_t depth, HList<std::string>* actions) {
+		PhParam* dst = call.get ("dstFoundId");
+		if (!dst)
+			dst = call.get ("foundId");
+		uint32_t dstDepth = dst ? atoi (dst->value.cstr()) : 0;
+		if (!dstDepth || dstDepth > depth) {
+			printError (call, "dstFoundId of an enclosing matcher needed");
+			return false;
+		}
+		std::string code = "SSAExpression& expr = ssaRep->expressions[found[" + std::to_string (dstDepth) + "]];\n";
+		std::string a;
+		if (PhParam* argIndex = call.get ("dstArgIndex")) {
+			if (!atoi (argIndex->value.cstr())) {
+				printError (call, "dstArgIndex starts at 1");
+				return false;
+			}
+			a = "expr.subExpressions[" + std::to_string (atoi (argIndex->value.cstr()) - 1) + "]";
+		}
+		if (call.name == "set_instr_type") {
+			PhParam* type = call.get ("type");
+			PhParam* op = call.get ("op");
+			PhParam* flag = call.get ("flag");
+			if (type) {
+				std::string value = enumValue ("SSAExprType", exprTypeNames, type->value);
+				if (value.empty()) {
+					printError (call, "unknown expression type");
+					return false;
+				}
+				code += "expr.type = " + value + ";\n";
+			}
+			if (op) {
+				std::string value = enumValue ("SSAOpType", opTypeNames, op->value);
+				if (value.empty()) {
+					printError (call, "unknown op");
+					return false;
+				}
+				code += "expr.opType = " + value + ";\n";
+			} else if (flag) {
+				std::string value = enumValue ("SSAFlagType", flagTypeNames, flag->value);
+				if (value.empty()) {
+					printError (call, "unknown flag");
+					return false;
+				}
+				code += "expr.flagType = " + value + ";\n";
+			}
+		} else if (call.name == "set_instr_size") {
+			PhParam* size = call.get ("size");
+			if (!size || !isNumber (size->value)) {
+				printError (call, "size needed");
+				return false;
+			}
+			code += std::string ("expr.size = ") + size->value.cstr() + ";\n";
+		} else if (call.name == "set_instr_exprtype") {
+			PhParam* type = call.get ("exprtype");
+			std::string value = type ? enumValue ("SSAType", typeNames, type->value) : std::string();
+			if (value.empty()) {
+				printError (call, "unknown exprtype");
+				return false;
+			}
+			code += "expr.exprtype = " + value + ";\n";
+		} else if (call.name == "set_arg_size" || call.name == "set_arg_offset") {
+			const char* member = call.name == "set_arg_size" ? "size" : "offset";
+			PhParam* value = call.get (member);
+			if (a.empty() || !value || !isNumber (value->value)) {
+				printError (call, "dstArgIndex and value needed");
+				return false;
+			}
+			code += "SSAArgument& arg = " + a + ";\n";
+			if (call.has ("extend") && call.name == "set_arg_offset")//keeps the end of the argument
+				code += std::string ("arg.size += arg.offset - ") + value->value.cstr() + ";\n";
+			code += std::string ("arg.") + member + " = " + value->value.cstr() + ";\n";
+		} else if (call.name == "replace_uses") {
+			std::string replaceArg;
+			PhParam* uval = call.get ("uval");
+			PhParam* sval = call.get ("sval");
+			PhParam* argFound = call.get ("argFoundId");
+			PhParam* argIndex = call.get ("argIndex");
+			if (uval && isNumber (uval->value)) {
+				replaceArg = std::string ("SSAArgument::createUVal (") + uval->value.cstr() + ", expr.size)";
+			} else if (sval && isNumber (sval->value)) {
+				replaceArg = std::string ("SSAArgument::createSVal (") + sval->value.cstr() + ", expr.size)";
+			} else if (call.has ("undef")) {
+				replaceArg = "SSAArgument::createUndef (expr.location, expr.locref, expr.size)";
+			} else if (argFound && argIndex && atoi (argFound->value.cstr()) && atoi (argFound->value.cstr()) <= (int) depth && atoi (argIndex->value.cstr())) {
+				code += "SSAArgument arg = ssaRep->expressions[found[" + std::to_string (atoi (argFound->value.cstr())) + "]].subExpressions[" + std::to_string (atoi (argIndex->value.cstr()) - 1) + "];\n";
+				replaceArg = "arg";
+			} else {
+				printError (call, "uval, sval, undef or argFoundId and argIndex needed");
+				return false;
+			}
+			//flags are specific to the operation they are calculated from and can keep the original
+			code += std::string (call.has ("keepflags") ? "ssaRep->replaceArg" : "ssaRep->replaceAllArgs") + " (expr, " + replaceArg + ");\n";
+		} else {
+			printError (call, "unknown action");
+			return false;
+		}
+		//the replace functions log their changes, the others change the expression in place
+		if (!(call.name == "replace_uses"))
+			code += "ssaRep->markChanged (expr.id);\n";
+		actions->push_back (code);
+		return true;
+	}
+
+	PhNode* PhCompiler::buildTree() {
+		PhNode* root = new PhNode();
+		for (PhPath& path : paths)
+			insertPath (root, &path);
+		return root;
+	}
+	//a test is shared with the last child or with an earlier child if all following children exclude it
+	//so the order in which the rules are tried does not change
+	void PhCompiler::insertPath (PhNode* node, PhPath* path) {
+		path->missNode = node;
+		for (PhTest& test : path->tests) {
+			PhNode* next = nullptr;
+			for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+				PhTest& other = (*it)->test;
+				if (!(*it)->leaf && other.code == test.code && other.depth == test.depth && other.argIndex == test.argIndex) {
+					next = *it;
+					break;
+				}
+				if ((*it)->leaf || other.subject.empty() || other.subject != test.subject || other.value == test.value)
+					break;
+			}
+			if (!next) {
+				next = new PhNode();
+				next->test = test;
+				node->children.push_back (next);
+			}
+			node = next;
+			if (test.depth == 1 && test.switchable)
+				path->missNode = node;
+		}
+		PhNode* leaf = new PhNode();
+		leaf->leaf = path;
+		node->children.push_back (leaf);
+	}
+	//a rule is missed if the type tests of the root held but none of its paths applied
+	//it is only counted at the first of its nodes on the way so that it is not missed twice
+	void PhCompiler::assignMisses (PhNode* node, HList<uint32_t>* assigned) {
+		size_t count = assigned->size();
+		for (PhPath& path : paths) {
+			if (path.missNode == node && std::find (assigned->begin(), assigned->end(), path.rule) == assigned->end()) {
+				node->misses.push_back (path.rule);
+				assigned->push_back (path.rule);
+			}
+		}
+		for (PhNode* child : node->children)
+			assignMisses (child, assigned);
+		assigned->resize (count);
+	}
+	//whether the generated tests or actions use a parameter of the match function
+	bool PhCompiler::usesIdentifier (const char* name) {
+		size_t length = strlen (name);
+		auto contains = [name, length] (const std::string& code) {
+			for (size_t pos = code.find (name); pos != std::string::npos; pos = code.find (name, pos + 1)) {
+				bool begin = !pos || !(isalnum (code[pos - 1]) || code[pos - 1] == '_');
+				bool end = pos + length == code.size() || !(isalnum (code[pos + length]) || code[pos + length] == '_');
+				if (begin && end)
+					return true;
+			}
+			return false;
+		};
+		for (PhPath& path : paths) {
+			for (PhTest& test : path.tests) {
+				if (contains (test.code))
+					return true;
+			}
+			for (std::string& action : path.actions) {
+				if (contains (action))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	static void writeIndent (FILE* file, int indent) {
+		for (int i = 0; i < indent; i++)
+			fputc ('\t', file);
+	}
+	static void writeLines (FILE* file, const std::string& code, int indent) {
+		size_t begin = 0;
+		while (begin < code.size()) {
+			size_t end = code.find ('\n', begin);
+			if (end == std::string::npos)
+				end = code.size();
+			writeIndent (file, indent);
+			fprintf (file, "%s\n", code.substr (begin, end - begin).c_str());
+			begin = end + 1;
+		}
+	}
+	void PhCompiler::writeNode (FILE* file, PhNode* node, int indent) {
+		if (node->leaf) {
+			PhPath* path = node->leaf;
+			writeIndent (file, indent);
+			fprintf (file, "HLOG_DEBUG (g_peephole_logger, %s);\n", quote (ruleNames[path->rule]).c_str());
+			for (std::string& action : path->actions) {
+				writeIndent (file, indent);
+				fprintf (file, "{\n");
+				writeLines (file, action, indent + 1);
+				writeIndent (file, indent);
+				fprintf (file, "}\n");
+			}
+			writeIndent (file, indent);
+			fprintf (file, "context->expressionsMatched.assign (found + 1, found + %d);\n", path->depth + 1);
+			writeIndent (file, indent);
+			fprintf (file, "hits[%d]++;\n", path->rule);
+			writeIndent (file, indent);
+			fprintf (file, "return true;\n");
+			return;
+		}
+		writeIndent (file, indent);
+		fprintf (file, "if (%s) {\n", node->test.code.c_str());
+		if (node->test.argIndex) {
+			uint32_t depth = node->test.depth;
+			writeIndent (file, indent + 1);
+			fprintf (file, "found[%d] = %s.ssaId;\n", depth + 1, arg (depth, node->test.argIndex).c_str());
+			writeIndent (file, indent + 1);
+			fprintf (file, "SSAExpression* %s = &ssaRep->expressions[found[%d]];\n", expr (depth + 1).c_str(), depth + 1);
+		}
+		writeChildren (file, node, indent + 1);
+		writeMisses (file, node, indent + 1);
+		writeIndent (file, indent);
+		fprintf (file, "}\n");
+	}
+	void PhCompiler::writeMisses (FILE* file, PhNode* node, int indent) {
+		if (!node->children.empty() && node->children.back()->leaf)//always returns before
+			return;
+		for (uint32_t rule : node->misses) {
+			writeIndent (file, indent);
+			fprintf (file, "misses[%d]++;\n", rule);
+		}
+	}
+	void PhCompiler::writeChildren (FILE* file, PhNode* node, int indent) {
+		bool useSwitch = node->children.size() > 1;
+		for (PhNode* child : node->children) {
+			if (child->leaf || !child->test.switchable || child->test.subject != node->children[0]->test.subject)
+				useSwitch = false;
+		}
+		if (!useSwitch) {
+			for (PhNode* child : node->children)
+				writeNode (file, child, indent);
+			return;
+		}
+		writeIndent (file, indent);
+		fprintf (file, "switch (%s) {\n", node->children[0]->test.subject.c_str());
+		for (PhNode* child : node->children) {
+			writeIndent (file, indent);
+			fprintf (file, "case %s: {\n", child->test.value.c_str());
+			writeChildren (file, child, indent + 1);
+			writeMisses (file, child, indent + 1);
+			if (child->children.empty() || !child->children.back()->leaf) {//otherwise always returns before
+				writeIndent (file, indent + 1);
+				fprintf (file, "break;\n");
+			}
+			writeIndent (file, indent);
+			fprintf (file, "}\n");
+		}
+		writeIndent (file, indent);
+		fprintf (file, "default:\n");
+		writeIndent (file, indent + 1);
+		fprintf (file, "break;\n");
+		writeIndent (file, indent);
+		fprintf (file, "}\n");
+	}
+
+	void PhCompiler::write (FILE* file) {
+		PhNode* root = buildTree();
+		HList<uint32_t> assigned;
+		assignMisses (root, &assigned);
+
+		fprintf (file, "//generated by phc from the peephole rule files, do not edit\n");
+		fprintf (file, "#include \"PeepholeOptimizer.h\"\n");
+		fprintf (file, "#include \"SSA.h\"\n\n");
+		fprintf (file, "namespace holodec {\n\n");
+		fprintf (file, "\tstatic const char* const ruleNames[] = {\n");
+		for (HString& name : ruleNames)
+			fprintf (file, "\t\t%s,\n", quote (name).c_str());
+		if (ruleNames.empty())
+			fprintf (file, "\t\t\"\",\n");
+		fprintf (file, "\t};\n\n");
+
+		std::string condition = anyArgument ? "true" : "";
+		for (size_t i = 0; !anyArgument && i < argumentConditions.size(); i++) {
+			std::string argCondition = argumentConditions[i];
+			for (size_t pos; (pos = argCondition.find ("e0->")) != std::string::npos;)
+				argCondition.replace (pos, 4, "expr->");
+			condition += (condition.empty() ? "(" : " || (") + argCondition + ")";
+		}
+		//the names of unused parameters are left out
+		bool usesExpr = condition.find ("expr->") != std::string::npos;
+		fprintf (file, "\tstatic bool isArgument (SSAExpression*%s) {\n", usesExpr ? " expr" : "");
+		fprintf (file, "\t\treturn %s;\n", condition.empty() ? "false" : condition.c_str());
+		fprintf (file, "\t}\n\n");
+
+		bool usesMisses = false;
+		for (PhPath& path : paths) {
+			PhNode* node = path.missNode;
+			usesMisses |= !node->misses.empty() && (node->children.empty() || !node->children.back()->leaf);
+		}
+		fprintf (file, "\tstatic bool match (Architecture*%s, SSARepresentation* ssaRep, SSAExpression* expr, MatchContext* context, uint64_t* hits, uint64_t*%s) {\n",
+		         usesIdentifier ("arch") ? " arch" : "", usesMisses ? " misses" : "");
+		fprintf (file, "\t\tHId found[%d] = {0, expr->id};\n", maxDepth + 1);
+		fprintf (file, "\t\tSSAExpression* e1 = expr;\n");
+		writeChildren (file, root, 2);
+		writeMisses (file, root, 2);
+		fprintf (file, "\t\treturn false;\n");
+		fprintf (file, "\t}\n\n");
+
+		fprintf (file, "\tconst PhGeneratedRules g_ph_generated_rules = {ruleNames, %d, %d, match, isArgument};\n", (int) ruleNames.size(), maxDepth - 1);
+		fprintf (file, "}\n");
+		delete root;
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef PHCOMPILER_H
+#define PHCOMPILER_H
+
+#include "PhParser.h"
+#include <string>
+#include <algorithm>
+
+namespace holodec {
+
+	//a condition on one of the matched expressions or the step to the expression an argument references
+	struct PhTest {
+		std::string code;
+		//equality tests on the same subject with different values exclude each other
+		//and tests on the type of an expression can be dispatched with a switch
+		std::string subject;
+		std::string value;
+		bool switchable = false;
+		uint32_t depth = 0;//expression the test is on
+		uint32_t argIndex = 0;//if not 0 binds the expression referenced by this argument at depth + 1
+		uint32_t minArgs = 0;//the expression at depth has at least this many arguments if the test holds
+	};
+
+	struct PhNode;
+
+	//one way through a matcher and its submatches that ends in the actions of a matcher
+	struct PhPath {
+		HList<PhTest> tests;
+		HList<std::string> actions;
+		uint32_t rule;
+		uint32_t depth;
+		PhNode* missNode = nullptr;//the node after the type tests of the root expression
+	};
+
+	//node of the decision tree, rules share the node of a common prefix of tests
+	struct PhNode {
+		PhTest test;
+		HList<PhNode*> children;
+		PhPath* leaf = nullptr;
+		HList<uint32_t> misses;//rules counted as missed if no child matched
+
+		~PhNode() {
+			for (PhNode* child : children)
+				delete child;
+		}
+	};
+
+	//compiles parsed matchers into one C++ decision tree for PeepholeGenerated.cpp
+	struct PhCompiler {
+		HString filename;//the rule file of the matcher that is compiled
+		HList<HString> ruleNames;
+		HList<PhPath> paths;
+		HList<std::string> argumentConditions;//type tests of the expressions below the root
+		bool anyArgument = false;
+		uint32_t maxDepth = 1;
+		bool failed = false;
+
+		bool compile (HList<PhMatcher>& matchers);
+		void write (FILE* file);
+
+	private:
+		void addMatcher (PhMatcher& matcher, uint32_t rule, uint32_t depth, HList<PhTest>& prefix);
+		bool addRule (PhCall& rule, uint32_t depth, HList<PhTest>* tests);
+		bool addAction (PhCall& action, uint32_t depth, HList<std::string>* actions);
+
+		PhNode* buildTree();
+		void insertPath (PhNode* node, PhPath* path);
+		void writeNode (FILE* file, PhNode* node, int indent);
+		void writeChildren (FILE* file, PhNode* node, int indent);
+		void writeMisses (FILE* file, PhNode* node, int indent);
+		void assignMisses (PhNode* node, HList<uint32_t>* assigned);
+		bool usesIdentifier (const char* name);
+
+		void printError (PhCall& call, const char* message);
+	};
+}
+
+#endif // PHCOMPILER_H
@@ -0,0 +1,241 @@
+#include "PhParser.h"
+
+#include <fstream>
+#include <sstream>
+#include <cctype>
+
+namespace holodec {
+
+	PhParam* PhCall::get (const char* name) {
+		for (PhParam& param : params) {
+			if (param.name == name)
+				return &param;
+		}
+		return nullptr;
+	}
+
+	bool PhParser::parseFile (const char* filename, HList<PhMatcher>* matchers) {
+		std::ifstream file (filename);
+		if (!file) {
+			printf ("Cannot open rule file %s\n", filename);
+			return false;
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		this->filename = filename;
+		string = buffer.str().c_str();
+		index = 0;
+		failed = false;
+		return parse (matchers);
+	}
+	bool PhParser::parse (HList<PhMatcher>* matchers) {
+		skipWhitespaces();
+		while (peek()) {
+			PhMatcher matcher;
+			matcher.filename = filename;
+			if (!parseMatcher (&matcher))
+				return false;
+			matchers->push_back (matcher);
+			skipWhitespaces();
+		}
+		return !failed;
+	}
+
+	void PhParser::skipWhitespaces() {
+		while (true) {
+			char c = peek();
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+				consume();
+			} else if (c == '/' && string[static_cast<int>(index + 1)] == '/') {//comment until the end of the line
+				while (peek() && peek() != '\n')
+					consume();
+			} else {
+				return;
+			}
+		}
+	}
+	int PhParser::currentLine() {
+		int line = 1;
+		for (size_t i = 0; i < index && string[static_cast<int>(i)]; i++) {
+			if (string[static_cast<int>(i)] == '\n')
+				line++;
+		}
+		return line;
+	}
+	void PhParser::printParseFailure (const char* expected) {
+		printf ("%s:%d: Invalid Token at '%.20s' expected %s\n", filename.cstr(), currentLine(), string.cstr() + index, expected);
+		failed = true;
+	}
+	bool PhParser::parseIdentifier (HString* identifier) {
+		skipWhitespaces();
+		size_t start = index;
+		while (isalnum (peek()) || peek() == '_')
+			consume();
+		if (start == index)
+			return false;
+		*identifier = std::string (string.cstr() + start, index - start).c_str();
+		return true;
+	}
+	bool PhParser::parseValue (HString* value) {
+		skipWhitespaces();
+		if (parseCharacter ('"')) {
+			size_t start = index;
+			while (peek() && peek() != '"' && peek() != '\n')
+				consume();
+			if (!parseCharacter ('"')) {
+				printParseFailure ("'\"'");
+				return false;
+			}
+			*value = std::string (string.cstr() + start, index - start - 1).c_str();
+			return true;
+		}
+		size_t start = index;
+		if (peek() == '-')
+			consume();
+		while (isalnum (peek()) || peek() == '_')
+			consume();
+		if (start == index)
+			return false;
+		*value = std::string (string.cstr() + start, index - start).c_str();
+		return true;
+	}
+	bool PhParser::parseCharacter (char character) {
+		skipWhitespaces();
+		if (character == pop()) {
+			return true;
+		}
+		pushback();
+		return false;
+	}
+	bool PhParser::parseKeyword (const char* keyword) {
+		size_t start = index;
+		HString identifier;
+		if (parseIdentifier (&identifier) && identifier == keyword)
+			return true;
+		index = start;
+		return false;
+	}
+
+	bool PhParser::parseParams (HList<PhParam>* params) {
+		if (!parseCharacter ('('))
+			return true;
+		if (parseCharacter (')'))
+			return true;
+		do {
+			PhParam param;
+			if (!parseIdentifier (&param.name)) {
+				printParseFailure ("parameter name");
+				return false;
+			}
+			if (parseCharacter ('=') && !parseValue (&param.value)) {
+				printParseFailure ("parameter value");
+				return false;
+			}
+			params->push_back (param);
+		} while (parseCharacter (','));
+		if (!parseCharacter (')')) {
+			printParseFailure ("')'");
+			return false;
+		}
+		return true;
+	}
+	bool PhParser::parseCalls (HList<PhCall>* calls) {
+		if (!parseCharacter ('{')) {
+			printParseFailure ("'{'");
+			return false;
+		}
+		while (!parseCharacter ('}')) {
+			PhCall call;
+			skipWhitespaces();
+			call.line = currentLine();
+			if (!parseIdentifier (&call.name)) {
+				printParseFailure ("rule or action");
+				return false;
+			}
+			if (!parseParams (&call.params))
+				return false;
+			if (parseCharacter ('{') && !parseCharacter ('}')) {//the rules can be followed by an empty body
+				printParseFailure ("'}'");
+				return false;
+			}
+			calls->push_back (call);
+		}
+		return true;
+	}
+	bool PhParser::parseSubmatches (HList<PhSubmatch>* submatches) {
+		if (!parseCharacter ('{')) {
+			printParseFailure ("'{'");
+			return false;
+		}
+		while (!parseCharacter ('}')) {
+			PhSubmatch submatch;
+			skipWhitespaces();
+			submatch.line = currentLine();
+			if (!parseKeyword ("match")) {
+				printParseFailure ("match");
+				return false;
+			}
+			PhCall call;
+			if (!parseParams (&call.params))
+				return false;
+			PhParam* indexParam = call.get ("index");
+			if (!indexParam || !(submatch.index = strtoul (indexParam->value.cstr(), nullptr, 0))) {
+				printf ("%s:%d: match needs an argument index starting at 1\n", filename.cstr(), submatch.line);
+				failed = true;
+				return false;
+			}
+			if (!parseCharacter ('{')) {
+				printParseFailure ("'{'");
+				return false;
+			}
+			while (!parseCharacter ('}')) {
+				PhMatcher matcher;
+				if (!parseMatcher (&matcher))
+					return false;
+				submatch.matchers.push_back (matcher);
+			}
+			submatches->push_back (submatch);
+		}
+		return true;
+	}
+	bool PhParser::parseMatcher (PhMatcher* matcher) {
+		skipWhitespaces();
+		matcher->line = currentLine();
+		if (!parseKeyword ("matcher")) {
+			printParseFailure ("matcher");
+			return false;
+		}
+		PhCall call;
+		if (!parseParams (&call.params))
+			return false;
+		if (PhParam* name = call.get ("name"))
+			matcher->name = name->value;
+		if (!parseCharacter ('{')) {
+			printParseFailure ("'{'");
+			return false;
+		}
+		bool hasRules = false;
+		while (!parseCharacter ('}')) {
+			if (parseKeyword ("rules")) {
+				if (!parseCalls (&matcher->rules))
+					return false;
+				hasRules = true;
+			} else if (parseKeyword ("submatches")) {
+				if (!parseSubmatches (&matcher->submatches))
+					return false;
+			} else if (parseKeyword ("actions")) {
+				if (!parseCalls (&matcher->actions))
+					return false;
+			} else {
+				printParseFailure ("rules, submatches or actions");
+				return false;
+			}
+		}
+		if (!hasRules) {
+			printf ("%s:%d: matcher without rules\n", filename.cstr(), matcher->line);
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef PHPARSER_H
+#define PHPARSER_H
+
+#include "General.h"
+
+namespace holodec {
+
+	//a parameter of a rule or action, keywords have no value
+	struct PhParam {
+		HString name;
+		HString value;
+	};
+	//a rule or an action e.g. type(type=Op,op=Add)
+	struct PhCall {
+		HString name;
+		HList<PhParam> params;
+		int line = 0;
+
+		PhParam* get (const char* name);
+		bool has (const char* name) {
+			return get (name) != nullptr;
+		}
+	};
+
+	struct PhMatcher;
+
+	//tries the matchers on the expression referenced by the argument at index
+	struct PhSubmatch {
+		uint32_t index = 0;
+		HList<PhMatcher> matchers;
+		int line = 0;
+	};
+
+	//matcher{ rules{...} submatches{...} actions{...} }
+	//the actions are executed if all rules hold and none of the submatches was executed
+	struct PhMatcher {
+		HString name;
+		HList<PhCall> rules;
+		HList<PhSubmatch> submatches;
+		HList<PhCall> actions;
+		int line = 0;
+		HString filename;//the rule file of the matcher
+	};
+
+	struct PhParser {
+		size_t index = 0;
+		HString string;
+		HString filename;
+		bool failed = false;
+
+		char peek() {
+			return string[static_cast<int>(index)];
+		}
+		char pop() {
+			return string[static_cast<int>(index++)];
+		}
+		void consume (size_t count = 1) {
+			index += count;
+		}
+		void pushback (size_t count = 1) {
+			index -= count;
+		}
+
+		//parses all matchers of a rule file
+		bool parseFile (const char* filename, HList<PhMatcher>* matchers);
+		bool parse (HList<PhMatcher>* matchers);
+
+		bool parseMatcher (PhMatcher* matcher);
+		bool parseCalls (HList<PhCall>* calls);
+		bool parseSubmatches (HList<PhSubmatch>* submatches);
+		bool parseParams (HList<PhParam>* params);
+
+		bool parseIdentifier (HString* identifier);
+		bool parseValue (HString* value);
+		bool parseCharacter (char character);
+		bool parseKeyword (const char* keyword);
+		void skipWhitespaces();
+
+		int currentLine();
+		void printParseFailure (const char* expected);
+	};
+}
+
+#endif // PHPARSER_H
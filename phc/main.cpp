@@ -0,0 +1,29 @@
+#include "PhParser.h"
+#include "PhCompiler.h"
+
+using namespace holodec;
+
+//compiles peephole rule files into the decision tree of PeepholeGenerated.cpp
+int main (int argc, char** argv) {
+	if (argc < 3) {
+		printf ("Usage: phc <output.cpp> <rules.ph>...\n");
+		return 1;
+	}
+	HList<PhMatcher> matchers;
+	for (int i = 2; i < argc; i++) {
+		PhParser parser;
+		if (!parser.parseFile (argv[i], &matchers))
+			return 1;
+	}
+	PhCompiler compiler;
+	if (!compiler.compile (matchers))
+		return 1;
+	FILE* file = fopen (argv[1], "w");
+	if (!file) {
+		printf ("Cannot open output file %s\n", argv[1]);
+		return 1;
+	}
+	compiler.write (file);
+	fclose (file);
+	return 0;
+}